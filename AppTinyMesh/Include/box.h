@@ -6,6 +6,7 @@
 #include <iostream>
 
 #include "mathematics.h"
+#include "ray.h"
 
 class Box
 {
@@ -45,6 +46,9 @@ public:
   double Volume() const;
   double Area() const;
 
+  // Intersection
+  bool Intersect(const Ray&, double&, double&) const;
+
   // Compute sub-box
   Box Sub(int) const;
 
@@ -0,0 +1,65 @@
+// BVH
+
+#pragma once
+
+#include <atomic>
+
+#include "packet.h"
+
+// Bounding volume hierarchy of triangles
+class BVH
+{
+protected:
+  //! Node of the hierarchy. Leaves reference a range of triangles, inner nodes their two consecutive children.
+  struct Node
+  {
+    float a[3], b[3]; //!< Lower and upper vertex of the box.
+    int index;        //!< First triangle for leaves, first child for inner nodes.
+    int count;        //!< Number of triangles, 0 for inner nodes.
+  };
+
+  std::vector<Node> nodes;   //!< Nodes, the root is the first one.
+  TrianglePacket triangles;  //!< Triangles sorted in leaf order.
+  std::vector<int> tid;      //!< Original index of the triangles sorted in leaf order.
+public:
+  //! Empty.
+  BVH() {}
+  explicit BVH(const Mesh&);
+  explicit BVH(const std::vector<Triangle>&);
+
+  //! Empty.
+  ~BVH() {}
+
+  int Triangles() const;
+  int Nodes() const;
+  Box GetBox() const;
+
+  bool Intersect(const Ray&, double&, double&, double&, int&, double = Packet::Infinity) const;
+  bool Occluded(const Ray&, double) const;
+  int Closest(const Vector&, double&, double&, double&, double = Packet::Infinity) const;
+protected:
+  void Build(const std::vector<Triangle>&);
+  void Build(int, int, int, int, const std::vector<Box>&, const std::vector<Vector>&, std::atomic<int>&);
+  void SetBox(Node&, const Box&) const;
+  Triangle GetTriangle(int) const;
+  double SquaredDistance(const Node&, const Vector&) const;
+public:
+  static const int Leaf = 4; //!< Maximum number of triangles in a leaf.
+  static const int MaxDepth = 48; //!< Depth beyond which nodes are split at the median.
+};
+
+/*!
+\brief Return the number of triangles.
+*/
+inline int BVH::Triangles() const
+{
+  return int(tid.size());
+}
+
+/*!
+\brief Return the number of nodes.
+*/
+inline int BVH::Nodes() const
+{
+  return int(nodes.size());
+}
@@ -56,6 +56,7 @@ public:
 
   // Pixel and sub-pixel sampling
   Ray PixelToRay(int, int, int, int) const;
+  Ray PixelToRay(double, double, int, int) const;
   bool VectorToPixel(const Vector&, double&, double&, int, int) const;
 };
 
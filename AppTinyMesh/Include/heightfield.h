@@ -1,31 +1,234 @@
+#pragma once
+
 #include <vector>
 #include <iostream>
+#include <cstdint>
 #include <QImage>
 #include <algorithm>
 #include "mesh.h"
 #include "meshcolor.h"
 #include "color.h"
 
+// Read only view on a grid of heights, with rows separated by a stride
+class HeightView
+{
+    protected:
+        const float* data; //!< First height.
+        int width;         //!< Number of rows.
+        int length;        //!< Number of heights per row.
+        int stride;        //!< Distance between two rows.
+    public:
+        explicit HeightView(const float*, int, int, int);
+
+        int getWidth() const;
+        int getLength() const;
+
+        const float* operator[](int) const;
+        float operator()(int, int) const;
+        HeightView Window(int, int, int, int) const;
+};
+
 class HeightField
 {
     protected:
         int width;
         int length;
-        std::vector<std::vector<double>> height; //!< 2D array with height value between 0 and 1 (include).
+        std::vector<float> height; //!< Heights between 0 and 1 (include), stored row after row.
+        int dirty[4] = { 0, 0, -1, -1 }; //!< First row, first column, last row and last column modified by brushes, empty if the last row is before the first.
 
         void AddTriangle(int, int, int, int, std::vector<int>&, std::vector<int>&);
-        Color getColorBetweenGradient(Color, Color, double);
+        static Color getColorBetweenGradient(Color, Color, double);
+        void markDirty(int, int, int, int);
+
+        bool LoadR16(const uchar*, qint64, int, int);
+        bool LoadRaw(const uchar*, qint64, int, int);
+        bool LoadAsc(const char*, const char*);
+        void Normalize();
     public:
         explicit HeightField();
         explicit HeightField(QImage image);
         explicit HeightField(int width, int length);
 
-        std::vector<double> operator[](int n) const;
-        std::vector<double>& operator[](int n);
-        int getWidth();
-        int getLength();
+        bool Load(const QString&, int = 0, int = 0);
+        static bool Headerless(qint64, int, int&, int&);
+
+        const float* operator[](int n) const;
+        float* operator[](int n);
+        HeightView View() const;
+        int getWidth() const;
+        int getLength() const;
 
         MeshColor generateMesh(double, double, double);
-        Color generateColor(int, int, double);
+        MeshColor generateSmoothMesh(double, double, double) const;
+        Vector smoothNormal(int, int, double, double) const;
+        Color generateColor(int, int, double) const;
+        static Color slopeColor(double, double, double, double);
+
         void flatten(int, int, double, double, double);
+        void raise(int, int, double, double);
+        void smooth(int, int, double, double);
+        bool getDirty(int&, int&, int&, int&) const;
+        void clearDirty();
+};
+
+// Heights quantized to 16 bits in the range of the height field
+class QuantizedHeightField
+{
+    protected:
+        int width;
+        int length;
+        float a, b;                  //!< Range of heights.
+        std::vector<uint16_t> height; //!< Quantized heights, stored row after row.
+    public:
+        explicit QuantizedHeightField(const HeightField&);
+
+        int getWidth() const;
+        int getLength() const;
+        float operator()(int, int) const;
+        HeightField Decode() const;
 };
+
+// Heights stored in square tiles, with a Z-order curve inside tiles, for neighborhood kernels
+class TiledHeightField
+{
+    protected:
+        int width;
+        int length;
+        int tiles;                 //!< Number of tiles per row of tiles.
+        std::vector<float> height; //!< Heights, tile after tile.
+    public:
+        static const int Tile = 8; //!< Size of the tiles.
+
+        explicit TiledHeightField(const HeightField&);
+
+        int getWidth() const;
+        int getLength() const;
+        float operator()(int, int) const;
+        const float* Heights(int, int) const;
+        HeightField Decode() const;
+    protected:
+        static int Morton(int, int);
+        size_t Index(int, int) const;
+};
+
+/*!
+\brief Create a view.
+\param data First height.
+\param w, l Number of rows and heights per row.
+\param s Stride between rows.
+*/
+inline HeightView::HeightView(const float* data, int w, int l, int s) :data(data), width(w), length(l), stride(s)
+{
+}
+
+//! Get the number of rows.
+inline int HeightView::getWidth() const
+{
+  return width;
+}
+
+//! Get the number of heights per row.
+inline int HeightView::getLength() const
+{
+  return length;
+}
+
+//! Returns the i-th row, without copy.
+inline const float* HeightView::operator[](int i) const
+{
+  return data + size_t(i) * stride;
+}
+
+/*!
+\brief Get a height.
+\param i, j Integer coordinates.
+*/
+inline float HeightView::operator()(int i, int j) const
+{
+  return data[size_t(i) * stride + j];
+}
+
+/*!
+\brief Get a rectangular window of the view, sharing its heights.
+\param i, j First height of the window.
+\param w, l Size of the window.
+*/
+inline HeightView HeightView::Window(int i, int j, int w, int l) const
+{
+  return HeightView(data + size_t(i) * stride + j, w, l, stride);
+}
+
+//! Gets the i-th row of the height field, without copy.
+inline const float* HeightField::operator[](int i) const
+{
+  return height.data() + size_t(i) * length;
+}
+
+//! Returns the i-th row of the height field.
+inline float* HeightField::operator[](int i)
+{
+  return height.data() + size_t(i) * length;
+}
+
+//! Returns a view on the heights.
+inline HeightView HeightField::View() const
+{
+  return HeightView(height.data(), width, length, length);
+}
+
+//! Forget the rectangle modified by brushes, typically once it has been uploaded.
+inline void HeightField::clearDirty()
+{
+  dirty[0] = dirty[1] = 0;
+  dirty[2] = dirty[3] = -1;
+}
+
+/*!
+\brief Get a height.
+\param i, j Integer coordinates.
+*/
+inline float QuantizedHeightField::operator()(int i, int j) const
+{
+  return a + (b - a) * float(height[size_t(i) * length + j]) / 65535.0f;
+}
+
+/*!
+\brief Interleave the bits of local coordinates in a tile.
+\param i, j Coordinates in [0, Tile[.
+*/
+inline int TiledHeightField::Morton(int i, int j)
+{
+  int m = 0;
+  for (int k = 0; (1 << k) < Tile; k++)
+  {
+    m |= ((i >> k) & 1) << (2 * k + 1) | ((j >> k) & 1) << (2 * k);
+  }
+  return m;
+}
+
+/*!
+\brief Compute the index of a height in the storage.
+\param i, j Integer coordinates.
+*/
+inline size_t TiledHeightField::Index(int i, int j) const
+{
+  return (size_t(i / Tile) * tiles + j / Tile) * Tile * Tile + Morton(i % Tile, j % Tile);
+}
+
+/*!
+\brief Get a height.
+\param i, j Integer coordinates.
+*/
+inline float TiledHeightField::operator()(int i, int j) const
+{
+  return height[Index(i, j)];
+}
+
+/*!
+\brief Get the heights of a tile, in Z-order.
+\param ti, tj Tile coordinates.
+*/
+inline const float* TiledHeightField::Heights(int ti, int tj) const
+{
+  return height.data() + (size_t(ti) * tiles + tj) * Tile * Tile;
+}
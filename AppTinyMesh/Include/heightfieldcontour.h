@@ -0,0 +1,58 @@
+// HeightFieldContour
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "heightfield.h"
+
+/*!
+\brief Sequences of edges of a grid, stored one after the other.
+*/
+struct ContourLines
+{
+  std::vector<uint64_t> keys; //!< Edges of the lines.
+  std::vector<int> starts = std::vector<int>(1, 0); //!< First edge of every line, and the end of the last one.
+
+  //! Number of lines.
+  int Size() const { return int(starts.size()) - 1; }
+  //! First edge of a line.
+  uint64_t Front(int i) const { return keys[starts[i]]; }
+  //! Last edge of a line.
+  uint64_t Back(int i) const { return keys[starts[i + 1] - 1]; }
+  //! Terminate the last line.
+  void Close() { starts.push_back(int(keys.size())); }
+  //! Remove all lines, keeping the memory.
+  void Clear() { keys.clear(); starts.resize(1); }
+};
+
+// Contour lines of a height field at several heights
+class HeightFieldContour
+{
+protected:
+  const HeightField& hf;   //!< The height field.
+  double heightMax;        //!< Height scale.
+  double squareSize;       //!< Size of a square of the grid.
+  int width;               //!< Number of rows of the height field.
+  int length;              //!< Number of samples per row.
+  int tw = 0, tl = 0;      //!< Number of tiles.
+  std::vector<int> order;  //!< Indexes of the heights, sorted in increasing order.
+  std::vector<float> iso;  //!< Sorted heights, in units of the height field.
+  std::vector<std::vector<ContourLines>> open;   //!< Pieces of lines ending on the border of every tile, for every sorted height.
+  std::vector<std::vector<ContourLines>> closed; //!< Loops closed inside every tile, for every sorted height.
+public:
+  static const int Tile = 128; //!< Number of squares along the side of a tile.
+
+  explicit HeightFieldContour(const HeightField&, double, double);
+
+  //! Empty.
+  ~HeightFieldContour() {}
+
+  void SetLevels(const std::vector<double>&);
+  void Update(int, int, int, int);
+  std::vector<std::vector<std::vector<Vector>>> Lines() const;
+protected:
+  void Extract(int, std::vector<ContourLines>&, std::vector<int>&);
+  Vector Crossing(uint64_t, float) const;
+};
@@ -0,0 +1,106 @@
+// HeightFieldErosion
+
+#pragma once
+
+#include <vector>
+
+#include "heightfield.h"
+
+// Hydraulic and thermal erosion of a height field, simulated on its grid
+class HeightFieldErosion
+{
+protected:
+  HeightField& hf;                 //!< The eroded height field.
+  int width;                       //!< Number of rows.
+  int length;                      //!< Number of samples per row.
+  double heightMax;                //!< Height scale.
+  double squareSize;               //!< Size of a square of the grid.
+
+  std::vector<float> b, next;      //!< Terrain heights, in world units, and the buffer of the next step.
+  std::vector<float> water;        //!< Water heights.
+  std::vector<float> sediment;     //!< Suspended sediment.
+  std::vector<float> transported;  //!< Buffer of the transported sediment.
+  std::vector<float> flux[4];      //!< Outflow flux toward the neighbors (i-1, j), (i+1, j), (i, j-1) and (i, j+1).
+  std::vector<float> u, v;         //!< Velocity of the water along i and j.
+
+  double dt = 0.02;                //!< Time step.
+  double rain = 0.01;              //!< Water added per unit of time.
+  double gravity = 9.81;           //!< Gravity.
+  double capacity = 1.0;           //!< Sediment capacity.
+  double dissolving = 0.5;         //!< Dissolving rate, per unit of time.
+  double deposition = 0.5;         //!< Deposition rate, per unit of time.
+  double evaporation = 0.015;      //!< Evaporation rate.
+  double tilt = 0.05;              //!< Minimum sine of the slope, so that sediment is carried on flat areas.
+  double talus = 0.6;              //!< Tangent of the angle of repose, for thermal erosion.
+  double thermal = 0.5;            //!< Fraction of the unstable material moved per unit of time.
+public:
+  explicit HeightFieldErosion(HeightField&, double = 1.0, double = 1.0);
+
+  //! Empty.
+  ~HeightFieldErosion() {}
+
+  void SetTimeStep(double);
+  void SetRain(double);
+  void SetSediment(double, double, double);
+  void SetEvaporation(double);
+  void SetThermal(double, double);
+
+  void Hydraulic(int);
+  void Thermal(int);
+
+  const std::vector<float>& Water() const;
+protected:
+  void Flux();
+  void Velocity();
+  void Erode();
+  void Transport();
+  void Store() const;
+};
+
+//! Set the time step of the simulation, which controls its rate.
+inline void HeightFieldErosion::SetTimeStep(double t)
+{
+  dt = t;
+}
+
+//! Set the amount of rain per unit of time.
+inline void HeightFieldErosion::SetRain(double r)
+{
+  rain = r;
+}
+
+/*!
+\brief Set the sediment parameters.
+\param c Capacity.
+\param s Dissolving rate.
+\param d Deposition rate.
+*/
+inline void HeightFieldErosion::SetSediment(double c, double s, double d)
+{
+  capacity = c;
+  dissolving = s;
+  deposition = d;
+}
+
+//! Set the evaporation rate.
+inline void HeightFieldErosion::SetEvaporation(double e)
+{
+  evaporation = e;
+}
+
+/*!
+\brief Set the thermal erosion parameters.
+\param t Tangent of the angle of repose.
+\param r Fraction of the unstable material moved per unit of time.
+*/
+inline void HeightFieldErosion::SetThermal(double t, double r)
+{
+  talus = t;
+  thermal = r;
+}
+
+//! Return the water heights, row after row.
+inline const std::vector<float>& HeightFieldErosion::Water() const
+{
+  return water;
+}
@@ -0,0 +1,33 @@
+// HeightFieldRTIN
+
+#pragma once
+
+#include <vector>
+
+#include "heightfield.h"
+
+// Error bounded triangulation of a height field with right triangulated irregular networks
+class HeightFieldRTIN
+{
+protected:
+  const HeightField& hf;                  //!< The height field.
+  int width;                              //!< Number of rows of the height field.
+  int length;                             //!< Number of samples per row.
+  int tw, tl;                             //!< Number of tiles along the rows and along the columns.
+  std::vector<std::vector<float>> errors; //!< Error of the vertices of every tile, row after row, tile after tile.
+public:
+  static const int Tile = 256;            //!< Number of squares along the side of a tile, a power of two.
+
+  explicit HeightFieldRTIN(const HeightField&);
+
+  //! Empty.
+  ~HeightFieldRTIN() {}
+
+  MeshColor Triangulate(double, double, double, double) const;
+protected:
+  void Level(int, int);
+  void Merge();
+  void Extract(int, float, int, int, int, int, int, int, std::vector<int>&) const;
+  int Outside(int, int, int, int, int, int, int) const;
+  float Exact(int, int, int, int, int, int, int) const;
+};
@@ -0,0 +1,38 @@
+// HeightFieldTracer
+
+#pragma once
+
+#include <vector>
+#include <limits>
+
+#include "heightfield.h"
+#include "ray.h"
+
+// Exact ray intersection with the triangles of a height field, accelerated by a maximum mipmap
+class HeightFieldTracer
+{
+protected:
+  const HeightField& hf;                  //!< The height field.
+  double heightMax;                       //!< Height scale.
+  double squareSize;                      //!< Size of a square of the grid.
+  int width;                              //!< Number of rows of the height field.
+  int length;                             //!< Number of samples per row.
+  float a;                                //!< Lower bound of the heights, exact at construction.
+  std::vector<int> rows, columns;         //!< Number of cells at every level.
+  std::vector<std::vector<float>> levels; //!< Maximum height of the cells of every level, row after row, the last level is a single cell.
+public:
+  explicit HeightFieldTracer(const HeightField&, double, double);
+
+  //! Empty.
+  ~HeightFieldTracer() {}
+
+  void Update(int, int, int, int);
+
+  bool Intersect(const Ray&, double&, double = std::numeric_limits<double>::max()) const;
+  int Intersect(const std::vector<Ray>&, std::vector<double>&) const;
+  bool Visible(const Vector&, const Vector&) const;
+  bool Pick(const Ray&, int&, int&) const;
+protected:
+  void Reduce(int, int, int);
+  bool Cell(int, int, const Vector&, const Vector&, double, double, double&) const;
+};
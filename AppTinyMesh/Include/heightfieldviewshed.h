@@ -0,0 +1,33 @@
+// HeightFieldViewshed
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "heightfield.h"
+
+// Visibility from observers and horizon angles over a height field
+class HeightFieldViewshed
+{
+protected:
+  const HeightField& hf; //!< The height field.
+  double heightMax;      //!< Height scale.
+  double squareSize;     //!< Size of a square of the grid.
+  int width;             //!< Number of rows of the height field.
+  int length;            //!< Number of samples per row.
+public:
+  explicit HeightFieldViewshed(const HeightField&, double, double);
+
+  //! Empty.
+  ~HeightFieldViewshed() {}
+
+  std::vector<uint8_t> Viewshed(int, int, double, double = 0.0) const;
+  std::vector<float> Horizon(int) const;
+  std::vector<float> SkyView() const;
+
+  static void Tint(MeshColor&, const std::vector<uint8_t>&, const Color&, double = 0.5);
+  static void Shade(MeshColor&, const std::vector<float>&);
+protected:
+  static const int Directions[8][2]; //!< Directions of the horizons, one sample along the rows and the columns.
+};
@@ -20,6 +20,10 @@ public:
   // Dichotomy
   Vector Dichotomy(Vector, Vector, double, double, double, const double& = 1.0e-4) const;
 
+  // Ray tracing
+  virtual double K() const;
+  bool SphereTrace(const Ray&, double, double, double&, const double& = 1.0e-4) const;
+
   virtual void Polygonize(int, Mesh&, const Box&, const double& = 1e-4) const;
 protected:
   static const double Epsilon; //!< Epsilon value for partial derivatives
@@ -0,0 +1,67 @@
+// KdTree
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include "box.h"
+
+// Static kd-tree of points
+class KdTree
+{
+protected:
+  //! Node of the tree. Leaves reference a range of points, inner nodes their two consecutive children.
+  struct Node
+  {
+    float split; //!< Coordinate of the splitting plane.
+    int axis;    //!< Splitting axis, -1 for leaves.
+    int index;   //!< First point for leaves, first child for inner nodes.
+    int count;   //!< Number of points in leaves.
+  };
+
+  std::vector<Node> nodes; //!< Nodes, the root is the first one.
+  std::vector<float> p[3]; //!< Coordinates of the points sorted in leaf order.
+  std::vector<int> id;     //!< Original index of the points sorted in leaf order.
+public:
+  //! Empty.
+  KdTree() {}
+  explicit KdTree(const std::vector<Vector>&);
+
+  //! Empty.
+  ~KdTree() {}
+
+  int Size() const;
+  const std::vector<int>& Order() const;
+
+  int Nearest(const Vector&, double&) const;
+  int KNearest(const Vector&, int, std::vector<int>&, std::vector<double>&) const;
+  int Radius(const Vector&, double, std::vector<int>&) const;
+
+  // Batch queries
+  void KNearest(const std::vector<Vector>&, int, std::vector<int>&, std::vector<double>&) const;
+  std::vector<std::vector<int>> Radius(const std::vector<Vector>&, double) const;
+protected:
+  void Build(int, int, int, const std::vector<Vector>&, std::atomic<int>&);
+  void Scan(const Node&, const Vector&, float*) const;
+public:
+  static const int Leaf = 16; //!< Maximum number of points in a leaf.
+};
+
+/*!
+\brief Return the number of points.
+*/
+inline int KdTree::Size() const
+{
+  return int(id.size());
+}
+
+/*!
+\brief Return the indexes of the points sorted in leaf order.
+
+Processing points in this order makes consecutive queries spatially coherent, which improves cache usage.
+*/
+inline const std::vector<int>& KdTree::Order() const
+{
+  return id;
+}
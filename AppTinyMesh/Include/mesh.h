@@ -11,6 +11,8 @@
 #include "mathematics.h"
 #include "matrix.h"
 
+class KdTree;
+
 // Triangle
 class Triangle
 {
@@ -32,6 +34,9 @@ public:
   // Intersection
   bool Intersect(const Ray&, double&, double&, double&) const;
 
+  // Distance
+  Vector Closest(const Vector&, double&, double&) const;
+
   void Translate(const Vector&);
 
   // Geometry
@@ -98,8 +103,14 @@ public:
   explicit Mesh();
   explicit Mesh(const std::vector<Vector>&, const std::vector<int>&);
   explicit Mesh(const std::vector<Vector>&, const std::vector<Vector>&, const std::vector<int>&, const std::vector<int>&);
+  explicit Mesh(std::vector<Vector>&&, std::vector<Vector>&&, std::vector<int>&&, std::vector<int>&&);
   ~Mesh();
 
+  Mesh(const Mesh&) = default;
+  Mesh(Mesh&&) = default;
+  Mesh& operator=(const Mesh&) = default;
+  Mesh& operator=(Mesh&&) = default;
+
   void Reserve(int, int, int, int);
 
   Triangle GetTriangle(int) const;
@@ -136,6 +147,7 @@ public:
   void Translate(const Vector& v);
   void Merge(const Mesh&);
   void SphereWarp(const Vector& center, double radius, const Vector& direction);
+  void SphereWarp(const KdTree&, const Vector&, double, const Vector&);
 
   void Load(const QString&);
   void SaveObj(const QString&, const QString&) const;
@@ -0,0 +1,84 @@
+// MeshAnalysis
+
+#pragma once
+
+#include <string>
+
+#include "mesh.h"
+
+// Quality and validity report of a mesh
+class MeshAnalysis
+{
+public:
+  static const int Bins = 20; //!< Number of bins of the quality histograms.
+protected:
+  int vertices;                //!< Number of vertices.
+  int triangles;               //!< Number of triangles.
+  long long invalid;           //!< Triangles with out of range vertex indexes.
+  long long degenerate;        //!< Triangles with repeated vertices or null area.
+  long long duplicate;         //!< Triangles with the same vertices as another one.
+  long long edges;             //!< Number of distinct edges.
+  long long boundary;          //!< Edges with a single incident triangle.
+  long long nonManifold;       //!< Edges with more than two incident triangles.
+  long long inconsistent;      //!< Manifold edges whose triangles have opposite orientations.
+  int loops;                   //!< Number of boundary loops.
+  double area;                 //!< Total area.
+  double volume;               //!< Signed enclosed volume.
+  Vector centroid;             //!< Centroid of the volume, or of the surface if the volume is null.
+  Box box;                     //!< Bounding box of the referenced vertices.
+  double aspect[3];            //!< Minimum, maximum and mean aspect ratio.
+  double angle;                //!< Minimum angle, in degrees.
+  long long aspectHistogram[Bins]; //!< Aspect ratios in [0, 1].
+  long long angleHistogram[Bins];  //!< Smallest angle of the triangles in [0, 60] degrees.
+  double seconds;              //!< Analysis time.
+public:
+  explicit MeshAnalysis(const Mesh&);
+
+  //! Empty.
+  ~MeshAnalysis() {}
+
+  bool IsClosed() const;
+  bool IsManifold() const;
+  double Area() const;
+  double Volume() const;
+  Vector Centroid() const;
+
+  std::string Json() const;
+protected:
+  void Geometry(const Mesh&);
+  void Topology(const Mesh&);
+};
+
+/*!
+\brief Check whether the mesh is closed, i.e., has no boundary edges.
+*/
+inline bool MeshAnalysis::IsClosed() const
+{
+  return boundary == 0;
+}
+
+/*!
+\brief Check whether the mesh is an edge-manifold.
+*/
+inline bool MeshAnalysis::IsManifold() const
+{
+  return nonManifold == 0;
+}
+
+//! Return the total area.
+inline double MeshAnalysis::Area() const
+{
+  return area;
+}
+
+//! Return the signed volume, positive for closed outward oriented meshes.
+inline double MeshAnalysis::Volume() const
+{
+  return volume;
+}
+
+//! Return the centroid.
+inline Vector MeshAnalysis::Centroid() const
+{
+  return centroid;
+}
@@ -14,11 +14,19 @@ public:
   explicit MeshColor();
   explicit MeshColor(const Mesh&);
   explicit MeshColor(const Mesh&, const std::vector<Color>&, const std::vector<int>&);
+  explicit MeshColor(Mesh&&, std::vector<Color>&&, std::vector<int>&&);
   ~MeshColor();
 
+  MeshColor(const MeshColor&) = default;
+  MeshColor(MeshColor&&) = default;
+  MeshColor& operator=(const MeshColor&) = default;
+  MeshColor& operator=(MeshColor&&) = default;
+
   Color GetColor(int) const;
+  void SetColor(int, const Color&);
   std::vector<Color> GetColors() const;
   std::vector<int> ColorIndexes() const;
+  int ColorIndex(int, int) const;
 };
 
 /*!
@@ -31,6 +39,16 @@ inline Color MeshColor::GetColor(int i) const
   return colors[i];
 }
 
+/*!
+\brief Set a color.
+\param i The index of the color.
+\param c The color.
+*/
+inline void MeshColor::SetColor(int i, const Color& c)
+{
+  colors[i] = c;
+}
+
 /*!
 \brief Get the array of colors.
 */
@@ -47,4 +65,14 @@ inline std::vector<int> MeshColor::ColorIndexes() const
   return carray;
 }
 
+/*!
+\brief Get the index of the color of a vertex of a triangle.
+\param t Triangle index.
+\param i Vertex index.
+*/
+inline int MeshColor::ColorIndex(int t, int i) const
+{
+  return carray[t * 3 + i];
+}
+
 #endif
@@ -0,0 +1,87 @@
+// MeshComponents
+
+#pragma once
+
+#include <vector>
+
+#include "mesh.h"
+
+// Connected components of the triangles of a mesh
+class MeshComponents
+{
+protected:
+  std::vector<int> label;    //!< Component of every triangle.
+  std::vector<int> order;    //!< Triangles sorted by component.
+  std::vector<int> start;    //!< Start of the components in the sorted triangles, with the number of triangles as last entry.
+  std::vector<Box> boxes;    //!< Bounding boxes of the components.
+  std::vector<double> areas; //!< Areas of the components.
+public:
+  explicit MeshComponents(const Mesh&);
+
+  //! Empty.
+  ~MeshComponents() {}
+
+  int Size() const;
+  int Component(int) const;
+  int Triangles(int) const;
+  const int* Indexes(int) const;
+  Box GetBox(int) const;
+  double Area(int) const;
+
+  Mesh Extract(const Mesh&, const std::vector<int>&) const;
+  std::vector<Mesh> Split(const Mesh&) const;
+  Mesh Remove(const Mesh&, int, double = 0.0) const;
+};
+
+/*!
+\brief Return the number of components.
+*/
+inline int MeshComponents::Size() const
+{
+  return int(boxes.size());
+}
+
+/*!
+\brief Return the component of a triangle.
+\param t Triangle index.
+*/
+inline int MeshComponents::Component(int t) const
+{
+  return label[t];
+}
+
+/*!
+\brief Return the number of triangles of a component.
+\param c Component.
+*/
+inline int MeshComponents::Triangles(int c) const
+{
+  return start[c + 1] - start[c];
+}
+
+/*!
+\brief Return the triangle indexes of a component, sorted in increasing order.
+\param c Component.
+*/
+inline const int* MeshComponents::Indexes(int c) const
+{
+  return order.data() + start[c];
+}
+
+/*!
+\brief Return the bounding box of a component.
+\param c Component.
+*/
+inline Box MeshComponents::GetBox(int c) const
+{
+  return boxes[c];
+}
+
+/*!
+\brief Return the area of a component.
+\param c Component.
+*/
+inline double MeshComponents::Area(int c) const
+{
+  return areas[c];
+}
@@ -0,0 +1,68 @@
+// MeshDistance
+
+#pragma once
+
+#include "bvh.h"
+#include "implicits.h"
+
+// Distance queries to a triangle mesh
+class MeshDistance
+{
+protected:
+  Mesh mesh;                         //!< The mesh.
+  BVH bvh;                           //!< Hierarchy of the triangles.
+  std::vector<Vector> faceNormals;   //!< Unit normals of the triangles.
+  std::vector<Vector> vertexNormals; //!< Angle weighted pseudo-normals of the vertices.
+  std::vector<Vector> edgeNormals;   //!< Pseudo-normals of the edges, three per triangle.
+public:
+  explicit MeshDistance(const Mesh&);
+
+  //! Empty.
+  ~MeshDistance() {}
+
+  int Closest(const Vector&, double&, double&, double&) const;
+  double Distance(const Vector&) const;
+  double Signed(const Vector&) const;
+  Vector Gradient(const Vector&) const;
+
+  // Batch queries
+  void Closest(const std::vector<Vector>&, std::vector<int>&, std::vector<double>&, std::vector<double>&, std::vector<double>&) const;
+  std::vector<double> Distance(const std::vector<Vector>&) const;
+  std::vector<double> Signed(const std::vector<Vector>&) const;
+
+  Box GetBox() const;
+  const Mesh& GetMesh() const;
+protected:
+  Vector PseudoNormal(int, double, double) const;
+};
+
+// Signed distance field of a closed triangle mesh
+class SignedDistanceField : public AnalyticScalarField
+{
+protected:
+  MeshDistance distance; //!< Distance queries.
+public:
+  explicit SignedDistanceField(const Mesh&);
+
+  double Value(const Vector&) const override;
+  Vector Gradient(const Vector&) const override;
+  double K() const override;
+
+  Box GetBox() const;
+};
+
+/*!
+\brief Return the mesh.
+*/
+inline const Mesh& MeshDistance::GetMesh() const
+{
+  return mesh;
+}
+
+/*!
+\brief Return the bounding box of the mesh.
+*/
+inline Box MeshDistance::GetBox() const
+{
+  return mesh.GetBox();
+}
@@ -0,0 +1,37 @@
+// MeshSlicer
+
+#pragma once
+
+#include <vector>
+
+#include "mesh.h"
+
+// Plane cross sections of a triangle mesh
+class MeshSlicer
+{
+protected:
+  std::vector<double> x, y, z; //!< Coordinates of the vertices.
+  std::vector<int> va;         //!< Vertex indexes of the triangles.
+  Box box;                     //!< Bounding box of the mesh.
+public:
+  explicit MeshSlicer(const Mesh&);
+
+  //! Empty.
+  ~MeshSlicer() {}
+
+  std::vector<std::vector<Vector>> Slice(const Vector&, const Vector&) const;
+  void Cut(const Vector&, const Vector&, Mesh&, Mesh&) const;
+
+  Box GetBox() const;
+protected:
+  void Distances(const Vector&, const Vector&, std::vector<double>&, std::vector<char>&) const;
+  Vector Crossing(int, int, const std::vector<double>&) const;
+};
+
+/*!
+\brief Return the bounding box of the mesh.
+*/
+inline Box MeshSlicer::GetBox() const
+{
+  return box;
+}
@@ -0,0 +1,190 @@
+// Packet
+
+#pragma once
+
+#include <vector>
+
+#include "mesh.h"
+
+// Triangles stored as structure of arrays
+class TrianglePacket
+{
+protected:
+  int n = 0; //!< Number of triangles.
+  std::vector<float> p[3]; //!< First vertex, per coordinate.
+  std::vector<float> e[6]; //!< Edge vectors p1-p0 and p2-p0, per coordinate.
+public:
+  //! Empty.
+  TrianglePacket() {}
+  explicit TrianglePacket(const std::vector<Triangle>&);
+  explicit TrianglePacket(const Mesh&);
+
+  //! Empty.
+  ~TrianglePacket() {}
+
+  void Reserve(int);
+  void Append(const Triangle&);
+  void Clear();
+
+  int Size() const;
+  const float* Edge(int) const;
+  const float* Origin(int) const;
+};
+
+// Rays stored as structure of arrays
+class RayPacket
+{
+protected:
+  int n = 0; //!< Number of rays.
+  std::vector<float> o[3]; //!< Origins.
+  std::vector<float> d[3]; //!< Directions.
+  std::vector<float> inv[3]; //!< Inverse of the directions, for slab tests.
+public:
+  //! Empty.
+  RayPacket() {}
+  explicit RayPacket(const std::vector<Ray>&);
+
+  //! Empty.
+  ~RayPacket() {}
+
+  void Reserve(int);
+  void Append(const Ray&);
+  void Clear();
+
+  int Size() const;
+  const float* Origin(int) const;
+  const float* Direction(int) const;
+  const float* InverseDirection(int) const;
+};
+
+// Axis aligned boxes stored as structure of arrays
+class BoxPacket
+{
+protected:
+  int n = 0; //!< Number of boxes.
+  std::vector<float> a[3]; //!< Lower vertices.
+  std::vector<float> b[3]; //!< Upper vertices.
+public:
+  //! Empty.
+  BoxPacket() {}
+  explicit BoxPacket(const std::vector<Box>&);
+
+  //! Empty.
+  ~BoxPacket() {}
+
+  void Reserve(int);
+  void Append(const Box&);
+  void Clear();
+
+  int Size() const;
+  const float* Lower(int) const;
+  const float* Upper(int) const;
+};
+
+// Packet intersection kernels
+class Packet
+{
+public:
+  //! Instruction sets the kernels are compiled for.
+  enum class Isa
+  {
+    Scalar = 0,
+    SSE = 1,
+    AVX2 = 2,
+  };
+
+  static Isa Detect();
+  static Isa Current();
+  static void Select(Isa);
+  static int Width();
+  static const char* Name(Isa);
+
+  // One ray, many triangles
+  static int Intersect(const Ray&, const TrianglePacket&, double&, double&, double&, double = Packet::Infinity);
+  static int Intersect(const Ray&, const TrianglePacket&, int, int, double&, double&, double&, double = Packet::Infinity);
+  static bool Occluded(const Ray&, const TrianglePacket&, double);
+
+  // Many rays, one triangle
+  static int Intersect(const RayPacket&, const Triangle&, float*, float*, float*);
+
+  // Many rays, many boxes
+  static int Intersect(const RayPacket&, const BoxPacket&, float*, float*);
+  static int Intersect(const Ray&, const BoxPacket&, float*, double = Packet::Infinity);
+
+public:
+  static const float epsilon; //!< Internal epsilon for determinant tests.
+  static const double Infinity; //!< Distance returned for missed intersections.
+  static const int Lanes = 8; //!< Storage padding, the widest register width.
+};
+
+/*!
+\brief Return the number of triangles.
+*/
+inline int TrianglePacket::Size() const
+{
+  return n;
+}
+
+/*!
+\brief Return the i-th coordinate of the first vertices.
+\param i Coordinate index.
+*/
+inline const float* TrianglePacket::Origin(int i) const
+{
+  return p[i].data();
+}
+
+/*!
+\brief Return the i-th coordinate of the edges, first edge for i in [0,2], second for i in [3,5].
+\param i Coordinate index.
+*/
+inline const float* TrianglePacket::Edge(int i) const
+{
+  return e[i].data();
+}
+
+/*!
+\brief Return the number of rays.
+*/
+inline int RayPacket::Size() const
+{
+  return n;
+}
+
+//! Return the i-th coordinate of the origins.
+inline const float* RayPacket::Origin(int i) const
+{
+  return o[i].data();
+}
+
+//! Return the i-th coordinate of the directions.
+inline const float* RayPacket::Direction(int i) const
+{
+  return d[i].data();
+}
+
+//! Return the i-th coordinate of the inverse directions.
+inline const float* RayPacket::InverseDirection(int i) const
+{
+  return inv[i].data();
+}
+
+/*!
+\brief Return the number of boxes.
+*/
+inline int BoxPacket::Size() const
+{
+  return n;
+}
+
+//! Return the i-th coordinate of the lower vertices.
+inline const float* BoxPacket::Lower(int i) const
+{
+  return a[i].data();
+}
+
+//! Return the i-th coordinate of the upper vertices.
+inline const float* BoxPacket::Upper(int i) const
+{
+  return b[i].data();
+}
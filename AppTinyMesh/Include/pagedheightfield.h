@@ -0,0 +1,99 @@
+// PagedHeightField
+
+#pragma once
+
+#include <vector>
+#include <list>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include <QtCore/QFile>
+
+#include "heightfield.h"
+
+// Height field stored on disk in tiles of 16 bit heights, paged in memory on demand
+class PagedHeightField
+{
+public:
+  static const int Tile = 256; //!< Size of the tiles.
+protected:
+  // Decoded tile
+  struct Page
+  {
+    std::vector<float> height;       //!< Heights, row after row.
+    bool dirty = false;              //!< Modified since it was decoded.
+    std::list<int>::iterator recent; //!< Position in the list of recently used tiles.
+  };
+
+  QFile file;                     //!< Tiled file.
+  uchar* data = nullptr;          //!< Mapped file.
+  bool writable = false;          //!< Modified tiles can be written back.
+  int width = 0;                  //!< Number of rows.
+  int length = 0;                 //!< Number of heights per row.
+  int rows = 0;                   //!< Number of rows of tiles.
+  int columns = 0;                //!< Number of tiles per row of tiles.
+  float a = 0.0f, b = 1.0f;       //!< Range of the quantized heights.
+  size_t budget;                  //!< Maximal number of decoded tiles.
+
+  mutable std::mutex mutex;       //!< Protects the cache and the mapped file.
+  std::unordered_map<int, Page> pages; //!< Decoded tiles.
+  std::list<int> recent;          //!< Decoded tiles, most recently used first.
+
+  std::thread prefetcher;         //!< Background loading of tiles.
+  std::condition_variable wakeup; //!< Signals requests to the prefetcher.
+  std::deque<int> requests;       //!< Tiles to prefetch, most urgent first.
+  bool stop = false;              //!< Ends the prefetcher.
+public:
+  explicit PagedHeightField(const QString&, size_t = size_t(512) << 20);
+  ~PagedHeightField();
+
+  static bool Write(const QString&, const HeightView&);
+  static bool Write(const QString&, const QString&, int = 0, int = 0);
+
+  bool IsOpen() const;
+  int getWidth() const;
+  int getLength() const;
+
+  float Height(int, int);
+  HeightField Window(int, int, int, int);
+  MeshColor generateSmoothMesh(int, int, int, int, double, double, double);
+  Color generateColor(int, int, double);
+  void flatten(int, int, double, double, double);
+
+  void Prefetch(const Vector&, double, double);
+  void Flush();
+  size_t Memory() const;
+protected:
+  Page& Load(int);
+  float Sample(int, int);
+  void Store(int, const Page&);
+  void Run();
+};
+
+/*!
+\brief Check if the file was opened and mapped.
+*/
+inline bool PagedHeightField::IsOpen() const
+{
+  return data != nullptr;
+}
+
+/*!
+\brief Get the width.
+*/
+inline int PagedHeightField::getWidth() const
+{
+  return width;
+}
+
+/*!
+\brief Get the length.
+*/
+inline int PagedHeightField::getLength() const
+{
+  return length;
+}
@@ -0,0 +1,80 @@
+// Parse
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+/*!
+\brief Parse a real number.
+\param s, end Characters, end excluded.
+\param f Returned value.
+\return Position after the number, nullptr if there is no number.
+*/
+inline const char* ParseReal(const char* s, const char* end, float& f)
+{
+  static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+  bool negative = false;
+  if (s < end && (*s == '-' || *s == '+'))
+  {
+    negative = (*s == '-');
+    s++;
+  }
+
+  // Mantissa, further digits only change the exponent
+  uint64_t m = 0;
+  int e = 0;
+  int digits = 0;
+  for (; s < end && unsigned(*s - '0') < 10; s++, digits++)
+  {
+    if (m < 100000000000000000ULL)
+      m = m * 10 + (*s - '0');
+    else
+      e++;
+  }
+  if (s < end && *s == '.')
+  {
+    for (s++; s < end && unsigned(*s - '0') < 10; s++, digits++)
+    {
+      if (m < 100000000000000000ULL)
+      {
+        m = m * 10 + (*s - '0');
+        e--;
+      }
+    }
+  }
+  if (digits == 0)
+    return nullptr;
+
+  if (s < end && (*s == 'e' || *s == 'E'))
+  {
+    const char* t = s + 1;
+    bool ne = false;
+    if (t < end && (*t == '-' || *t == '+'))
+    {
+      ne = (*t == '-');
+      t++;
+    }
+    if (t < end && unsigned(*t - '0') < 10)
+    {
+      int x = 0;
+      for (; t < end && unsigned(*t - '0') < 10; t++)
+      {
+        x = std::min(x * 10 + (*t - '0'), 1000);
+      }
+      e += ne ? -x : x;
+      s = t;
+    }
+  }
+
+  double v = double(m);
+  if (e < 0)
+    v = (e >= -22) ? v / powers[-e] : v * pow(10.0, e);
+  else if (e > 0)
+    v = (e <= 22) ? v * powers[e] : v * pow(10.0, e);
+
+  f = float(negative ? -v : v);
+  return s;
+}
@@ -0,0 +1,78 @@
+// PathTracer
+
+#pragma once
+
+#include <QtGui/QImage>
+
+#include "bvh.h"
+#include "camera.h"
+#include "meshcolor.h"
+
+// Offline tile-based path tracer for mesh scenes
+class PathTracer
+{
+protected:
+  std::vector<Triangle> triangles; //!< Triangles of all the objects of the scene.
+  std::vector<Color> colors;       //!< Colors at the vertices of the triangles, three per triangle.
+  BVH bvh;                         //!< Hierarchy of the triangles.
+  bool dirty = false;              //!< Whether the hierarchy should be rebuilt.
+
+  Camera camera;                   //!< Camera.
+  int width, height;               //!< Image size.
+  std::vector<Color> accumulation; //!< Sum of the samples of every pixel.
+  int samples = 0;                 //!< Number of samples per pixel accumulated so far.
+
+  int depth = 4;                   //!< Maximum number of bounces.
+  Vector sun = Normalized(Vector(0.4, 0.3, 1.0)); //!< Direction toward the sun.
+  Color light = Color(1.4, 1.35, 1.25); //!< Radiance of the sun.
+
+  long long rays = 0;              //!< Number of rays cast so far.
+  double seconds = 0.0;            //!< Rendering time so far.
+public:
+  explicit PathTracer(int, int);
+
+  //! Empty.
+  ~PathTracer() {}
+
+  void Add(const Mesh&, const Color& = Color(0.8, 0.8, 0.8));
+  void Add(const MeshColor&);
+  void SetCamera(const Camera&);
+  void SetDepth(int);
+  void SetSun(const Vector&, const Color&);
+  void Reset();
+
+  void Render(int = 1);
+
+  int Samples() const;
+  QImage GetImage() const;
+  bool Save(const QString&) const;
+
+  long long Rays() const;
+  double RaysPerSecond() const;
+  double RaysPerSecondPerCore() const;
+  static int Threads();
+protected:
+  void RenderTile(int, int, int, long long&);
+  Color Radiance(const Ray&, unsigned int&, long long&) const;
+  Color Sky(const Vector&) const;
+  static double Random(unsigned int&);
+  static unsigned int Hash(unsigned int);
+public:
+  static const int Tile = 32; //!< Size of the tiles distributed to the threads.
+};
+
+/*!
+\brief Return the number of samples per pixel accumulated so far.
+*/
+inline int PathTracer::Samples() const
+{
+  return samples;
+}
+
+/*!
+\brief Return the number of rays cast so far, including shadow rays.
+*/
+inline long long PathTracer::Rays() const
+{
+  return rays;
+}
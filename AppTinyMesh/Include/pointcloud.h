@@ -0,0 +1,96 @@
+// PointCloud
+
+#pragma once
+
+#include <vector>
+
+#include <QtCore/QString>
+
+#include "implicits.h"
+#include "kdtree.h"
+
+// Point cloud stored as structure of arrays
+class PointCloud
+{
+protected:
+  std::vector<float> x, y, z;    //!< Coordinates of the points.
+  std::vector<float> nx, ny, nz; //!< Normals, empty if not available.
+public:
+  //! Empty.
+  PointCloud() {}
+  explicit PointCloud(const std::vector<Vector>&);
+
+  //! Empty.
+  ~PointCloud() {}
+
+  bool Load(const QString&);
+
+  int Size() const;
+  bool HasNormals() const;
+  Vector Point(int) const;
+  Vector Normal(int) const;
+  std::vector<Vector> Points() const;
+  Box GetBox() const;
+
+  void EstimateNormals(int = 16);
+protected:
+  bool LoadXYZ(const char*, const char*);
+  bool LoadPLY(const char*, const char*);
+  bool ParseAscii(const char*, const char*, const std::vector<int>&, int);
+  void Orient(const std::vector<int>&, int);
+  void NormalizeNormals();
+  static Vector Smallest(const double[6]);
+};
+
+// Implicit surface reconstructed from oriented points
+class PointSetField : public AnalyticScalarField
+{
+protected:
+  PointCloud cloud;        //!< Oriented points.
+  KdTree tree;             //!< Index of the points.
+  std::vector<float> r;    //!< Support radius of every point.
+  double radius;           //!< Largest support radius.
+  KdTree coarse;           //!< Index of a subset of the points, used far from the surface.
+  std::vector<int> subset; //!< Indexes of the points of the subset.
+public:
+  explicit PointSetField(const PointCloud&, int = 8, double = 2.0);
+
+  double Value(const Vector&) const override;
+  Box GetBox() const;
+};
+
+/*!
+\brief Return the number of points.
+*/
+inline int PointCloud::Size() const
+{
+  return int(x.size());
+}
+
+/*!
+\brief Check whether the points have normals.
+*/
+inline bool PointCloud::HasNormals() const
+{
+  return !nx.empty();
+}
+
+/*!
+\brief Return a point.
+\param i Index.
+*/
+inline Vector PointCloud::Point(int i) const
+{
+  return Vector(x[i], y[i], z[i]);
+}
+
+/*!
+\brief Return the normal of a point, the null vector if the cloud has no normals.
+\param i Index.
+*/
+inline Vector PointCloud::Normal(int i) const
+{
+  if (nx.empty())
+    return Vector::Null;
+  return Vector(nx[i], ny[i], nz[i]);
+}
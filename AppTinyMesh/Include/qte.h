@@ -5,6 +5,9 @@
 #include "realtime.h"
 #include "meshcolor.h"
 #include "heightfield.h"
+#include "heightfieldtracer.h"
+#include "heightfieldcontour.h"
+#include "pointcloud.h"
 
 QT_BEGIN_NAMESPACE
 	namespace Ui { class Assets; }
@@ -18,9 +21,12 @@ private:
 
   MeshWidget* meshWidget;   //!< Viewer
   MeshColor meshColor;		//!< Mesh.
+  PointCloud cloud;		//!< Point cloud.
   int rotation;
 
   HeightField hf;
+  HeightFieldTracer* tracer = nullptr; //!< Picking on the height field.
+  HeightFieldContour* contour = nullptr; //!< Contour lines of the height field.
   Mesh heightFieldPlane;
   int resolution;
   int widthSize;
@@ -30,6 +36,8 @@ private:
   int flattenY;
   int flattenRadius;
 
+  void UpdateHeightField();
+  void UpdateContours();
 public:
   MainWindow();
   ~MainWindow();
@@ -47,6 +55,7 @@ public slots:
   void CapsuleMeshExample();
   void MergedMeshExample();
   void DeformedMeshExample();
+  void LoadPointCloud();
   void GenerateHeightField();
   void SphereImplicitExample();
   void ResetCamera();
@@ -7,6 +7,9 @@
 
 #include "mesh.h"
 #include "meshcolor.h"
+#include "pointcloud.h"
+#include "meshslicer.h"
+#include "terrainquadtree.h"
 
 #include <QtCore/QMap>
 
@@ -98,9 +101,13 @@ protected:
   public:
     bool enabled;				//!< Render flag. Mesh is not rendered if enabled equals false.
     GLuint vao;					//!< Mesh VAO.
-    GLuint fullBuffer;			//!< Mesh buffer. Contains 3D normals, 2D vertices and heights.
+    GLuint fullBuffer;			//!< Mesh buffer. Contains interleaved vertices, octahedral normals and colors.
     GLuint indexBuffer;			//!< Mesh index buffer.
-    int triangleCount;			//!< Triangle count to draw.
+    GLenum indexType;			//!< Type of the indexes, 16 or 32 bits.
+    int triangleCount;			//!< Index count to draw, three per triangle.
+    size_t bytes;				//!< Size of the vertex and index buffers.
+    size_t deindexedBytes;		//!< Size of separate float arrays with one vertex per corner, for comparison.
+    int pointCount;				//!< Point count to draw, 0 for triangle meshes.
     float TRSMatrix[16];		//!< Translation-Rotation-Scale Matrix.
     Box bbox;					//!< Bounding box of the mesh.
 
@@ -112,9 +119,41 @@ protected:
     MeshGL();
     MeshGL(const Mesh& mesh, const Vector& position = Vector::Null);
     MeshGL(const MeshColor& mesh, const Vector& position = Vector::Null);
+    MeshGL(const PointCloud& cloud, const Vector& position = Vector::Null);
 
     void Delete();
     void SetFrame(const Vector& position);
+  protected:
+    void Upload(const Mesh&, const MeshColor*);
+  };
+
+  class TerrainGL
+  {
+  public:
+    GLuint vao;					//!< Patch VAO.
+    GLuint vertexBuffer;		//!< Local coordinates of the vertices of a patch.
+    GLuint instanceBuffer;		//!< Origin, step and skirt depth of the selected patches.
+    GLuint indexBuffer;			//!< Triangles of a patch.
+    GLuint texture;				//!< Heights.
+    int width, length;			//!< Size of the height field.
+    int indexCount;				//!< Index count of a patch.
+    int instanceCount;			//!< Patch count to draw.
+    double tolerance;			//!< Maximal screen space error, in pixels.
+    TerrainQuadtree quadtree;	//!< Levels of detail of the patches.
+    std::vector<TerrainQuadtree::Tile> tiles; //!< Selected patches.
+    float heightMax;			//!< Height scale.
+    float squareSize;			//!< Size of a square of the grid.
+    float slope;				//!< Slope coefficient of the coloring.
+    Box bbox;					//!< Bounding box of the terrain.
+    MeshMaterial material;		//!< Render flag.
+
+    static const int Patch = 32;	//!< Number of squares along the side of a patch.
+  public:
+    TerrainGL(const HeightField&, double, double, double, GLuint);
+
+    void Update(const HeightField&, int, int, int, int);
+    void Select(const Camera&, int, int);
+    void Delete();
   };
 
   typedef QMap<QString, MeshGL*>::iterator MeshIterator;
@@ -134,6 +173,28 @@ protected:
   GLuint mainShaderProgram;
   QMap<QString, MeshGL*> objects;
 
+  // Point clouds
+  GLuint pointShaderProgram = 0;
+  float pointSize = 2.0f;
+
+  // Terrain
+  GLuint terrainShaderProgram = 0;
+  TerrainGL* terrain = nullptr;
+
+  // Slice plane
+  MeshSlicer* slicer = nullptr;
+  Vector sliceNormal = Vector::Z;
+  double sliceOffset = 0.0;
+  GLuint sliceVAO = 0;
+  GLuint sliceBuffer = 0;
+  int sliceVertexCount = 0;
+
+  // Contour lines
+  GLuint contourVAO = 0;
+  GLuint contourBuffer = 0;
+  std::vector<GLint> contourFirsts;
+  std::vector<GLsizei> contourCounts;
+
   // Skybox
   GLuint skyboxShader = 0;
   GLuint skyboxVAO = 0;
@@ -147,6 +208,7 @@ public:
 
   void AddMesh(const QString&, const Mesh&, const Vector & = Vector::Null);
   void AddMesh(const QString&, const MeshColor&, const Vector & = Vector::Null);
+  void AddPoints(const QString&, const PointCloud&, const Vector & = Vector::Null);
   void DeleteMesh(const QString&);
   void ClearAll();
 
@@ -168,9 +230,18 @@ public:
   void UseWireframeGlobal(bool);
   void SetShading(const QString&, MeshShading);
   void SetShadingGlobal(MeshShading);
+  void SetPointSize(double);
+  void SetSlice(const Mesh&, const Vector& = Vector::Z);
+  void SetTerrain(const HeightField&, double, double, double);
+  void UpdateTerrain(const HeightField&, int, int, int, int);
+  void ClearTerrain();
+  void ClearSlice();
+  void SetContours(const std::vector<std::vector<Vector>>&);
+  void ClearContours();
 
 private:
   void _InternalGetMouseGlobalPosition(QMouseEvent* e, int& x0, int& y0) const;
+  void UpdateSlice();
 
 protected:
   virtual void initializeGL();
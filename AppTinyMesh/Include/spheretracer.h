@@ -0,0 +1,60 @@
+// SphereTracer
+
+#pragma once
+
+#include <QtGui/QImage>
+
+#include "camera.h"
+#include "color.h"
+#include "implicits.h"
+#include "packet.h"
+
+// Direct renderer of implicit surfaces
+class SphereTracer
+{
+protected:
+  const AnalyticScalarField& field; //!< The field.
+  Box box;                          //!< Box enclosing the surface.
+  double epsilon = 1.0e-4;          //!< Precision of the intersections.
+
+  Vector sun = Normalized(Vector(0.4, 0.3, 1.0)); //!< Direction toward the sun.
+  bool shadows = true;              //!< Trace shadow rays.
+
+  long long rays = 0;               //!< Number of rays traced by the last rendering.
+  double seconds = 0.0;             //!< Time of the last rendering.
+public:
+  explicit SphereTracer(const AnalyticScalarField&, const Box&);
+
+  //! Empty.
+  ~SphereTracer() {}
+
+  void SetEpsilon(double);
+  void SetShadows(bool);
+
+  QImage Render(const Camera&, int, int);
+
+  long long Rays() const;
+  double Seconds() const;
+protected:
+  void RenderTile(const Camera&, int, int, int, int, const BoxPacket&, QRgb*, long long&) const;
+  Color Shade(const Ray&, double, long long&) const;
+  Color Background(const Vector&) const;
+public:
+  static const int Tile = 16; //!< Size of the tiles, tiles are traced as ray packets.
+};
+
+/*!
+\brief Return the number of rays traced by the last rendering, including shadow rays.
+*/
+inline long long SphereTracer::Rays() const
+{
+  return rays;
+}
+
+/*!
+\brief Return the time of the last rendering, in seconds.
+*/
+inline double SphereTracer::Seconds() const
+{
+  return seconds;
+}
@@ -0,0 +1,82 @@
+// TerrainNoise
+
+#pragma once
+
+#include <cstdint>
+
+#include "heightfield.h"
+#include "implicits.h"
+
+// Procedural terrain from simplex noise, with fractal sums and domain warping
+class TerrainNoise
+{
+public:
+  //! Fractal sums of octaves.
+  enum Fractal
+  {
+    FBm,    //!< Fractional Brownian motion.
+    Ridged  //!< Ridged multifractal.
+  };
+protected:
+  int perm[512];                   //!< Permutation of the lattice, repeated twice.
+  Fractal fractal = FBm;           //!< Fractal sum.
+  int octaves = 8;                 //!< Number of octaves.
+  double frequency = 1.0 / 256.0;  //!< Frequency of the first octave, in cycles per sample.
+  double lacunarity = 2.0;         //!< Frequency ratio between octaves.
+  double gain = 0.5;               //!< Amplitude ratio between octaves.
+  double warp = 0.0;               //!< Amplitude of the domain warping, in units of the first octave.
+public:
+  explicit TerrainNoise(std::uint32_t = 0);
+
+  //! Empty.
+  ~TerrainNoise() {}
+
+  void SetFractal(Fractal, int, double = 2.0, double = 0.5);
+  void SetFrequency(double);
+  void SetWarp(double);
+
+  static double Simplex(const int*, double, double);
+  double Simplex(double, double) const;
+  double Value(double, double) const;
+  double K() const;
+
+  void Row(int, int, int, float*) const;
+  void Generate(HeightField&, int = 0, int = 0) const;
+protected:
+  double Sum(double, double) const;
+  void Sum(const float*, const float*, int, float*) const;
+protected:
+  static const int Tile = 64; //!< Size of the tiles generated in parallel.
+};
+
+//! Set the frequency of the first octave, in cycles per sample.
+inline void TerrainNoise::SetFrequency(double f)
+{
+  frequency = f;
+}
+
+//! Set the amplitude of the domain warping, in units of the first octave, zero disables warping.
+inline void TerrainNoise::SetWarp(double w)
+{
+  warp = w;
+}
+
+//! Compute the simplex noise of the permutation of the lattice.
+inline double TerrainNoise::Simplex(double x, double y) const
+{
+  return Simplex(perm, x, y);
+}
+
+// Terrain defined as the region below a procedural height, as a building block of implicit surfaces
+class NoiseField : public AnalyticScalarField
+{
+protected:
+  TerrainNoise noise; //!< Procedural height.
+  double scale;       //!< Size of a sample of the noise.
+  double height;      //!< Height scale.
+public:
+  explicit NoiseField(const TerrainNoise&, double = 1.0, double = 1.0);
+
+  double Value(const Vector&) const override;
+  double K() const override;
+};
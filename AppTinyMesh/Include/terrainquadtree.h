@@ -0,0 +1,69 @@
+// TerrainQuadtree
+
+#pragma once
+
+#include <vector>
+
+#include "heightfield.h"
+#include "camera.h"
+
+// Quadtree of the patches of a height field, for level of detail rendering
+class TerrainQuadtree
+{
+public:
+  // Selected patch
+  struct Tile
+  {
+    float i, j;  //!< First sample.
+    float step;  //!< Distance between two vertices, in samples.
+    float skirt; //!< Depth of the skirt hiding cracks with coarser neighbors.
+  };
+protected:
+  // Node, covering size x size squares at its step
+  struct Node
+  {
+    float a, b;  //!< Range of heights.
+    float error; //!< Maximal vertical error of the node and its descendants.
+  };
+
+  // Planes of the view frustum and projection of errors
+  struct Frustum
+  {
+    Vector eye;        //!< Eye.
+    Vector planes[5];  //!< Inward normals of the side and near planes, through the eye.
+    double near;       //!< Near plane.
+    double far;        //!< Far plane.
+    double pixels;     //!< Number of pixels of a unit length at unit distance.
+  };
+
+  int width;                            //!< Number of rows of the height field.
+  int length;                           //!< Number of samples per row.
+  int size;                             //!< Number of squares along the side of a patch.
+  double heightMax;                     //!< Height scale.
+  double squareSize;                    //!< Size of a square of the grid.
+  std::vector<int> rows, columns;       //!< Number of nodes at every level.
+  std::vector<std::vector<Node>> nodes; //!< Nodes of every level, row after row, the last level is the coarsest.
+public:
+  explicit TerrainQuadtree(const HeightField&, int, double, double);
+
+  //! Empty.
+  ~TerrainQuadtree() {}
+
+  void Update(const HeightField&, int, int, int, int);
+  void Select(const Camera&, int, int, double, std::vector<Tile>&) const;
+
+  int Levels() const;
+  Box GetBox(int, int, int) const;
+protected:
+  void Evaluate(const HeightField&, int, int, int);
+  void Select(const Frustum&, double, int, int, int, float, std::vector<Tile>&) const;
+  static bool Visible(const Frustum&, const Box&);
+};
+
+/*!
+\brief Return the number of levels.
+*/
+inline int TerrainQuadtree::Levels() const
+{
+  return int(nodes.size());
+}
@@ -0,0 +1,151 @@
+// Voxel
+
+#pragma once
+
+#include <cstdint>
+
+#include "implicits.h"
+
+// Binary voxel grid stored as bricks
+class VoxelGrid
+{
+public:
+  //! Voxelization modes.
+  enum class Mode
+  {
+    Surface = 0, //!< Voxels overlapping the triangles, conservative.
+    Solid = 1,   //!< Voxels whose center lies inside the closed mesh.
+  };
+protected:
+  //! Brick of 8x8x8 voxels, one 64 bit word per z slice with bit x+8y.
+  struct Brick
+  {
+    uint64_t bits[8] = { 0 };
+  };
+
+  Box box;                   //!< Box of the grid.
+  int nx, ny, nz;            //!< Number of voxels.
+  double size;               //!< Size of the voxels, which are cubes.
+  int bx, by, bz;            //!< Number of bricks.
+  bool sparse;               //!< Allocate bricks only when a voxel is set.
+  std::vector<std::vector<int>> index;   //!< Index of the bricks in their layer of bricks, -1 if empty.
+  std::vector<std::vector<Brick>> layers; //!< Bricks, per layer of bricks along z.
+public:
+  explicit VoxelGrid(const Box&, int, bool = true);
+
+  //! Empty.
+  ~VoxelGrid() {}
+
+  void Voxelize(const Mesh&, Mode);
+  void Clear();
+
+  bool Get(int, int, int) const;
+  void Set(int, int, int);
+
+  int X() const;
+  int Y() const;
+  int Z() const;
+  double Size() const;
+  Box GetBox() const;
+  Vector Center(int, int, int) const;
+
+  long long Count() const;
+  double Volume() const;
+  int Bricks() const;
+  long long Memory() const;
+protected:
+  void Surface(const Mesh&, const std::vector<std::vector<int>>&);
+  void Solid(const Mesh&, const std::vector<std::vector<int>>&);
+  Brick& GetBrick(int, int, std::vector<Brick>&, std::vector<int>&) const;
+  std::vector<std::vector<int>> Bin(const Mesh&) const;
+
+  friend class VoxelField;
+};
+
+// Narrow band signed distance sampled on a voxel grid
+class VoxelField : public AnalyticScalarField
+{
+protected:
+  //! Brick of 8x8x8 samples, with x varying first.
+  struct Brick
+  {
+    float d[512];
+  };
+  static const int Outside = -1; //!< Index of a brick outside of the band and of the object.
+  static const int Inside = -2;  //!< Index of a brick outside of the band and inside the object.
+
+  Box box;                   //!< Box of the grid.
+  int nx, ny, nz;            //!< Number of samples.
+  double size;               //!< Distance between samples.
+  int bx, by, bz;            //!< Number of bricks.
+  double band;               //!< Width of the band, returned outside of it.
+  std::vector<int> index;    //!< Index of the bricks in the band, or their side.
+  std::vector<Brick> bricks; //!< Bricks of the band.
+public:
+  explicit VoxelField(const VoxelGrid&, const Mesh&, int);
+
+  double Value(const Vector&) const override;
+  double K() const override;
+  Box GetBox() const;
+  long long Memory() const;
+protected:
+  bool Sweep(int, int, int, int);
+  float Sample(int, int, int) const;
+};
+
+/*!
+\brief Check whether a voxel is set.
+\param i,j,k Integer coordinates of the voxel.
+*/
+inline bool VoxelGrid::Get(int i, int j, int k) const
+{
+  const int b = index[k >> 3][(j >> 3) * bx + (i >> 3)];
+  if (b < 0)
+    return false;
+  return (layers[k >> 3][b].bits[k & 7] >> ((i & 7) + 8 * (j & 7))) & 1;
+}
+
+//! Return the number of voxels along x.
+inline int VoxelGrid::X() const
+{
+  return nx;
+}
+
+//! Return the number of voxels along y.
+inline int VoxelGrid::Y() const
+{
+  return ny;
+}
+
+//! Return the number of voxels along z.
+inline int VoxelGrid::Z() const
+{
+  return nz;
+}
+
+//! Return the size of the voxels.
+inline double VoxelGrid::Size() const
+{
+  return size;
+}
+
+//! Return the box of the grid, which may slightly exceed the box given at construction.
+inline Box VoxelGrid::GetBox() const
+{
+  return box;
+}
+
+/*!
+\brief Return the center of a voxel.
+\param i,j,k Integer coordinates of the voxel.
+*/
+inline Vector VoxelGrid::Center(int i, int j, int k) const
+{
+  return box[0] + Vector((i + 0.5) * size, (j + 0.5) * size, (k + 0.5) * size);
+}
+
+//! Compute the volume of the set voxels.
+inline double VoxelGrid::Volume() const
+{
+  return Count() * size * size * size;
+}
@@ -2,7 +2,7 @@
 
 #ifdef VERTEX_SHADER
 in vec3 vertex;
-in vec3 normal;
+in vec2 normal;
 in vec3 color;
 
 uniform mat4 ModelViewMatrix;
@@ -13,11 +13,21 @@ out vec3 fragNormal;
 out vec3 fragVertex;
 out vec3 fragColor;
 
+// Decode a normal from its octahedral encoding
+// e : Encoded normal, in [-1, 1]
+vec3 OctahedralDecode(in vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0)
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(n);
+}
+
 void main(void)
 {
 	mat4 MVP      = ProjectionMatrix * ModelViewMatrix;
 	gl_Position   = MVP * TRSMatrix * (vec4(vertex, 1.0)); 
-	fragNormal	  = (TRSMatrix * vec4(normalize(normal), 0.0f)).xyz;
+	fragNormal	  = (TRSMatrix * vec4(OctahedralDecode(normal), 0.0f)).xyz;
 	fragVertex 	  = vertex;
 	fragColor	  = color;
 } 
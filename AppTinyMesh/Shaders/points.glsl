@@ -0,0 +1,57 @@
+#version 150
+
+#ifdef VERTEX_SHADER
+in vec3 vertex;
+in vec3 normal;
+
+uniform mat4 ModelViewMatrix;
+uniform mat4 ProjectionMatrix;
+uniform mat4 TRSMatrix;
+uniform float pointSize;
+
+out vec3 fragNormal;
+
+void main(void)
+{
+	mat4 MVP      = ProjectionMatrix * ModelViewMatrix;
+	gl_Position   = MVP * TRSMatrix * (vec4(vertex, 1.0));
+	gl_PointSize  = pointSize;
+	fragNormal	  = (TRSMatrix * vec4(normal, 0.0f)).xyz;
+}
+#endif
+
+#ifdef FRAGMENT_SHADER
+in vec3 fragNormal;
+
+uniform int material;
+uniform vec3 viewDir;
+
+out vec4 fragment;
+
+// Compute smooth diffuse color
+// normal : Normal vector
+// lighting : Lighting vector
+float Diffuse(in vec3 normal, in vec3 lighting)
+{
+	// Modified diffuse lighting
+	float d = 0.5 * (1.0 + dot(normal, lighting));
+	return clamp(0.25 + (d * d), 0, 1);
+}
+
+void main()
+{
+	// Points without normals
+	if (dot(fragNormal, fragNormal) == 0.0)
+	{
+		fragment = vec4(0.3, 0.3, 0.35, 1.0);
+		return;
+	}
+
+	vec3 n = normalize(fragNormal);
+	if (material == 0)
+		fragment = vec4(0.2 * (vec3(3.0) + 2.0 * n), 1.0);
+	else
+		fragment = vec4(vec3(0.8) * Diffuse(n, -viewDir), 1.0);
+}
+
+#endif
@@ -0,0 +1,108 @@
+#version 150
+
+#ifdef VERTEX_SHADER
+in vec3 vertex;
+in vec4 tile;
+
+uniform mat4 ModelViewMatrix;
+uniform mat4 ProjectionMatrix;
+uniform mat4 TRSMatrix;
+
+uniform sampler2D heights;
+uniform ivec2 size;
+uniform float squareSize;
+uniform float heightMax;
+uniform float slope;
+
+out vec3 fragNormal;
+out vec3 fragColor;
+
+// Height of a sample, rows of the height field are rows of the texture
+// i, j : Integer coordinates
+float Height(int i, int j)
+{
+	return texelFetch(heights, ivec2(clamp(j, 0, size.y - 1), clamp(i, 0, size.x - 1)), 0).r;
+}
+
+// Color depending on the height and the slope, same as HeightField::generateColor()
+vec3 SlopeColor(float h, float s)
+{
+	vec3 color1;
+	vec3 color2;
+	if (h > 0.8)
+	{
+		color1 = vec3(255.0, 255.0, 255.0) / 255.0;
+		color2 = vec3(35.0, 35.0, 35.0) / 255.0;
+	}
+	else if (slope * s < 0.5)
+	{
+		color1 = vec3(89.0, 189.0, 64.0) / 255.0;
+		color2 = vec3(0.0);
+	}
+	else
+	{
+		color1 = vec3(110.0, 110.0, 110.0) / 255.0;
+		color2 = vec3(0.0);
+	}
+	return color1 + slope * s * (color2 - color1);
+}
+
+void main(void)
+{
+	// Patch origin and step between vertices
+	int step = int(tile.z);
+	ivec2 ij = min(ivec2(tile.xy) + step * ivec2(vertex.xy), size - 1);
+	int i = ij.x;
+	int j = ij.y;
+	float h = Height(i, j);
+
+	// Skirt vertices hang below the border of the patch
+	vec3 p = vec3(float(i) * squareSize - 0.5 * float(size.x) * squareSize, float(size.y - j) * squareSize - 0.5 * float(size.y) * squareSize, h * heightMax - vertex.z * tile.w);
+
+	// Central differences at the resolution of the patch, y decreases with j
+	int i0 = max(i - step, 0), i1 = min(i + step, size.x - 1);
+	int j0 = max(j - step, 0), j1 = min(j + step, size.y - 1);
+	float gx = (Height(i1, j) - Height(i0, j)) * heightMax / (float(i1 - i0) * squareSize);
+	float gy = -(Height(i, j1) - Height(i, j0)) * heightMax / (float(j1 - j0) * squareSize);
+	vec3 n = normalize(vec3(-gx, -gy, 1.0));
+
+	// Slope with the previous samples, or the next ones on the border
+	float s1 = h - Height(i > 0 ? i - 1 : i + 1, j);
+	float s2 = h - Height(i, j > 0 ? j - 1 : j + 1);
+
+	mat4 MVP      = ProjectionMatrix * ModelViewMatrix;
+	gl_Position   = MVP * TRSMatrix * vec4(p, 1.0);
+	fragNormal    = (TRSMatrix * vec4(n, 0.0)).xyz;
+	fragColor     = SlopeColor(h, length(vec2(s1, s2)));
+}
+#endif
+
+#ifdef FRAGMENT_SHADER
+in vec3 fragNormal;
+in vec3 fragColor;
+
+uniform int material;
+uniform vec3 viewDir;
+
+out vec4 fragment;
+
+// Compute smooth diffuse color
+// normal : Normal vector
+// lighting : Lighting vector
+float Diffuse(in vec3 normal, in vec3 lighting)
+{
+	// Modified diffuse lighting
+	float d = 0.5 * (1.0 + dot(normal, lighting));
+	return clamp(0.25 + (d * d), 0, 1);
+}
+
+void main()
+{
+	vec3 n = normalize(fragNormal);
+	if (material == 0)
+		fragment = vec4(0.2 * (vec3(3.0) + 2.0 * n), 1.0);
+	else
+		fragment = vec4(fragColor * Diffuse(n, -viewDir), 1.0);
+}
+
+#endif
@@ -3,6 +3,8 @@
 // Self include
 #include "box.h"
 
+#include <limits>
+
 /*!
 \class Box box.h
 \brief An axis aligned box.
@@ -121,6 +123,43 @@ Box::Box(const Box& x, const Box& y)
   b = Vector::Max(x.b, y.b);
 }
 
+/*!
+\brief Compute the intersection between a ray and the box.
+
+If the origin of the ray lies inside the box, the entry depth is 0.
+\param ray The ray.
+\param tmin, tmax Entry and exit depths.
+*/
+bool Box::Intersect(const Ray& ray, double& tmin, double& tmax) const
+{
+  tmin = 0.0;
+  tmax = std::numeric_limits<double>::infinity();
+
+  for (int i = 0; i < 3; i++)
+  {
+    const double o = ray.Origin()[i];
+    const double d = ray.Direction()[i];
+    if (fabs(d) < epsilon)
+    {
+      // Parallel to the slab
+      if (o < a[i] || o > b[i])
+        return false;
+      continue;
+    }
+    double ta = (a[i] - o) / d;
+    double tb = (b[i] - o) / d;
+    if (ta > tb)
+    {
+      std::swap(ta, tb);
+    }
+    tmin = Math::Max(tmin, ta);
+    tmax = Math::Min(tmax, tb);
+    if (tmin > tmax)
+      return false;
+  }
+  return true;
+}
+
 /*!
 \brief Computes the sub-box in the n-th octant.
 \param n Octant index.
@@ -0,0 +1,470 @@
+// BVH
+
+#include "bvh.h"
+
+#include <algorithm>
+
+/*!
+\class BVH bvh.h
+\brief A bounding volume hierarchy of triangles for ray queries.
+
+The hierarchy is a binary tree built with the surface area heuristic over binned centroids.
+Triangles are sorted in leaf order and stored in a single TrianglePacket, so that leaves are
+processed by the SIMD kernels of the Packet class.
+
+\code
+Mesh mesh;
+mesh.Load("bunny.obj");
+BVH bvh(mesh);
+double t, u, v;
+int i;
+if (bvh.Intersect(ray, t, u, v, i))
+{
+  Vector p = mesh.GetTriangle(i).Vertex(u, v);
+}
+\endcode
+
+The hierarchy is built in parallel with OpenMP tasks.
+*/
+
+/*!
+\brief Create the hierarchy of the triangles of a mesh.
+\param mesh The mesh.
+*/
+BVH::BVH(const Mesh& mesh)
+{
+  std::vector<Triangle> t(mesh.Triangles());
+  for (int i = 0; i < mesh.Triangles(); i++)
+  {
+    t[i] = mesh.GetTriangle(i);
+  }
+  Build(t);
+}
+
+/*!
+\brief Create the hierarchy of a set of triangles.
+\param t Array of triangles.
+*/
+BVH::BVH(const std::vector<Triangle>& t)
+{
+  Build(t);
+}
+
+/*!
+\brief Compute the bounding box of the hierarchy.
+*/
+Box BVH::GetBox() const
+{
+  if (nodes.empty())
+    return Box::Null;
+  return Box(Vector(nodes[0].a[0], nodes[0].a[1], nodes[0].a[2]), Vector(nodes[0].b[0], nodes[0].b[1], nodes[0].b[2]));
+}
+
+/*!
+\brief Set the box of a node.
+
+Coordinates are slightly enlarged so that rounding to single precision never shrinks the box.
+\param node The node.
+\param box The box.
+*/
+void BVH::SetBox(Node& node, const Box& box) const
+{
+  for (int k = 0; k < 3; k++)
+  {
+    node.a[k] = float(box[0][k] - Box::epsilon * (1.0 + fabs(box[0][k])));
+    node.b[k] = float(box[1][k] + Box::epsilon * (1.0 + fabs(box[1][k])));
+  }
+}
+
+/*!
+\brief Build the hierarchy.
+\param t Array of triangles.
+*/
+void BVH::Build(const std::vector<Triangle>& t)
+{
+  const int n = int(t.size());
+
+  nodes.clear();
+  triangles.Clear();
+  tid.resize(n);
+  if (n == 0)
+    return;
+
+  std::vector<Box> boxes(n);
+  std::vector<Vector> centers(n);
+
+#pragma omp parallel for
+  for (int i = 0; i < n; i++)
+  {
+    boxes[i] = t[i].GetBox();
+    centers[i] = boxes[i].Center();
+    tid[i] = i;
+  }
+
+  // A binary tree with n leaves at most has 2n-1 nodes
+  nodes.resize(2 * n);
+  std::atomic<int> next(1);
+
+#pragma omp parallel
+#pragma omp single
+  Build(0, 0, n, 0, boxes, centers, next);
+
+  nodes.resize(next);
+
+  // Sort triangles in leaf order
+  triangles.Reserve(n);
+  for (int i = 0; i < n; i++)
+  {
+    triangles.Append(t[tid[i]]);
+  }
+}
+
+/*!
+\brief Recursively build a node of the hierarchy.
+\param n Index of the node.
+\param first, last Range of triangles in the node, last excluded.
+\param depth Depth of the node.
+\param boxes, centers Bounding boxes and their centers of the triangles.
+\param next Index of the next free node.
+*/
+void BVH::Build(int n, int first, int last, int depth, const std::vector<Box>& boxes, const std::vector<Vector>& centers, std::atomic<int>& next)
+{
+  Node& node = nodes[n];
+
+  Box box = boxes[tid[first]];
+  Box cbox(centers[tid[first]], centers[tid[first]]);
+  for (int i = first + 1; i < last; i++)
+  {
+    box = Box(box, boxes[tid[i]]);
+    cbox = Box(cbox, Box(centers[tid[i]], centers[tid[i]]));
+  }
+  SetBox(node, box);
+
+  const int count = last - first;
+  if (count <= Leaf)
+  {
+    node.index = first;
+    node.count = count;
+    return;
+  }
+
+  // Split along the largest extent of the centers
+  Vector extent = cbox.Diagonal();
+  int axis = (extent[0] > extent[1]) ? ((extent[0] > extent[2]) ? 0 : 2) : ((extent[1] > extent[2]) ? 1 : 2);
+  int mid = (first + last) / 2;
+
+  if (extent[axis] > 0.0 && depth < MaxDepth)
+  {
+    // Bin centers
+    const int bins = 16;
+    int binCount[bins] = { 0 };
+    Box binBox[bins];
+    const double scale = bins * (1.0 - 1.0e-6) / extent[axis];
+    for (int i = first; i < last; i++)
+    {
+      int b = int((centers[tid[i]][axis] - cbox[0][axis]) * scale);
+      binBox[b] = (binCount[b] == 0) ? boxes[tid[i]] : Box(binBox[b], boxes[tid[i]]);
+      binCount[b]++;
+    }
+
+    // Sweep from the right to get the area of the suffixes
+    double rightArea[bins];
+    int rightCount[bins];
+    Box acc;
+    int c = 0;
+    for (int b = bins - 1; b > 0; b--)
+    {
+      if (binCount[b] > 0)
+      {
+        acc = (c == 0) ? binBox[b] : Box(acc, binBox[b]);
+        c += binCount[b];
+      }
+      rightArea[b] = (c == 0) ? 0.0 : acc.Area();
+      rightCount[b] = c;
+    }
+
+    // Sweep from the left and keep the cheapest split
+    double best = Packet::Infinity;
+    int split = -1;
+    c = 0;
+    for (int b = 0; b < bins - 1; b++)
+    {
+      if (binCount[b] > 0)
+      {
+        acc = (c == 0) ? binBox[b] : Box(acc, binBox[b]);
+        c += binCount[b];
+      }
+      if (c == 0 || rightCount[b + 1] == 0)
+        continue;
+      double cost = c * acc.Area() + rightCount[b + 1] * rightArea[b + 1];
+      if (cost < best)
+      {
+        best = cost;
+        split = b;
+      }
+    }
+
+    if (split >= 0)
+    {
+      const double origin = cbox[0][axis];
+      mid = int(std::partition(tid.begin() + first, tid.begin() + last, [&](int i)
+        {
+          return int((centers[i][axis] - origin) * scale) <= split;
+        }) - tid.begin());
+    }
+  }
+  else if (extent[axis] > 0.0)
+  {
+    // Too deep, median split keeps the depth logarithmic
+    std::nth_element(tid.begin() + first, tid.begin() + mid, tid.begin() + last, [&](int i, int j)
+      {
+        return centers[i][axis] < centers[j][axis];
+      });
+  }
+
+  if (mid == first || mid == last)
+  {
+    mid = (first + last) / 2;
+  }
+
+  const int child = next.fetch_add(2);
+  node.index = child;
+  node.count = 0;
+
+  // Large nodes are built in parallel
+  if (count > 4096)
+  {
+#pragma omp task shared(boxes, centers, next)
+    Build(child, first, mid, depth + 1, boxes, centers, next);
+#pragma omp task shared(boxes, centers, next)
+    Build(child + 1, mid, last, depth + 1, boxes, centers, next);
+#pragma omp taskwait
+  }
+  else
+  {
+    Build(child, first, mid, depth + 1, boxes, centers, next);
+    Build(child + 1, mid, last, depth + 1, boxes, centers, next);
+  }
+}
+
+/*!
+\brief Compute the closest intersection between a ray and the triangles.
+\param ray The ray.
+\param t Intersection depth.
+\param u,v Parametric coordinates of the intersection in the triangle.
+\param triangle Index of the intersected triangle.
+\param tmax Intersections beyond this distance are ignored.
+*/
+bool BVH::Intersect(const Ray& ray, double& t, double& u, double& v, int& triangle, double tmax) const
+{
+  if (nodes.empty())
+    return false;
+
+  const float o[3] = { float(ray.Origin()[0]), float(ray.Origin()[1]), float(ray.Origin()[2]) };
+  const float inv[3] = { 1.0f / float(ray.Direction()[0]), 1.0f / float(ray.Direction()[1]), 1.0f / float(ray.Direction()[2]) };
+
+  int hit = -1;
+  int stack[2 * MaxDepth];
+  int size = 0;
+  int n = 0;
+  while (true)
+  {
+    const Node& node = nodes[n];
+    if (node.count > 0)
+    {
+      double tt, uu, vv;
+      int h = Packet::Intersect(ray, triangles, node.index, node.index + node.count, tt, uu, vv, tmax);
+      if (h >= 0)
+      {
+        tmax = t = tt;
+        u = uu;
+        v = vv;
+        hit = h;
+      }
+    }
+    else
+    {
+      // Slab test of both children
+      float tn[2];
+      for (int c = 0; c < 2; c++)
+      {
+        const Node& child = nodes[node.index + c];
+        float t0 = 0.0f;
+        float t1 = float(tmax);
+        for (int k = 0; k < 3; k++)
+        {
+          float ta = (child.a[k] - o[k]) * inv[k];
+          float tb = (child.b[k] - o[k]) * inv[k];
+          t0 = std::max(t0, std::min(ta, tb));
+          t1 = std::min(t1, std::max(ta, tb));
+        }
+        tn[c] = (t0 <= t1) ? t0 : float(Packet::Infinity);
+      }
+
+      const bool h0 = tn[0] != float(Packet::Infinity);
+      const bool h1 = tn[1] != float(Packet::Infinity);
+      if (h0 && h1)
+      {
+        // Visit the nearest child first
+        int nearest = (tn[0] <= tn[1]) ? 0 : 1;
+        stack[size++] = node.index + 1 - nearest;
+        n = node.index + nearest;
+        continue;
+      }
+      if (h0 || h1)
+      {
+        n = node.index + (h0 ? 0 : 1);
+        continue;
+      }
+    }
+    if (size == 0)
+      break;
+    n = stack[--size];
+  }
+
+  if (hit < 0)
+    return false;
+  triangle = tid[hit];
+  return true;
+}
+
+/*!
+\brief Check whether a ray hits a triangle before a given distance.
+\param ray The ray.
+\param tmax Distance.
+*/
+bool BVH::Occluded(const Ray& ray, double tmax) const
+{
+  if (nodes.empty())
+    return false;
+
+  const float o[3] = { float(ray.Origin()[0]), float(ray.Origin()[1]), float(ray.Origin()[2]) };
+  const float inv[3] = { 1.0f / float(ray.Direction()[0]), 1.0f / float(ray.Direction()[1]), 1.0f / float(ray.Direction()[2]) };
+
+  int stack[2 * MaxDepth];
+  int size = 0;
+  stack[size++] = 0;
+  while (size > 0)
+  {
+    const Node& node = nodes[stack[--size]];
+
+    float t0 = 0.0f;
+    float t1 = float(tmax);
+    for (int k = 0; k < 3; k++)
+    {
+      float ta = (node.a[k] - o[k]) * inv[k];
+      float tb = (node.b[k] - o[k]) * inv[k];
+      t0 = std::max(t0, std::min(ta, tb));
+      t1 = std::min(t1, std::max(ta, tb));
+    }
+    if (t0 > t1)
+      continue;
+
+    if (node.count > 0)
+    {
+      double t, u, v;
+      if (Packet::Intersect(ray, triangles, node.index, node.index + node.count, t, u, v, tmax) >= 0)
+        return true;
+    }
+    else
+    {
+      stack[size++] = node.index;
+      stack[size++] = node.index + 1;
+    }
+  }
+  return false;
+}
+
+/*!
+\brief Return a triangle stored in the leaves.
+\param i Index of the triangle in leaf order.
+*/
+Triangle BVH::GetTriangle(int i) const
+{
+  Vector a(triangles.Origin(0)[i], triangles.Origin(1)[i], triangles.Origin(2)[i]);
+  Vector e1(triangles.Edge(0)[i], triangles.Edge(1)[i], triangles.Edge(2)[i]);
+  Vector e2(triangles.Edge(3)[i], triangles.Edge(4)[i], triangles.Edge(5)[i]);
+  return Triangle(a, a + e1, a + e2);
+}
+
+/*!
+\brief Compute the squared distance between a point and the box of a node.
+\param node The node.
+\param p Point.
+*/
+double BVH::SquaredDistance(const Node& node, const Vector& p) const
+{
+  double d = 0.0;
+  for (int k = 0; k < 3; k++)
+  {
+    if (p[k] < node.a[k])
+    {
+      d += (node.a[k] - p[k]) * (node.a[k] - p[k]);
+    }
+    else if (p[k] > node.b[k])
+    {
+      d += (p[k] - node.b[k]) * (p[k] - node.b[k]);
+    }
+  }
+  return d;
+}
+
+/*!
+\brief Compute the closest triangle to a point.
+
+Subtrees are visited nearest first and pruned as soon as their box lies farther than the closest triangle found so far.
+Triangles are stored in single precision, callers needing an exact answer should recompute the closest point on the returned triangle.
+\param p Point.
+\param u,v Parametric coordinates of the closest point in the triangle.
+\param d Distance.
+\param dmax Triangles beyond this distance are ignored.
+\return Index of the closest triangle, -1 if none.
+*/
+int BVH::Closest(const Vector& p, double& u, double& v, double& d, double dmax) const
+{
+  if (nodes.empty())
+    return -1;
+
+  double best = dmax * dmax;
+  int hit = -1;
+
+  int stack[2 * MaxDepth];
+  int size = 0;
+  stack[size++] = 0;
+  while (size > 0)
+  {
+    const Node& node = nodes[stack[--size]];
+    if (SquaredDistance(node, p) >= best)
+      continue;
+
+    if (node.count > 0)
+    {
+      for (int i = node.index; i < node.index + node.count; i++)
+      {
+        double uu, vv;
+        double e = SquaredNorm(GetTriangle(i).Closest(p, uu, vv) - p);
+        if (e < best)
+        {
+          best = e;
+          u = uu;
+          v = vv;
+          hit = i;
+        }
+      }
+    }
+    else
+    {
+      // Push the farthest child first so that the nearest one is visited first
+      const double d0 = SquaredDistance(nodes[node.index], p);
+      const double d1 = SquaredDistance(nodes[node.index + 1], p);
+      const int nearest = (d0 <= d1) ? 0 : 1;
+      stack[size++] = node.index + 1 - nearest;
+      stack[size++] = node.index + nearest;
+    }
+  }
+
+  if (hit < 0)
+    return -1;
+  d = sqrt(best);
+  return tid[hit];
+}
@@ -207,6 +207,18 @@ double Camera::GetAngleOfViewV(double w, double h) const
 \param w,h Size of the viewing window.
 */
 Ray Camera::PixelToRay(int px, int py, int w, int h) const
+{
+  return PixelToRay(double(px), double(py), w, h);
+}
+
+/*!
+\brief Compute the equation of a ray given a sub-pixel position in the camera plane.
+
+Pixel centers are located at half integer coordinates, which is useful for antialiasing.
+\param px,py Sub-pixel coordinates.
+\param w,h Size of the viewing window.
+*/
+Ray Camera::PixelToRay(double px, double py, int w, int h) const
 {
   // Get coordinates
   Vector view = Normalized(At() - Eye());
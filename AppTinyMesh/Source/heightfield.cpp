@@ -1,5 +1,13 @@
 #include <QDebug>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
 #include "heightfield.h"
+#include "parse.h"
+
+#include <cctype>
+#include <cstring>
+#include <limits>
+#include <string>
 
 /*!
 \brief Add a triangle to the geometry.
@@ -40,48 +48,378 @@ HeightField::HeightField(int width, int length)
 {
   this->width = width;
   this->length = length;
-  height.resize(width);
-  for (int i = 0; i < width; i++)
+  height.resize(size_t(width) * length, 0.0f);
+}
+
+// Number of scanlines decoded and transposed together
+static const int Scanlines = 16;
+
+/*!
+\brief Fill a height field from scanlines, in parallel.
+
+Scanlines are decoded by blocks, and every block is transposed to the rows of the height field,
+so that both the source and the heights are accessed contiguously.
+\param hf The height field, with its size set.
+\param decode Function decoding the heights of a scanline, with the scanline index and the decoded heights as parameters.
+*/
+template <typename Decode>
+static void Transpose(HeightField& hf, Decode decode)
+{
+  const int w = hf.getWidth(), l = hf.getLength();
+  const int blocks = (l + Scanlines - 1) / Scanlines;
+#pragma omp parallel
   {
-    height[i].resize(length);
+    std::vector<float> buffer(size_t(Scanlines) * w);
+#pragma omp for schedule(dynamic, 1)
+    for (int k = 0; k < blocks; k++)
+    {
+      const int j0 = k * Scanlines, n = std::min(Scanlines, l - j0);
+      for (int j = 0; j < n; j++)
+      {
+        decode(j0 + j, &buffer[size_t(j) * w]);
+      }
+      for (int i = 0; i < w; i++)
+      {
+        float* h = hf[i] + j0;
+        for (int j = 0; j < n; j++)
+        {
+          h[j] = buffer[size_t(j) * w + i];
+        }
+      }
+    }
   }
 }
 
 /*!
 \brief Constructor which take the "value" of each pixel of an image to determine the height.
+
+The value is the maximum of the red, green and blue channels. Images with 16 bits per channel keep their precision.
+Other images are converted once to 32 bits per pixel, and scanlines are read directly.
 */
 HeightField::HeightField(QImage image)
 {
   this->width = image.width();
   this->length = image.height();
-  height.resize(image.width());
-  for(int i = 0; i < image.width(); i++)
+  height.resize(size_t(width) * length);
+  const int w = width;
+
+  if (image.format() == QImage::Format_Grayscale16)
   {
-    height[i].resize(image.height());
-    for(int j = 0; j < image.height(); j++)
-    {
-      QColor color = image.pixelColor(i,j);
-      height[i][j] = (double)color.value() / 255; // Max=255 for the value
-    }
+    const QImage& source = image;
+    Transpose(*this, [&](int y, float* line)
+      {
+        const uint16_t* p = reinterpret_cast<const uint16_t*>(source.constScanLine(y));
+#pragma omp simd
+        for (int x = 0; x < w; x++)
+        {
+          line[x] = float(p[x]) / 65535.0f;
+        }
+      });
+  }
+  else if (image.format() == QImage::Format_Grayscale8)
+  {
+    const QImage& source = image;
+    Transpose(*this, [&](int y, float* line)
+      {
+        const uchar* p = source.constScanLine(y);
+#pragma omp simd
+        for (int x = 0; x < w; x++)
+        {
+          line[x] = float(p[x]) / 255.0f;
+        }
+      });
+  }
+  else if (image.depth() > 32)
+  {
+    // Channels in memory order, 16 bits each
+    const QImage source = image.convertToFormat(QImage::Format_RGBX64);
+    Transpose(*this, [&](int y, float* line)
+      {
+        const uint16_t* p = reinterpret_cast<const uint16_t*>(source.constScanLine(y));
+#pragma omp simd
+        for (int x = 0; x < w; x++)
+        {
+          line[x] = float(std::max(std::max(p[4 * x], p[4 * x + 1]), p[4 * x + 2])) / 65535.0f;
+        }
+      });
+  }
+  else
+  {
+    // Pixels are 0xffRRGGBB
+    const QImage source = image.convertToFormat(QImage::Format_RGB32);
+    Transpose(*this, [&](int y, float* line)
+      {
+        const uint32_t* p = reinterpret_cast<const uint32_t*>(source.constScanLine(y));
+#pragma omp simd
+        for (int x = 0; x < w; x++)
+        {
+          const uint32_t c = p[x];
+          line[x] = float(std::max(std::max((c >> 16) & 0xFF, (c >> 8) & 0xFF), c & 0xFF)) / 255.0f;
+        }
+      });
+  }
+}
+
+/*!
+\brief Load a height field.
+
+The format is given by the extension: headerless 16 bits unsigned heights in .r16 files, headerless 32 bits floating point heights
+in .raw files, ESRI ASCII grids in .asc files, and images otherwise. Headerless files are square if no size is given,
+and binary values are stored in the byte order of the machine.
+Images have the x axis along the rows of the height field, and so have the columns of grid files.
+\param filename File name.
+\param w, l Size of headerless files, or 0 if unknown.
+\return True if heights were loaded.
+*/
+bool HeightField::Load(const QString& filename, int w, int l)
+{
+  const QString suffix = QFileInfo(filename).suffix().toLower();
+  if (suffix != "r16" && suffix != "raw" && suffix != "asc")
+  {
+    QImage image(filename);
+    if (image.isNull())
+      return false;
+    *this = HeightField(image);
+    return true;
   }
+
+  QFile file(filename);
+  if (!file.open(QIODevice::ReadOnly))
+    return false;
+
+  // Pages are read from disk when the parser reaches them
+  const qint64 size = file.size();
+  const uchar* data = file.map(0, size);
+  if (data == nullptr)
+    return false;
+
+  bool loaded;
+  if (suffix == "r16")
+    loaded = LoadR16(data, size, w, l);
+  else if (suffix == "raw")
+    loaded = LoadRaw(data, size, w, l);
+  else
+    loaded = LoadAsc(reinterpret_cast<const char*>(data), reinterpret_cast<const char*>(data) + size);
+
+  file.unmap((uchar*)data);
+  return loaded;
 }
 
-//! Gets the i-th coordinate of the height field.
-std::vector<double> HeightField::operator[](int i) const
+/*!
+\brief Find the size of a headerless file.
+\param bytes Size of the file.
+\param sample Size of a height.
+\param w, l Size of the grid, computed if null.
+\return True if the file is large enough.
+*/
+bool HeightField::Headerless(qint64 bytes, int sample, int& w, int& l)
 {
-  return this->height[i];
+  const qint64 n = bytes / sample;
+  if (w <= 0 && l <= 0)
+  {
+    int side = int(std::sqrt(double(n)));
+    while (qint64(side) * side > n)
+      side--;
+    while (qint64(side + 1) * (side + 1) <= n)
+      side++;
+    w = l = side;
+  }
+  else if (w <= 0)
+    w = int(n / l);
+  else if (l <= 0)
+    l = int(n / w);
+  return w > 0 && l > 0 && qint64(w) * l <= n;
 }
 
-//! Returns the i-th coordinate of height field.
-std::vector<double>& HeightField::operator[](int i)
+/*!
+\brief Load headerless 16 bits unsigned heights, row after row.
+\param data, size Mapped file.
+\param w, l Size of the grid, or 0 if unknown.
+*/
+bool HeightField::LoadR16(const uchar* data, qint64 size, int w, int l)
 {
-  return this->height[i];
+  if (!Headerless(size, sizeof(uint16_t), w, l))
+    return false;
+
+  *this = HeightField(w, l);
+  const uint16_t* q = reinterpret_cast<const uint16_t*>(data);
+  Transpose(*this, [&](int y, float* line)
+    {
+      const uint16_t* p = q + size_t(y) * w;
+#pragma omp simd
+      for (int x = 0; x < w; x++)
+      {
+        line[x] = float(p[x]) / 65535.0f;
+      }
+    });
+  return true;
+}
+
+/*!
+\brief Load headerless 32 bits floating point heights, row after row.
+
+Heights are rescaled to [0, 1] if they exceed this range.
+\param data, size Mapped file.
+\param w, l Size of the grid, or 0 if unknown.
+*/
+bool HeightField::LoadRaw(const uchar* data, qint64 size, int w, int l)
+{
+  if (!Headerless(size, sizeof(float), w, l))
+    return false;
+
+  *this = HeightField(w, l);
+  const float* q = reinterpret_cast<const float*>(data);
+  Transpose(*this, [&](int y, float* line)
+    {
+      std::copy_n(q + size_t(y) * w, w, line);
+    });
+  Normalize();
+  return true;
+}
+
+/*!
+\brief Load an ESRI ASCII grid.
+
+The header gives the number of columns and rows, the first row being the northern one.
+Missing values are replaced by the lowest height, and heights are rescaled to [0, 1] if they exceed this range.
+\param begin, end Characters, end excluded.
+*/
+bool HeightField::LoadAsc(const char* begin, const char* end)
+{
+  // Header, with one keyword and value per line
+  int columns = -1, rows = -1;
+  float missing = 0.0f;
+  bool nodata = false;
+  const char* p = begin;
+  while (p < end)
+  {
+    while (p < end && isspace((unsigned char)*p))
+      p++;
+    if (p == end || !isalpha((unsigned char)*p))
+      break;
+    const char* eol = (const char*)memchr(p, '\n', end - p);
+    if (eol == nullptr)
+      eol = end;
+
+    const char* s = p;
+    while (s < eol && !isspace((unsigned char)*s))
+      s++;
+    std::string keyword(p, s);
+    std::transform(keyword.begin(), keyword.end(), keyword.begin(), [](unsigned char c) { return char(tolower(c)); });
+    while (s < eol && isspace((unsigned char)*s))
+      s++;
+    float f = 0.0f;
+    if (ParseReal(s, eol, f) == nullptr)
+      return false;
+    if (keyword == "ncols")
+      columns = int(f);
+    else if (keyword == "nrows")
+      rows = int(f);
+    else if (keyword == "nodata_value")
+    {
+      missing = f;
+      nodata = true;
+    }
+    p = eol;
+  }
+  if (columns <= 0 || rows <= 0)
+    return false;
+
+  // Chunks of about one megabyte, split at line boundaries
+  const int chunks = int(std::min<long long>((end - p) / (1 << 20) + 1, 1 << 16));
+  std::vector<const char*> cut(chunks + 1);
+  cut[0] = p;
+  cut[chunks] = end;
+  for (int i = 1; i < chunks; i++)
+  {
+    const char* q = std::max(p + (end - p) * i / chunks, cut[i - 1]);
+    const char* eol = (const char*)memchr(q, '\n', end - q);
+    cut[i] = (eol != nullptr) ? eol + 1 : end;
+  }
+
+  std::vector<std::vector<float>> parts(chunks);
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int c = 0; c < chunks; c++)
+  {
+    const char* s = cut[c];
+    while (true)
+    {
+      while (s < cut[c + 1] && isspace((unsigned char)*s))
+        s++;
+      float f;
+      s = ParseReal(s, cut[c + 1], f);
+      if (s == nullptr)
+        break;
+      parts[c].push_back(f);
+    }
+  }
+
+  // Concatenate
+  std::vector<long long> offset(chunks + 1, 0);
+  for (int c = 0; c < chunks; c++)
+  {
+    offset[c + 1] = offset[c] + parts[c].size();
+  }
+  if (offset[chunks] < (long long)(columns) * rows)
+    return false;
+
+  std::vector<float> grid(size_t(columns) * rows);
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int c = 0; c < chunks; c++)
+  {
+    const long long n = std::min<long long>(parts[c].size(), (long long)(grid.size()) - offset[c]);
+    if (n > 0)
+      std::copy_n(parts[c].begin(), n, grid.begin() + offset[c]);
+  }
+  parts.clear();
+
+  // Missing values
+  if (nodata)
+  {
+    float lowest = std::numeric_limits<float>::max();
+    for (float h : grid)
+    {
+      if (h != missing)
+        lowest = std::min(lowest, h);
+    }
+    std::replace(grid.begin(), grid.end(), missing, (lowest == std::numeric_limits<float>::max()) ? 0.0f : lowest);
+  }
+
+  *this = HeightField(columns, rows);
+  Transpose(*this, [&](int y, float* line)
+    {
+      std::copy_n(grid.begin() + size_t(y) * columns, columns, line);
+    });
+  Normalize();
+  return true;
+}
+
+/*!
+\brief Rescale heights to [0, 1] if they exceed this range.
+*/
+void HeightField::Normalize()
+{
+  if (height.empty())
+    return;
+  const std::pair<std::vector<float>::iterator, std::vector<float>::iterator> range = std::minmax_element(height.begin(), height.end());
+  const float a = *range.first, b = *range.second;
+  if (a >= 0.0f && b <= 1.0f)
+    return;
+
+  const float scale = (b > a) ? 1.0f / (b - a) : 0.0f;
+  const size_t n = height.size();
+  float* h = height.data();
+#pragma omp parallel for simd
+  for (long long k = 0; k < (long long)(n); k++)
+  {
+    h[k] = (h[k] - a) * scale;
+  }
 }
 
 /*!
 \brief Get the width.
 */
-int HeightField::getWidth()
+int HeightField::getWidth() const
 {
   return this->width;
 }
@@ -89,9 +427,9 @@ int HeightField::getWidth()
 /*!
 \brief Get the length.
 */
-int HeightField::getLength()
+int HeightField::getLength() const
 {
-  return this->width;
+  return this->length;
 }
 
 /*!
@@ -108,14 +446,19 @@ MeshColor HeightField::generateMesh(double heightMax, double squareSize, double
   std::vector<int> na;
   std::vector<Color> cols;
   cols.resize(this->width * this->length);
+  vertices.reserve(size_t(this->width) * this->length);
+  normals.reserve(2 * size_t(std::max(this->width - 1, 0)) * std::max(this->length - 1, 0));
+  va.reserve(3 * normals.capacity());
+  na.reserve(3 * normals.capacity());
   int normalCount = -1;
   double offsetX = (this->width*squareSize) / 2;
   double offsetY = (this->length*squareSize) / 2;
   for (int i = 0; i < this->width; i++)
   {
+    const float* h = (*this)[i];
     for (int j = 0; j < this->length; j++)
     {
-      vertices.push_back(Vector(i*squareSize - offsetX, (this->length-j)*squareSize - offsetY, height[i][j]*heightMax));
+      vertices.push_back(Vector(i*squareSize - offsetX, (this->length-j)*squareSize - offsetY, h[j]*heightMax));
 
       if (i > 0 && j > 0)
       {
@@ -153,6 +496,83 @@ MeshColor HeightField::generateMesh(double heightMax, double squareSize, double
   return MeshColor(plane, cols, plane.VertexIndexes());
 }
 
+/*!
+\brief Generate a mesh with shared vertices and smooth normals, in parallel.
+
+Output sizes are known in advance, so arrays are allocated once and filled row by row in parallel.
+Every vertex has its own normal, computed with central differences, and its own color,
+so that vertex, normal and color indexes are the same implicit grid.
+\param heightMax Max height that the mesh can't exceed.
+\param squareSize Size of one square (4 vertices) of the mesh.
+\param mult Coefficient to amplify the slope coefficient (thus the color).
+\return The mesh generated.
+*/
+MeshColor HeightField::generateSmoothMesh(double heightMax, double squareSize, double mult) const
+{
+  const int w = this->width;
+  const int l = this->length;
+  if (w < 2 || l < 2)
+    return MeshColor();
+
+  const size_t n = size_t(w) * l;
+  const size_t quads = size_t(w - 1) * (l - 1);
+  std::vector<Vector> vertices(n);
+  std::vector<Vector> normals(n);
+  std::vector<Color> cols(n);
+  std::vector<int> va(6 * quads);
+
+  double offsetX = (w*squareSize) / 2;
+  double offsetY = (l*squareSize) / 2;
+
+#pragma omp parallel for schedule(dynamic, 16)
+  for (int i = 0; i < w; i++)
+  {
+    const float* h = (*this)[i];
+    for (int j = 0; j < l; j++)
+    {
+      const size_t k = size_t(i) * l + j;
+      vertices[k] = Vector(i*squareSize - offsetX, (l-j)*squareSize - offsetY, h[j]*heightMax);
+      normals[k] = smoothNormal(i, j, heightMax, squareSize);
+      cols[k] = generateColor(i, j, mult);
+
+      // Two triangles per square, oriented upward
+      if (i > 0 && j > 0)
+      {
+        const int first = int(k - l - 1), second = int(k - l), third = int(k - 1), fourth = int(k);
+        int* t = &va[6 * (size_t(i - 1) * (l - 1) + (j - 1))];
+        t[0] = first;
+        t[1] = second;
+        t[2] = fourth;
+        t[3] = first;
+        t[4] = fourth;
+        t[5] = third;
+      }
+    }
+  }
+
+  std::vector<int> na(va);
+  std::vector<int> ca(va);
+  return MeshColor(Mesh(std::move(vertices), std::move(normals), std::move(va), std::move(na)), std::move(cols), std::move(ca));
+}
+
+/*!
+\brief Compute the normal at a vertex of the smooth mesh, with central differences, one sided on the border.
+\param i, j Integer coordinates.
+\param heightMax Height scale.
+\param squareSize Size of a square.
+*/
+Vector HeightField::smoothNormal(int i, int j, double heightMax, double squareSize) const
+{
+  const int ip = std::max(i - 1, 0), in = std::min(i + 1, this->width - 1);
+  const int jp = std::max(j - 1, 0), jn = std::min(j + 1, this->length - 1);
+  const float* h = (*this)[i];
+
+  // y decreases with j
+  const double gx = ((*this)[in][j] - (*this)[ip][j]) * heightMax / ((in - ip) * squareSize);
+  const double gy = -(h[jn] - h[jp]) * heightMax / ((jn - jp) * squareSize);
+  return Normalized(Vector(-gx, -gy, 1.0));
+}
+
 /*!
 \brief Color an height field mesh based on the slope.
 \param i The i coordinate of the vertice to color.
@@ -160,32 +580,22 @@ MeshColor HeightField::generateMesh(double heightMax, double squareSize, double
 \param mult Coefficient to amplify the slope coefficient (thus the color).
 \return The mesh color generated.
 */
-Color HeightField::generateColor(int i, int j, double mult)
+Color HeightField::generateColor(int i, int j, double mult) const
 {
   // Compute X and Y slope (Distance = 1 and height between 0 and 1)
-  double slopeAngle1 = 0;
-  double slopeAngle2 = 0;
-  if (i > 0 && j > 0)
-  {
-    slopeAngle1 = height[i][j] - height[i-1][j];
-    slopeAngle2 = height[i][j] - height[i][j-1];
-  }
-  else if (i > 0)
-  {
-    slopeAngle1 = height[i][j] - height[i-1][j];
-    slopeAngle2 = height[i][j] - height[i][j+1];
-  }
-  else if (j > 0)
-  {
-    slopeAngle1 = height[i][j] - height[i+1][j];
-    slopeAngle2 = height[i][j] - height[i][j-1];
-  }
-  else
-  {
-    slopeAngle1 = height[i][j] - height[i+1][j];
-    slopeAngle2 = height[i][j] - height[i][j+1];
-  }
+  const float* h = (*this)[i];
+  const float* hi = (*this)[i > 0 ? i-1 : i+1];
+  return slopeColor(h[j], h[j] - hi[j], h[j] - h[j > 0 ? j-1 : j+1], mult);
+}
 
+/*!
+\brief Color a vertex based on its height and slope, as generateColor().
+\param z Height of the vertex.
+\param slopeAngle1, slopeAngle2 Differences with the previous heights along the rows and the columns, or the next ones on the border.
+\param mult Coefficient to amplify the slope coefficient (thus the color).
+*/
+Color HeightField::slopeColor(double z, double slopeAngle1, double slopeAngle2, double mult)
+{
   // Compute Norm of the vector obtained (pente between 0 and 1)
   double pente = Norm(Vector(slopeAngle1, slopeAngle2, 0));
 
@@ -193,7 +603,7 @@ Color HeightField::generateColor(int i, int j, double mult)
   Color color1;
   Color color2;
 
-  if (height[i][j] > 0.8) {
+  if (z > 0.8) {
     color1 = Color(255, 255, 255);
     color2 = Color(35, 35, 35);
   }
@@ -211,7 +621,7 @@ Color HeightField::generateColor(int i, int j, double mult)
     }
   }
 
-  return this->getColorBetweenGradient(color1, color2, mult*pente);
+  return getColorBetweenGradient(color1, color2, mult*pente);
 }
 
 /*!
@@ -225,18 +635,271 @@ Color HeightField::generateColor(int i, int j, double mult)
 */
 void HeightField::flatten(int x, int y, double radius, double floor, double strength)
 {
-  double rad = pow(radius, 2);
-  for (int i = 0; i < this->width; i++)
+  double rad = radius * radius;
+
+  // Only the square bounding the disk is modified
+  const int r = int(ceil(radius));
+  const int i0 = std::max(x - r, 0), i1 = std::min(x + r, this->width - 1);
+  const int j0 = std::max(y - r, 0), j1 = std::min(y + r, this->length - 1);
+  for (int i = i0; i <= i1; i++)
   {
-    for (int j = 0; j < this->length; j++)
+    float* h = (*this)[i];
+    for (int j = j0; j <= j1; j++)
     {
-      double distance = pow((i-x), 2) + pow((j-y), 2);
+      double distance = double(i-x) * (i-x) + double(j-y) * (j-y);
       if (distance < rad)
       {
         // Compute a gradient (Flattening strength is stronger as we get closer to the center)
-        double strengthCalc = pow((1 - (distance / rad)), 2) * strength;
-        height[i][j] = strengthCalc * floor + (1 - strengthCalc) * height[i][j];
+        double strengthCalc = (1 - (distance / rad)) * (1 - (distance / rad)) * strength;
+        h[j] = float(strengthCalc * floor + (1 - strengthCalc) * h[j]);
+      }
+    }
+  }
+  markDirty(i0, j0, i1, j1);
+}
+
+/*!
+\brief Raise or lower a disk of the height field, with the same gradation to the side as flatten().
+\param x, y Center of the brush.
+\param radius Radius of the brush.
+\param amount Height added at the center, negative to dig.
+*/
+void HeightField::raise(int x, int y, double radius, double amount)
+{
+  const double rad = radius * radius;
+  const int r = int(ceil(radius));
+  const int i0 = std::max(x - r, 0), i1 = std::min(x + r, this->width - 1);
+  const int j0 = std::max(y - r, 0), j1 = std::min(y + r, this->length - 1);
+  for (int i = i0; i <= i1; i++)
+  {
+    float* h = (*this)[i];
+    for (int j = j0; j <= j1; j++)
+    {
+      const double distance = double(i-x) * (i-x) + double(j-y) * (j-y);
+      if (distance < rad)
+      {
+        const double falloff = (1 - distance / rad) * (1 - distance / rad);
+        h[j] = float(Math::Clamp(h[j] + falloff * amount));
+      }
+    }
+  }
+  markDirty(i0, j0, i1, j1);
+}
+
+/*!
+\brief Smooth a disk of the height field, moving heights toward the mean of their neighbors.
+
+The square bounding the disk and its border are copied first, so that the result does not depend on the order of the updates.
+\param x, y Center of the brush.
+\param radius Radius of the brush.
+\param strength Strength of the smoothing at the center, between 0 and 1.
+*/
+void HeightField::smooth(int x, int y, double radius, double strength)
+{
+  const double rad = radius * radius;
+  const int r = int(ceil(radius));
+  const int i0 = std::max(x - r, 0), i1 = std::min(x + r, this->width - 1);
+  const int j0 = std::max(y - r, 0), j1 = std::min(y + r, this->length - 1);
+  if (i1 < i0 || j1 < j0)
+    return;
+
+  // Copy of the square and its border
+  const int a0 = std::max(i0 - 1, 0), a1 = std::min(i1 + 1, this->width - 1);
+  const int b0 = std::max(j0 - 1, 0), b1 = std::min(j1 + 1, this->length - 1);
+  const int n = b1 - b0 + 1;
+  std::vector<float> copy(size_t(a1 - a0 + 1) * n);
+  for (int i = a0; i <= a1; i++)
+  {
+    std::copy((*this)[i] + b0, (*this)[i] + b1 + 1, copy.begin() + size_t(i - a0) * n);
+  }
+
+  for (int i = i0; i <= i1; i++)
+  {
+    float* h = (*this)[i];
+    const float* c = &copy[size_t(i - a0) * n];
+    const float* cp = &copy[size_t(std::max(i - 1, a0) - a0) * n];
+    const float* cn = &copy[size_t(std::min(i + 1, a1) - a0) * n];
+    for (int j = j0; j <= j1; j++)
+    {
+      const double distance = double(i-x) * (i-x) + double(j-y) * (j-y);
+      if (distance < rad)
+      {
+        const int k = j - b0, kp = std::max(j - 1, b0) - b0, kn = std::min(j + 1, b1) - b0;
+        const double falloff = (1 - distance / rad) * (1 - distance / rad) * strength;
+        const double mean = 0.25 * (cp[k] + cn[k] + c[kp] + c[kn]);
+        h[j] = float(c[k] + falloff * (mean - c[k]));
+      }
+    }
+  }
+  markDirty(i0, j0, i1, j1);
+}
+
+/*!
+\brief Grow the rectangle modified by brushes.
+\param i0, j0 First row and column.
+\param i1, j1 Last row and column.
+*/
+void HeightField::markDirty(int i0, int j0, int i1, int j1)
+{
+  if (i1 < i0 || j1 < j0)
+    return;
+  if (dirty[2] < dirty[0])
+  {
+    dirty[0] = i0;
+    dirty[1] = j0;
+    dirty[2] = i1;
+    dirty[3] = j1;
+    return;
+  }
+  dirty[0] = std::min(dirty[0], i0);
+  dirty[1] = std::min(dirty[1], j0);
+  dirty[2] = std::max(dirty[2], i1);
+  dirty[3] = std::max(dirty[3], j1);
+}
+
+/*!
+\brief Get the rectangle modified by brushes since the last call to clearDirty().
+
+Uploads and meshes only need to be updated on this rectangle.
+\param i, j Returned first modified height.
+\param w, l Returned size of the rectangle.
+\return False if no height was modified.
+*/
+bool HeightField::getDirty(int& i, int& j, int& w, int& l) const
+{
+  if (dirty[2] < dirty[0])
+    return false;
+  i = dirty[0];
+  j = dirty[1];
+  w = dirty[2] - dirty[0] + 1;
+  l = dirty[3] - dirty[1] + 1;
+  return true;
+}
+
+/*!
+\brief Quantize a height field.
+\param hf The height field.
+*/
+QuantizedHeightField::QuantizedHeightField(const HeightField& hf) :width(hf.getWidth()), length(hf.getLength())
+{
+  const HeightView view = hf.View();
+  a = 0.0f;
+  b = 1.0f;
+  if (width > 0 && length > 0)
+  {
+    a = b = view(0, 0);
+    for (int i = 0; i < width; i++)
+    {
+      const float* h = view[i];
+      for (int j = 0; j < length; j++)
+      {
+        a = std::min(a, h[j]);
+        b = std::max(b, h[j]);
       }
     }
   }
+  const float scale = (b > a) ? 65535.0f / (b - a) : 0.0f;
+
+  height.resize(size_t(width) * length);
+#pragma omp parallel for
+  for (int i = 0; i < width; i++)
+  {
+    const float* h = view[i];
+    for (int j = 0; j < length; j++)
+    {
+      height[size_t(i) * length + j] = uint16_t((h[j] - a) * scale + 0.5f);
+    }
+  }
+}
+
+/*!
+\brief Get the width.
+*/
+int QuantizedHeightField::getWidth() const
+{
+  return width;
+}
+
+/*!
+\brief Get the length.
+*/
+int QuantizedHeightField::getLength() const
+{
+  return length;
+}
+
+/*!
+\brief Convert back to a height field.
+*/
+HeightField QuantizedHeightField::Decode() const
+{
+  HeightField hf(width, length);
+#pragma omp parallel for
+  for (int i = 0; i < width; i++)
+  {
+    float* h = hf[i];
+    for (int j = 0; j < length; j++)
+    {
+      h[j] = (*this)(i, j);
+    }
+  }
+  return hf;
+}
+
+/*!
+\brief Convert a height field to tiles.
+
+Tiles on the border are padded with the closest heights.
+\param hf The height field.
+*/
+TiledHeightField::TiledHeightField(const HeightField& hf) :width(hf.getWidth()), length(hf.getLength())
+{
+  tiles = (length + Tile - 1) / Tile;
+  const int rows = (width + Tile - 1) / Tile;
+  height.resize(size_t(rows) * tiles * Tile * Tile);
+
+  const HeightView view = hf.View();
+#pragma omp parallel for
+  for (int i = 0; i < rows * Tile; i++)
+  {
+    const float* h = view[std::min(i, width - 1)];
+    for (int j = 0; j < tiles * Tile; j++)
+    {
+      height[Index(i, j)] = h[std::min(j, length - 1)];
+    }
+  }
+}
+
+/*!
+\brief Get the width.
+*/
+int TiledHeightField::getWidth() const
+{
+  return width;
+}
+
+/*!
+\brief Get the length.
+*/
+int TiledHeightField::getLength() const
+{
+  return length;
+}
+
+/*!
+\brief Convert back to a height field.
+*/
+HeightField TiledHeightField::Decode() const
+{
+  HeightField hf(width, length);
+#pragma omp parallel for
+  for (int i = 0; i < width; i++)
+  {
+    float* h = hf[i];
+    for (int j = 0; j < length; j++)
+    {
+      h[j] = (*this)(i, j);
+    }
+  }
+  return hf;
 }
@@ -0,0 +1,332 @@
+// HeightFieldContour
+
+#include "heightfieldcontour.h"
+
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+
+/*!
+\class HeightFieldContour heightfieldcontour.h
+\brief Contour lines of a height field at several heights, with marching squares.
+
+The grid is covered by square tiles processed in parallel. Every square is visited once for all the heights: the
+heights crossing a square are the range of the sorted heights between its lowest and highest samples, so that adding
+heights does not add passes over the grid. Corners on a contour height are considered above it, so that every edge
+of the grid is crossed at most once per height, and squares with two opposite corners above are resolved with the
+average of their corners.
+
+Crossings are identified by the edges of the grid they lie on. Segments are chained into pieces of lines inside
+every tile through an array indexed by the edges of the tile, and pieces ending on the border of a tile are then stitched to the pieces of the neighboring tiles
+through their end edges. Points are computed from the edges at the end, so that neighboring squares share them
+exactly.
+
+The pieces of every tile are kept, so that after a modification of the heights only the tiles covering the modified
+rectangle are extracted again before stitching, which only visits the pieces of the lines.
+
+\code
+HeightFieldContour contour(hf, heightMax, squareSize);
+contour.SetLevels({ 10.0, 20.0, 30.0 });
+std::vector<std::vector<std::vector<Vector>>> lines = contour.Lines(); // Lines of every height
+hf.flatten(i, j, radius, hf[i][j], 1);
+int x, y, w, l;
+if (hf.getDirty(x, y, w, l))
+  contour.Update(x, y, w, l); // Only the tiles covering the brush
+lines = contour.Lines();
+\endcode
+*/
+
+/*!
+\brief Find the line starting with an edge, in a hash of the edges of the lines.
+\param first Hash.
+\param key Edge.
+*/
+static inline int Find(const std::unordered_map<uint64_t, int>& first, uint64_t key)
+{
+  const auto it = first.find(key);
+  return (it == first.end()) ? -1 : it->second;
+}
+
+/*!
+\brief Find the line starting with an edge, in an array indexed by the edges of a tile.
+\param first Array.
+\param key Edge.
+*/
+static inline int Find(const std::vector<int>& first, uint64_t key)
+{
+  return first[key];
+}
+
+/*!
+\brief Chain lines whose last edge is the first edge of another one.
+
+Lines of a contour are oriented consistently, so that an edge starts and ends at most one line.
+Closed loops end with their first edge.
+\param pieces Lines.
+\param first Index of the line starting with every edge, either a hash or an array, filled by the function.
+\param open, closed Returned open and closed lines.
+*/
+template<typename Index>
+static void Chain(const ContourLines& pieces, Index& first, ContourLines& open, ContourLines& closed)
+{
+  const int n = pieces.Size();
+  for (int i = 0; i < n; i++)
+  {
+    first[pieces.Front(i)] = i;
+  }
+
+  std::vector<int> next(n, -1);
+  std::vector<bool> previous(n, false), used(n, false);
+  for (int i = 0; i < n; i++)
+  {
+    next[i] = Find(first, pieces.Back(i));
+    if (next[i] >= 0)
+      previous[next[i]] = true;
+  }
+
+  auto follow = [&](int i, ContourLines& lines)
+    {
+      lines.keys.push_back(pieces.Front(i));
+      while (i >= 0 && !used[i])
+      {
+        used[i] = true;
+        lines.keys.insert(lines.keys.end(), pieces.keys.begin() + pieces.starts[i] + 1, pieces.keys.begin() + pieces.starts[i + 1]);
+        i = next[i];
+      }
+      lines.Close();
+    };
+
+  // Open lines from the pieces without predecessor, then closed loops
+  for (int i = 0; i < n; i++)
+  {
+    if (!previous[i])
+      follow(i, open);
+  }
+  for (int i = 0; i < n; i++)
+  {
+    if (!used[i])
+      follow(i, closed);
+  }
+}
+
+/*!
+\brief Create the contour extraction of a height field.
+
+The height field is referenced.
+\param hf The height field.
+\param heightMax Height scale.
+\param squareSize Size of a square of the grid.
+*/
+HeightFieldContour::HeightFieldContour(const HeightField& hf, double heightMax, double squareSize) :hf(hf), heightMax(heightMax), squareSize(squareSize), width(hf.getWidth()), length(hf.getLength())
+{
+}
+
+/*!
+\brief Compute the point of a contour line on an edge of the grid.
+\param key Edge, twice the index of its first sample, plus one if it is along the row.
+\param level Height of the contour, in units of the height field.
+*/
+Vector HeightFieldContour::Crossing(uint64_t key, float level) const
+{
+  const int s = int(key >> 1);
+  const int i = s / length, j = s % length;
+  const int di = (key & 1) ? 0 : 1, dj = (key & 1) ? 1 : 0;
+  const float a = hf[i][j], b = hf[i + di][j + dj];
+  const double t = double(level - a) / double(b - a);
+  const double u = i + t * di, v = j + t * dj;
+  return Vector(u * squareSize - 0.5 * width * squareSize, (length - v) * squareSize - 0.5 * length * squareSize, level * heightMax);
+}
+
+/*!
+\brief Set the heights of the contours, and extract the pieces of lines of all the tiles in a single pass over the grid.
+
+Call Lines() afterward to stitch the pieces.
+\param levels Heights of the contours, in world units.
+*/
+void HeightFieldContour::SetLevels(const std::vector<double>& levels)
+{
+  const int n = int(levels.size());
+
+  // Sorted heights, in units of the height field
+  order.resize(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](int a, int b) { return levels[a] < levels[b]; });
+  iso.resize(n);
+  for (int l = 0; l < n; l++)
+  {
+    iso[l] = float(levels[order[l]] / heightMax);
+  }
+
+  tw = (width >= 2) ? (width - 1 + Tile - 1) / Tile : 0;
+  tl = (length >= 2) ? (length - 1 + Tile - 1) / Tile : 0;
+  open.assign(size_t(tw) * tl, std::vector<ContourLines>(n));
+  closed.assign(size_t(tw) * tl, std::vector<ContourLines>(n));
+  Update(0, 0, width, length);
+}
+
+/*!
+\brief Extract the pieces of lines of the tiles covering a rectangle of modified heights again.
+
+Call Lines() afterward to stitch the pieces.
+\param i, j First modified height.
+\param w, l Size of the rectangle.
+*/
+void HeightFieldContour::Update(int i, int j, int w, int l)
+{
+  // Tiles of the squares sharing a modified height
+  const int x0 = std::max(i - 1, 0) / Tile, x1 = std::min(std::min(i + w - 1, width - 2) / Tile, tw - 1);
+  const int y0 = std::max(j - 1, 0) / Tile, y1 = std::min(std::min(j + l - 1, length - 2) / Tile, tl - 1);
+  if (x1 < x0 || y1 < y0 || iso.empty())
+    return;
+  const int n = (x1 - x0 + 1) * (y1 - y0 + 1);
+
+#pragma omp parallel
+  {
+    // Segments use the edges of the tile, indexed by the array of the first edges of the lines
+    std::vector<ContourLines> segments(iso.size());
+    std::vector<int> first(2 * size_t(Tile + 1) * (Tile + 1), -1);
+#pragma omp for schedule(dynamic, 1)
+    for (int m = 0; m < n; m++)
+    {
+      Extract((x0 + m / (y1 - y0 + 1)) * tl + y0 + m % (y1 - y0 + 1), segments, first);
+    }
+  }
+}
+
+/*!
+\brief Extract the pieces of lines of a tile.
+\param t Tile.
+\param segments, first Scratch buffers of the thread, the segments of every height and the array of the first edges of the lines, which is left filled with -1.
+*/
+void HeightFieldContour::Extract(int t, std::vector<ContourLines>& segments, std::vector<int>& first)
+{
+  const int n = int(iso.size());
+  const int i0 = (t / tl) * Tile, j0 = (t % tl) * Tile;
+  const int i1 = std::min(i0 + Tile, width - 1), j1 = std::min(j0 + Tile, length - 1);
+  for (int l = 0; l < n; l++)
+  {
+    open[t][l].Clear();
+    closed[t][l].Clear();
+  }
+
+  for (int i = i0; i < i1; i++)
+  {
+    const float* r0 = hf[i];
+    const float* r1 = hf[i + 1];
+    for (int j = j0; j < j1; j++)
+    {
+      // Corners of the square, turning from the sample (i, j)
+      const float h[4] = { r0[j], r1[j], r1[j + 1], r0[j + 1] };
+      const float lo = std::min(std::min(h[0], h[1]), std::min(h[2], h[3]));
+      const float hi = std::max(std::max(h[0], h[1]), std::max(h[2], h[3]));
+
+      // Heights crossing the square are between its lowest sample, excluded, and its highest sample
+      const int a = int(std::upper_bound(iso.begin(), iso.end(), lo) - iso.begin());
+      const int b = int(std::upper_bound(iso.begin() + a, iso.end(), hi) - iso.begin());
+
+      const uint64_t s = uint64_t(i - i0) * (Tile + 1) + j - j0;
+      const uint64_t edges[4] = { 2 * s, 2 * (s + Tile + 1) + 1, 2 * (s + 1), 2 * s + 1 };
+      for (int l = a; l < b; l++)
+      {
+        int above = 0;
+        for (int k = 0; k < 4; k++)
+          above |= (h[k] >= iso[l]) ? (1 << k) : 0;
+
+        // Two opposite corners above are joined through the center if it is above
+        const bool saddle = (above == 5 || above == 10);
+        const bool joined = saddle && (h[0] + h[1] + h[2] + h[3] >= 4.0f * iso[l]);
+
+        ContourLines& lines = segments[l];
+        for (int k = 0; k < 4; k++)
+        {
+          // Edge k joins corners k and k + 1, segments go from the edges entering the region above to the edges leaving it
+          if ((above >> k & 1) != 0 || (above >> ((k + 1) & 3) & 1) == 0)
+            continue;
+          int e = (k + 1) & 3;
+          if (saddle)
+            e = joined ? ((k + 3) & 3) : e;
+          else
+          {
+            while ((above >> e & 1) == 0 || (above >> ((e + 1) & 3) & 1) != 0)
+              e = (e + 1) & 3;
+          }
+          lines.keys.push_back(edges[k]);
+          lines.keys.push_back(edges[e]);
+          lines.Close();
+        }
+      }
+    }
+  }
+
+  // Chain the segments of the tile, pieces crossing its border are stitched afterward
+  for (int l = 0; l < n; l++)
+  {
+    ContourLines& lines = segments[l];
+    if (lines.keys.empty())
+      continue;
+    Chain(lines, first, open[t][l], closed[t][l]);
+    for (int i = 0; i < lines.Size(); i++)
+      first[lines.Front(i)] = -1;
+    lines.Clear();
+
+    // Edges of the grid
+    for (ContourLines* c : { &open[t][l], &closed[t][l] })
+    {
+      for (uint64_t& key : c->keys)
+      {
+        const int e = int(key >> 1);
+        key = 2 * (uint64_t(i0 + e / (Tile + 1)) * length + j0 + e % (Tile + 1)) + (key & 1);
+      }
+    }
+  }
+}
+
+/*!
+\brief Stitch the pieces of lines of the tiles.
+
+Lines turn counterclockwise around higher ground seen from above. Open lines end on the border of the grid,
+and closed loops end with their first point.
+\return The lines of every height, in the order of the heights given to SetLevels().
+*/
+std::vector<std::vector<std::vector<Vector>>> HeightFieldContour::Lines() const
+{
+  const int n = int(iso.size());
+  std::vector<std::vector<std::vector<Vector>>> contours(n);
+
+  // Stitch the pieces of every height across tiles
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int l = 0; l < n; l++)
+  {
+    ContourLines pieces, lines, loops;
+    for (int t = 0; t < tw * tl; t++)
+    {
+      const ContourLines& p = open[t][l];
+      const int offset = int(pieces.keys.size());
+      pieces.keys.insert(pieces.keys.end(), p.keys.begin(), p.keys.end());
+      for (int i = 1; i < int(p.starts.size()); i++)
+        pieces.starts.push_back(offset + p.starts[i]);
+    }
+    std::unordered_map<uint64_t, int> first;
+    first.reserve(pieces.Size());
+    Chain(pieces, first, lines, loops);
+
+    // Open lines first, then loops closed inside a tile or across tiles
+    std::vector<std::vector<Vector>>& polylines = contours[order[l]];
+    auto add = [&](const ContourLines& c)
+      {
+        for (int i = 0; i < c.Size(); i++)
+        {
+          std::vector<Vector> polyline;
+          polyline.reserve(c.starts[i + 1] - c.starts[i]);
+          for (int k = c.starts[i]; k < c.starts[i + 1]; k++)
+            polyline.push_back(Crossing(c.keys[k], iso[l]));
+          polylines.push_back(std::move(polyline));
+        }
+      };
+    add(lines);
+    add(loops);
+    for (int t = 0; t < tw * tl; t++)
+      add(closed[t][l]);
+  }
+  return contours;
+}
@@ -0,0 +1,372 @@
+// HeightFieldErosion
+
+#include "heightfielderosion.h"
+
+#include <algorithm>
+#include <cmath>
+
+/*!
+\class HeightFieldErosion heightfielderosion.h
+\brief Hydraulic and thermal erosion of a height field, simulated on its grid.
+
+Hydraulic erosion follows the virtual pipe model: rain fills the cells, water flows to the four neighbors
+through pipes whose flux is driven by the difference of water levels, and the velocity of the water
+dissolves the terrain into suspended sediment or deposits it, depending on the capacity of the flow.
+Sediment is then advected backward along the velocity. Thermal erosion moves material down the slopes
+steeper than the angle of repose.
+
+Every step is a stencil kernel reading the state of the previous step and writing its own cells only,
+with double buffers where a cell depends on its neighbors, so that rows are processed in parallel and
+cells of a row are vectorized. Heights are eroded in world units, and written back to the height field
+at the end of every simulation.
+
+\code
+HeightFieldErosion erosion(hf, heightMax, squareSize);
+erosion.Hydraulic(1000);
+erosion.Thermal(100);
+\endcode
+*/
+
+/*!
+\brief Create the simulation, with no water.
+
+The height field is modified by the simulations, and should not be resized while the simulation exists.
+\param hf The height field.
+\param heightMax Height scale.
+\param squareSize Size of a square of the grid.
+*/
+HeightFieldErosion::HeightFieldErosion(HeightField& hf, double heightMax, double squareSize) :hf(hf), width(hf.getWidth()), length(hf.getLength()), heightMax(heightMax), squareSize(squareSize)
+{
+  const size_t n = size_t(width) * length;
+  b.resize(n);
+  next.resize(n);
+  water.assign(n, 0.0f);
+  sediment.assign(n, 0.0f);
+  transported.assign(n, 0.0f);
+  for (int k = 0; k < 4; k++)
+    flux[k].assign(n, 0.0f);
+  u.assign(n, 0.0f);
+  v.assign(n, 0.0f);
+
+  const float scale = float(heightMax);
+#pragma omp parallel for
+  for (int i = 0; i < width; i++)
+  {
+    const float* h = hf[i];
+    float* t = &b[size_t(i) * length];
+#pragma omp simd
+    for (int j = 0; j < length; j++)
+    {
+      t[j] = h[j] * scale;
+    }
+  }
+}
+
+/*!
+\brief Write the terrain heights back to the height field.
+*/
+void HeightFieldErosion::Store() const
+{
+  const float scale = float(1.0 / heightMax);
+#pragma omp parallel for
+  for (int i = 0; i < width; i++)
+  {
+    float* h = hf[i];
+    const float* t = &b[size_t(i) * length];
+#pragma omp simd
+    for (int j = 0; j < length; j++)
+    {
+      h[j] = t[j] * scale;
+    }
+  }
+}
+
+/*!
+\brief Add rain, and update the outflow flux toward the neighbors.
+
+The flux is scaled so that a cell never loses more water than it contains, and is null across the border of the grid.
+*/
+void HeightFieldErosion::Flux()
+{
+  const float k = float(dt * gravity * squareSize);
+  const float area = float(squareSize * squareSize);
+  const float r = float(dt * rain);
+  const float step = float(dt);
+
+#pragma omp parallel for simd schedule(static)
+  for (long long k = 0; k < (long long)(water.size()); k++)
+  {
+    water[k] += r;
+  }
+
+#pragma omp parallel for schedule(static)
+  for (int i = 0; i < width; i++)
+  {
+    const size_t row = size_t(i) * length;
+    const size_t up = (i > 0) ? row - length : row, down = (i < width - 1) ? row + length : row;
+    const float mu = (i > 0) ? 1.0f : 0.0f, md = (i < width - 1) ? 1.0f : 0.0f;
+    float* f0 = &flux[0][row];
+    float* f1 = &flux[1][row];
+    float* f2 = &flux[2][row];
+    float* f3 = &flux[3][row];
+    const float* d = &water[row];
+    const float* t = &b[row];
+    const float* tu = &b[up];
+    const float* td = &b[down];
+    const float* du = &water[up];
+    const float* dd = &water[down];
+
+#pragma omp simd
+    for (int j = 0; j < length; j++)
+    {
+      const int jl = (j > 0) ? j - 1 : j, jr = (j < length - 1) ? j + 1 : j;
+      const float ml = (j > 0) ? 1.0f : 0.0f, mr = (j < length - 1) ? 1.0f : 0.0f;
+      const float h = t[j] + d[j];
+
+      const float a0 = mu * std::max(0.0f, f0[j] + k * (h - tu[j] - du[j]));
+      const float a1 = md * std::max(0.0f, f1[j] + k * (h - td[j] - dd[j]));
+      const float a2 = ml * std::max(0.0f, f2[j] + k * (h - t[jl] - d[jl]));
+      const float a3 = mr * std::max(0.0f, f3[j] + k * (h - t[jr] - d[jr]));
+
+      const float sum = a0 + a1 + a2 + a3;
+      const float s = (sum > 0.0f) ? std::min(1.0f, d[j] * area / (sum * step)) : 0.0f;
+      f0[j] = a0 * s;
+      f1[j] = a1 * s;
+      f2[j] = a2 * s;
+      f3[j] = a3 * s;
+    }
+  }
+}
+
+/*!
+\brief Update the water heights from the flux, and compute the velocity of the water.
+*/
+void HeightFieldErosion::Velocity()
+{
+  const float area = float(squareSize * squareSize);
+  const float l = float(squareSize);
+  const float step = float(dt);
+
+#pragma omp parallel for schedule(static)
+  for (int i = 0; i < width; i++)
+  {
+    const size_t row = size_t(i) * length;
+    const size_t up = (i > 0) ? row - length : row, down = (i < width - 1) ? row + length : row;
+    const float mu = (i > 0) ? 1.0f : 0.0f, md = (i < width - 1) ? 1.0f : 0.0f;
+    const float* f0 = &flux[0][row];
+    const float* f1 = &flux[1][row];
+    const float* f2 = &flux[2][row];
+    const float* f3 = &flux[3][row];
+    const float* f1u = &flux[1][up];
+    const float* f0d = &flux[0][down];
+    float* d = &water[row];
+    float* pu = &u[row];
+    float* pv = &v[row];
+
+#pragma omp simd
+    for (int j = 0; j < length; j++)
+    {
+      const int jl = (j > 0) ? j - 1 : j, jr = (j < length - 1) ? j + 1 : j;
+      const float ml = (j > 0) ? 1.0f : 0.0f, mr = (j < length - 1) ? 1.0f : 0.0f;
+
+      const float inu = mu * f1u[j], ind = md * f0d[j], inl = ml * f3[jl], inr = mr * f2[jr];
+      const float in = inu + ind + inl + inr;
+      const float out = f0[j] + f1[j] + f2[j] + f3[j];
+      const float w = std::max(0.0f, d[j] + step * (in - out) / area);
+
+      // Mean water height during the step, and flow through the cell
+      const float mean = 0.5f * (d[j] + w);
+      const float wi = 0.5f * (inu - f0[j] + f1[j] - ind);
+      const float wj = 0.5f * (inl - f2[j] + f3[j] - inr);
+      pu[j] = (mean > 1.0e-5f) ? wi / (l * mean) : 0.0f;
+      pv[j] = (mean > 1.0e-5f) ? wj / (l * mean) : 0.0f;
+      d[j] = w;
+    }
+  }
+}
+
+/*!
+\brief Dissolve the terrain or deposit sediment, depending on the capacity of the flow.
+*/
+void HeightFieldErosion::Erode()
+{
+  const float l = float(squareSize);
+  const float kc = float(capacity), ks = float(std::min(1.0, dissolving * dt)), kd = float(std::min(1.0, deposition * dt));
+  const float minimum = float(tilt);
+
+#pragma omp parallel for schedule(static)
+  for (int i = 0; i < width; i++)
+  {
+    const size_t row = size_t(i) * length;
+    const size_t up = (i > 0) ? row - length : row, down = (i < width - 1) ? row + length : row;
+    const float di = float((i > 0) + (i < width - 1)) * l;
+    const float* t = &b[row];
+    const float* tu = &b[up];
+    const float* td = &b[down];
+    const float* pu = &u[row];
+    const float* pv = &v[row];
+    const float* d = &water[row];
+    float* s = &sediment[row];
+    float* o = &next[row];
+
+#pragma omp simd
+    for (int j = 0; j < length; j++)
+    {
+      const int jl = (j > 0) ? j - 1 : j, jr = (j < length - 1) ? j + 1 : j;
+      const float dj = float(jr - jl) * l;
+
+      // Sine of the slope, from central differences
+      const float gi = (di > 0.0f) ? (td[j] - tu[j]) / di : 0.0f;
+      const float gj = (dj > 0.0f) ? (t[jr] - t[jl]) / dj : 0.0f;
+      const float g2 = gi * gi + gj * gj;
+      const float sine = std::max(minimum, std::sqrt(g2 / (1.0f + g2)));
+
+      // Capacity, bounded by the water height so that shallow and fast flows do not dig the terrain
+      const float c = std::min(kc * sine * std::sqrt(pu[j] * pu[j] + pv[j] * pv[j]), d[j]);
+      const float e = (c > s[j]) ? ks * (c - s[j]) : -kd * (s[j] - c);
+      o[j] = t[j] - e;
+      s[j] += e;
+    }
+  }
+  std::swap(b, next);
+}
+
+/*!
+\brief Advect the sediment backward along the velocity, and evaporate water.
+*/
+void HeightFieldErosion::Transport()
+{
+  const float step = float(dt / squareSize);
+  const float keep = float(std::max(0.0, 1.0 - evaporation * dt));
+  const float wi = float(width - 1), wj = float(length - 1);
+
+#pragma omp parallel for schedule(static)
+  for (int i = 0; i < width; i++)
+  {
+    const size_t row = size_t(i) * length;
+    const float* pu = &u[row];
+    const float* pv = &v[row];
+    float* o = &transported[row];
+    float* d = &water[row];
+
+    for (int j = 0; j < length; j++)
+    {
+      // Bilinear interpolation at the origin of the flow
+      const float x = std::min(std::max(float(i) - pu[j] * step, 0.0f), wi);
+      const float y = std::min(std::max(float(j) - pv[j] * step, 0.0f), wj);
+      const int x0 = std::min(int(x), width - 2), y0 = std::min(int(y), length - 2);
+      const int x1 = x0 + 1, y1 = y0 + 1;
+      const float fx = x - float(x0), fy = y - float(y0);
+      const float* s0 = &sediment[size_t(x0) * length];
+      const float* s1 = &sediment[size_t(x1) * length];
+      o[j] = (1.0f - fx) * ((1.0f - fy) * s0[y0] + fy * s0[y1]) + fx * ((1.0f - fy) * s1[y0] + fy * s1[y1]);
+    }
+
+#pragma omp simd
+    for (int j = 0; j < length; j++)
+    {
+      d[j] *= keep;
+    }
+  }
+  std::swap(sediment, transported);
+}
+
+/*!
+\brief Simulate hydraulic erosion, and update the height field.
+\param n Number of iterations.
+*/
+void HeightFieldErosion::Hydraulic(int n)
+{
+  if (width < 2 || length < 2)
+    return;
+  for (int k = 0; k < n; k++)
+  {
+    Flux();
+    Velocity();
+    Erode();
+    Transport();
+  }
+  Store();
+}
+
+/*!
+\brief Simulate thermal erosion, and update the height field.
+
+Every cell moves a fraction of the material above the angle of repose to its lower neighbors, in proportion to their
+height differences. The flux of the hydraulic simulation is used as a buffer, and reset.
+\param n Number of iterations.
+*/
+void HeightFieldErosion::Thermal(int n)
+{
+  if (width < 2 || length < 2)
+    return;
+
+  const float limit = float(talus * squareSize);
+  const float rate = float(std::min(1.0, thermal * dt) * 0.5);
+  for (int iteration = 0; iteration < n; iteration++)
+  {
+    // Material leaving every cell toward its neighbors
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < width; i++)
+    {
+      const size_t row = size_t(i) * length;
+      const size_t up = (i > 0) ? row - length : row, down = (i < width - 1) ? row + length : row;
+      const float* t = &b[row];
+      const float* tu = &b[up];
+      const float* td = &b[down];
+      float* o0 = &flux[0][row];
+      float* o1 = &flux[1][row];
+      float* o2 = &flux[2][row];
+      float* o3 = &flux[3][row];
+
+#pragma omp simd
+      for (int j = 0; j < length; j++)
+      {
+        const int jl = (j > 0) ? j - 1 : j, jr = (j < length - 1) ? j + 1 : j;
+        // Neighbors outside the grid are the cell itself, and are never lower
+        const float e0 = std::max(0.0f, t[j] - tu[j] - limit);
+        const float e1 = std::max(0.0f, t[j] - td[j] - limit);
+        const float e2 = std::max(0.0f, t[j] - t[jl] - limit);
+        const float e3 = std::max(0.0f, t[j] - t[jr] - limit);
+        const float sum = e0 + e1 + e2 + e3;
+        const float amount = rate * std::max(std::max(e0, e1), std::max(e2, e3));
+        const float s = (sum > 0.0f) ? amount / sum : 0.0f;
+        o0[j] = e0 * s;
+        o1[j] = e1 * s;
+        o2[j] = e2 * s;
+        o3[j] = e3 * s;
+      }
+    }
+
+    // Gather the material from the neighbors
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < width; i++)
+    {
+      const size_t row = size_t(i) * length;
+      const size_t up = (i > 0) ? row - length : row, down = (i < width - 1) ? row + length : row;
+      const float mu = (i > 0) ? 1.0f : 0.0f, md = (i < width - 1) ? 1.0f : 0.0f;
+      const float* t = &b[row];
+      const float* o0 = &flux[0][row];
+      const float* o1 = &flux[1][row];
+      const float* o2 = &flux[2][row];
+      const float* o3 = &flux[3][row];
+      const float* o1u = &flux[1][up];
+      const float* o0d = &flux[0][down];
+      float* h = &next[row];
+
+#pragma omp simd
+      for (int j = 0; j < length; j++)
+      {
+        const int jl = (j > 0) ? j - 1 : j, jr = (j < length - 1) ? j + 1 : j;
+        const float ml = (j > 0) ? 1.0f : 0.0f, mr = (j < length - 1) ? 1.0f : 0.0f;
+        const float in = mu * o1u[j] + md * o0d[j] + ml * o3[jl] + mr * o2[jr];
+        h[j] = t[j] - (o0[j] + o1[j] + o2[j] + o3[j]) + in;
+      }
+    }
+    std::swap(b, next);
+  }
+
+  for (int k = 0; k < 4; k++)
+    std::fill(flux[k].begin(), flux[k].end(), 0.0f);
+  Store();
+}
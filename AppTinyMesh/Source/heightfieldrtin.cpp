@@ -0,0 +1,316 @@
+// HeightFieldRTIN
+
+#include "heightfieldrtin.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+/*!
+\class HeightFieldRTIN heightfieldrtin.h
+\brief Error bounded triangulation of a height field with right triangulated irregular networks.
+
+The grid is covered by square tiles, and every tile is the binary tree of right triangles obtained by splitting
+triangles along their hypotenuse, down to the half squares of the grid. The error of a vertex is the maximal vertical
+distance between the samples covered by the triangles whose hypotenuse it splits and the planes of these triangles,
+and at least the error of the vertices splitting the smaller triangles, so that the error of a mesh is exactly bounded,
+splitting a triangle always splits its neighbor across the hypotenuse, and meshes never have cracks.
+
+Errors are computed once, level by level from the smallest triangles, in parallel over tiles. After every level,
+the errors of the vertices on the borders of the tiles are merged with the neighboring tile, so that both tiles split
+their common edge the same way. Triangles partially outside of the grid are always split, so that grids of any size are
+supported. Meshes for any error are then extracted per tile in parallel.
+
+\code
+HeightFieldRTIN rtin(hf);
+MeshColor mesh = rtin.Triangulate(0.5, heightMax, squareSize, mult);
+\endcode
+*/
+
+/*!
+\brief Compute the errors of the vertices of a height field.
+
+The height field is referenced, and should not be modified while triangulating.
+\param hf The height field.
+*/
+HeightFieldRTIN::HeightFieldRTIN(const HeightField& hf) :hf(hf), width(hf.getWidth()), length(hf.getLength())
+{
+  tw = std::max((width - 1 + Tile - 1) / Tile, 1);
+  tl = std::max((length - 1 + Tile - 1) / Tile, 1);
+  errors.assign(size_t(tw) * tl, std::vector<float>(size_t(Tile + 1) * (Tile + 1), 0.0f));
+  if (width < 2 || length < 2)
+    return;
+
+  // Smallest triangles first, up to the two triangles of a tile
+  int depth = 1;
+  while ((1 << (depth - 1)) < 2 * Tile * Tile)
+    depth++;
+  for (int level = depth - 1; level >= 2; level--)
+  {
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int t = 0; t < tw * tl; t++)
+    {
+      Level(t, level);
+    }
+    Merge();
+  }
+}
+
+/*!
+\brief Check the position of a triangle with respect to the grid.
+\param t Tile.
+\param ax, ay, bx, by, cx, cy Vertices in the tile.
+\return 0 if the triangle is inside, 2 if it is outside, and 1 if it crosses the border and should be split.
+*/
+int HeightFieldRTIN::Outside(int t, int ax, int ay, int bx, int by, int cx, int cy) const
+{
+  const int x0 = (t / tl) * Tile, y0 = (t % tl) * Tile;
+  const int xmin = x0 + std::min(std::min(ax, bx), cx), xmax = x0 + std::max(std::max(ax, bx), cx);
+  const int ymin = y0 + std::min(std::min(ay, by), cy), ymax = y0 + std::max(std::max(ay, by), cy);
+  if (xmax <= width - 1 && ymax <= length - 1)
+    return 0;
+  if (xmin >= width - 1 || ymin >= length - 1)
+    return 2;
+  return 1;
+}
+
+/*!
+\brief Compute the maximal vertical distance between the samples covered by a triangle and its plane.
+\param t Tile.
+\param ax, ay, bx, by, cx, cy Vertices of the triangle in the tile.
+*/
+float HeightFieldRTIN::Exact(int t, int ax, int ay, int bx, int by, int cx, int cy) const
+{
+  const int x0 = (t / tl) * Tile, y0 = (t % tl) * Tile;
+  const float ha = hf[x0 + ax][y0 + ay], hb = hf[x0 + bx][y0 + by], hc = hf[x0 + cx][y0 + cy];
+  const int d = (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+  float e = 0.0f;
+  const int xa = std::min(std::min(ax, bx), cx), xb = std::max(std::max(ax, bx), cx);
+  const int ya = std::min(std::min(ay, by), cy), yb = std::max(std::max(ay, by), cy);
+  for (int x = xa; x <= xb; x++)
+  {
+    const float* h = hf[x0 + x] + y0;
+    for (int y = ya; y <= yb; y++)
+    {
+      const int u = (bx - x) * (cy - y) - (by - y) * (cx - x);
+      const int v = (cx - x) * (ay - y) - (cy - y) * (ax - x);
+      const int w = d - u - v;
+      if ((d > 0 && (u < 0 || v < 0 || w < 0)) || (d < 0 && (u > 0 || v > 0 || w > 0)))
+        continue;
+      const float p = (u * ha + v * hb + w * hc) / float(d);
+      e = std::max(e, std::abs(h[y] - p));
+    }
+  }
+  return e;
+}
+
+/*!
+\brief Compute the errors of the vertices splitting the triangles of a level of a tile.
+
+Triangles are numbered by their path in the binary tree, read from the least significant bit: the leading bit
+only marks the length of the path, the lowest bit selects one of the two triangles of the tile, and every following
+bit selects a child of the previous triangle. The two triangles of the tile are 2 and 3, and the children of a triangle
+k of level l insert a bit just below its leading one, k + 2<sup>l-1</sup> and k + 2<sup>l</sup>, so that a level
+of the tree is still a range of numbers.
+\param t Tile.
+\param level Level, the number of bits of the triangles of the level.
+*/
+void HeightFieldRTIN::Level(int t, int level)
+{
+  const int size = Tile + 1;
+  const bool smallest = (1 << (level - 1)) == Tile * Tile;
+  std::vector<float>& e = errors[t];
+
+  for (int id = 1 << (level - 1); id < (1 << level); id++)
+  {
+    // Vertices of the triangle, the hypotenuse is ab
+    int ax = 0, ay = 0, bx = 0, by = 0, cx = 0, cy = 0;
+    if (id & 1)
+    {
+      bx = by = cx = Tile;
+    }
+    else
+    {
+      ax = ay = cy = Tile;
+    }
+    for (int k = id >> 1; k > 1; k >>= 1)
+    {
+      const int mx = (ax + bx) >> 1, my = (ay + by) >> 1;
+      if (k & 1)
+      {
+        bx = ax;
+        by = ay;
+        ax = cx;
+        ay = cy;
+      }
+      else
+      {
+        ax = bx;
+        ay = by;
+        bx = cx;
+        by = cy;
+      }
+      cx = mx;
+      cy = my;
+    }
+
+    const int position = Outside(t, ax, ay, bx, by, cx, cy);
+    if (position == 2)
+      continue;
+
+    const int mx = (ax + bx) >> 1, my = (ay + by) >> 1;
+    float& error = e[size_t(mx) * size + my];
+    if (position == 1)
+    {
+      error = FLT_MAX;
+      continue;
+    }
+
+    float bound = Exact(t, ax, ay, bx, by, cx, cy);
+    if (!smallest)
+    {
+      bound = std::max(bound, std::max(e[size_t((ax + cx) >> 1) * size + ((ay + cy) >> 1)], e[size_t((bx + cx) >> 1) * size + ((by + cy) >> 1)]));
+    }
+    error = std::max(error, bound);
+  }
+}
+
+/*!
+\brief Merge the errors of the vertices shared by neighboring tiles.
+*/
+void HeightFieldRTIN::Merge()
+{
+  const int size = Tile + 1;
+#pragma omp parallel for
+  for (int a = 0; a < tw; a++)
+  {
+    for (int b = 0; b < tl; b++)
+    {
+      std::vector<float>& e = errors[size_t(a) * tl + b];
+      // Last column with the first column of the next tile along the row
+      if (b + 1 < tl)
+      {
+        std::vector<float>& f = errors[size_t(a) * tl + b + 1];
+        for (int x = 1; x < Tile; x++)
+        {
+          const float m = std::max(e[size_t(x) * size + Tile], f[size_t(x) * size]);
+          e[size_t(x) * size + Tile] = f[size_t(x) * size] = m;
+        }
+      }
+    }
+  }
+#pragma omp parallel for
+  for (int b = 0; b < tl; b++)
+  {
+    for (int a = 0; a + 1 < tw; a++)
+    {
+      // Last row with the first row of the next tile along the columns
+      std::vector<float>& e = errors[size_t(a) * tl + b];
+      std::vector<float>& f = errors[size_t(a + 1) * tl + b];
+      for (int y = 1; y < Tile; y++)
+      {
+        const float m = std::max(e[size_t(Tile) * size + y], f[y]);
+        e[size_t(Tile) * size + y] = f[y] = m;
+      }
+    }
+  }
+}
+
+/*!
+\brief Collect the triangles of a tile whose error is within the tolerance.
+\param t Tile.
+\param tolerance Maximal error, in units of the height field.
+\param ax, ay, bx, by, cx, cy Vertices of the triangle in the tile, the hypotenuse is ab.
+\param triangles Returned triangles, as indexes of the samples of the height field.
+*/
+void HeightFieldRTIN::Extract(int t, float tolerance, int ax, int ay, int bx, int by, int cx, int cy, std::vector<int>& triangles) const
+{
+  const int position = Outside(t, ax, ay, bx, by, cx, cy);
+  if (position == 2)
+    return;
+
+  // Half squares are never split
+  const int mx = (ax + bx) >> 1, my = (ay + by) >> 1;
+  if (std::abs(ax - cx) + std::abs(ay - cy) > 1 && (position == 1 || errors[t][size_t(mx) * (Tile + 1) + my] > tolerance))
+  {
+    Extract(t, tolerance, cx, cy, ax, ay, mx, my, triangles);
+    Extract(t, tolerance, bx, by, cx, cy, mx, my, triangles);
+    return;
+  }
+
+  // Oriented upward, as in HeightField::generateSmoothMesh(), where y decreases with j
+  const int x0 = (t / tl) * Tile, y0 = (t % tl) * Tile;
+  const int a = (x0 + ax) * length + y0 + ay, b = (x0 + bx) * length + y0 + by, c = (x0 + cx) * length + y0 + cy;
+  const bool upward = (bx - ax) * (cy - ay) - (by - ay) * (cx - ax) < 0;
+  triangles.push_back(a);
+  triangles.push_back(upward ? b : c);
+  triangles.push_back(upward ? c : b);
+}
+
+/*!
+\brief Generate the mesh with the least triangles whose vertical error is within a tolerance.
+
+Vertices are shared, and normals and colors are those of HeightField::generateSmoothMesh().
+\param error Maximal vertical error, in world units.
+\param heightMax Height scale.
+\param squareSize Size of a square of the grid.
+\param mult Coefficient to amplify the slope coefficient (thus the color).
+*/
+MeshColor HeightFieldRTIN::Triangulate(double error, double heightMax, double squareSize, double mult) const
+{
+  if (width < 2 || length < 2)
+    return MeshColor();
+
+  const float tolerance = float(error / heightMax);
+  std::vector<std::vector<int>> tiles(size_t(tw) * tl);
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int t = 0; t < tw * tl; t++)
+  {
+    Extract(t, tolerance, 0, 0, Tile, Tile, Tile, 0, tiles[t]);
+    Extract(t, tolerance, Tile, Tile, 0, 0, 0, Tile, tiles[t]);
+  }
+
+  // Index the samples used by the triangles
+  std::vector<int> index(size_t(width) * length, -1);
+  std::vector<int> samples;
+  size_t n = 0;
+  for (const std::vector<int>& triangles : tiles)
+  {
+    for (int k : triangles)
+    {
+      if (index[k] < 0)
+      {
+        index[k] = int(samples.size());
+        samples.push_back(k);
+      }
+    }
+    n += triangles.size();
+  }
+
+  std::vector<int> va;
+  va.reserve(n);
+  for (const std::vector<int>& triangles : tiles)
+  {
+    for (int k : triangles)
+      va.push_back(index[k]);
+  }
+
+  const int m = int(samples.size());
+  std::vector<Vector> vertices(m);
+  std::vector<Vector> normals(m);
+  std::vector<Color> cols(m);
+  const double offsetX = (width * squareSize) / 2;
+  const double offsetY = (length * squareSize) / 2;
+#pragma omp parallel for schedule(dynamic, 4096)
+  for (int k = 0; k < m; k++)
+  {
+    const int i = samples[k] / length, j = samples[k] % length;
+    vertices[k] = Vector(i * squareSize - offsetX, (length - j) * squareSize - offsetY, hf[i][j] * heightMax);
+    normals[k] = hf.smoothNormal(i, j, heightMax, squareSize);
+    cols[k] = hf.generateColor(i, j, mult);
+  }
+
+  std::vector<int> na(va);
+  std::vector<int> ca(va);
+  return MeshColor(Mesh(std::move(vertices), std::move(normals), std::move(va), std::move(na)), std::move(cols), std::move(ca));
+}
@@ -0,0 +1,283 @@
+// HeightFieldTracer
+
+#include "heightfieldtracer.h"
+
+#include <algorithm>
+#include <cmath>
+
+/*!
+\class HeightFieldTracer heightfieldtracer.h
+\brief Exact ray intersection with the triangles of a height field, accelerated by a maximum mipmap.
+
+The surface is the one generated by HeightField::generateSmoothMesh(), with two triangles per square.
+Level 0 of the mipmap stores the maximum height of every square, and every cell of the next level the maximum of
+2 x 2 cells. Rays are transformed to the frame of the grid, and traversed cell by cell from the coarsest level:
+cells below the ray are skipped as a whole and the traversal moves up one level, other cells are refined,
+and squares of level 0 are intersected exactly. A ray crosses a number of cells logarithmic in the size of the grid in
+most configurations, which makes picking and line of sight queries take microseconds.
+
+\code
+HeightFieldTracer tracer(hf, heightMax, squareSize);
+double t;
+if (tracer.Intersect(ray, t))
+  Vector p = ray(t);
+\endcode
+*/
+
+/*!
+\brief Create the maximum mipmap of a height field.
+
+The height field is referenced, call Update() after modifying it.
+\param hf The height field.
+\param heightMax Height scale.
+\param squareSize Size of a square of the grid.
+*/
+HeightFieldTracer::HeightFieldTracer(const HeightField& hf, double heightMax, double squareSize) :hf(hf), heightMax(heightMax), squareSize(squareSize), width(hf.getWidth()), length(hf.getLength()), a(std::numeric_limits<float>::max())
+{
+  // Levels up to a single cell
+  int w = std::max(width - 1, 1), l = std::max(length - 1, 1);
+  while (true)
+  {
+    rows.push_back(w);
+    columns.push_back(l);
+    levels.push_back(std::vector<float>(size_t(w) * l, 0.0f));
+    if (w == 1 && l == 1)
+      break;
+    w = (w + 1) / 2;
+    l = (l + 1) / 2;
+  }
+
+  Update(0, 0, width, length);
+}
+
+/*!
+\brief Update the cells covering a rectangle of modified heights.
+
+The lowest height is only lowered by the modified heights, so that it remains a lower bound of the heights
+and the bounding box used to clip rays stays conservative, without visiting the whole grid.
+\param i, j First modified height.
+\param w, l Size of the rectangle.
+*/
+void HeightFieldTracer::Update(int i, int j, int w, int l)
+{
+  if (width < 2 || length < 2)
+    return;
+
+  // Squares sharing a modified height
+  int x0 = std::max(i - 1, 0), x1 = std::min(i + w - 1, width - 2);
+  int y0 = std::max(j - 1, 0), y1 = std::min(j + l - 1, length - 2);
+  if (x1 < x0 || y1 < y0)
+    return;
+
+  for (int k = 0; k < int(levels.size()); k++)
+  {
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int x = x0; x <= x1; x++)
+    {
+      for (int y = y0; y <= y1; y++)
+      {
+        Reduce(k, x, y);
+      }
+    }
+    x0 /= 2;
+    x1 /= 2;
+    y0 /= 2;
+    y1 /= 2;
+  }
+
+  // Modified heights, the rectangle may lie partly outside of the grid
+  const int ya = std::max(j, 0), yb = std::min(j + l, length);
+  if (ya >= yb)
+    return;
+  for (int x = std::max(i, 0); x < std::min(i + w, width); x++)
+  {
+    a = std::min(a, *std::min_element(hf[x] + ya, hf[x] + yb));
+  }
+}
+
+/*!
+\brief Compute the maximum height of a cell, from the heights or from the cells of the previous level.
+\param k Level.
+\param x, y Cell.
+*/
+void HeightFieldTracer::Reduce(int k, int x, int y)
+{
+  float h;
+  if (k == 0)
+  {
+    h = std::max(std::max(hf[x][y], hf[x][y + 1]), std::max(hf[x + 1][y], hf[x + 1][y + 1]));
+  }
+  else
+  {
+    const std::vector<float>& children = levels[k - 1];
+    h = -std::numeric_limits<float>::max();
+    for (int cx = 2 * x; cx <= std::min(2 * x + 1, rows[k - 1] - 1); cx++)
+    {
+      for (int cy = 2 * y; cy <= std::min(2 * y + 1, columns[k - 1] - 1); cy++)
+      {
+        h = std::max(h, children[size_t(cx) * columns[k - 1] + cy]);
+      }
+    }
+  }
+  levels[k][size_t(x) * columns[k] + y] = h;
+}
+
+/*!
+\brief Intersect a ray with the two triangles of a square, in the frame of the grid.
+\param x, y Square.
+\param o, d Origin and direction of the ray.
+\param t0, t1 Interval of the ray.
+\param t Returned intersection depth.
+*/
+bool HeightFieldTracer::Cell(int x, int y, const Vector& o, const Vector& d, double t0, double t1, double& t) const
+{
+  // Same diagonal as HeightField::generateSmoothMesh()
+  const Vector p00(x, y, hf[x][y]), p01(x, y + 1, hf[x][y + 1]), p10(x + 1, y, hf[x + 1][y]), p11(x + 1, y + 1, hf[x + 1][y + 1]);
+  const Triangle triangles[2] = { Triangle(p00, p01, p11), Triangle(p00, p11, p10) };
+
+  const Ray ray(o, d);
+  bool hit = false;
+  t = t1;
+  for (const Triangle& triangle : triangles)
+  {
+    double s, u, v;
+    if (triangle.Intersect(ray, s, u, v) && s >= t0 && s <= t)
+    {
+      t = s;
+      hit = true;
+    }
+  }
+  return hit;
+}
+
+/*!
+\brief Compute the first intersection between a ray and the height field.
+\param ray The ray.
+\param t Returned intersection depth.
+\param tmax Maximal depth.
+*/
+bool HeightFieldTracer::Intersect(const Ray& ray, double& t, double tmax) const
+{
+  if (width < 2 || length < 2)
+    return false;
+
+  // Frame of the grid, where squares have unit size and heights are those of the height field
+  const Vector ro = ray.Origin(), rd = ray.Direction();
+  const Vector o((ro[0] + 0.5 * width * squareSize) / squareSize, length - (ro[1] + 0.5 * length * squareSize) / squareSize, ro[2] / heightMax);
+  const Vector d(rd[0] / squareSize, -rd[1] / squareSize, rd[2] / heightMax);
+
+  // Clip to the bounding box
+  const float b = levels.back()[0];
+  const double lower[3] = { 0.0, 0.0, a }, upper[3] = { double(width - 1), double(length - 1), b };
+  double ta = 0.0, tb = tmax;
+  for (int k = 0; k < 3; k++)
+  {
+    if (d[k] == 0.0)
+    {
+      if (o[k] < lower[k] || o[k] > upper[k])
+        return false;
+      continue;
+    }
+    double u = (lower[k] - o[k]) / d[k], v = (upper[k] - o[k]) / d[k];
+    if (u > v)
+      std::swap(u, v);
+    ta = std::max(ta, u);
+    tb = std::min(tb, v);
+  }
+  if (ta > tb)
+    return false;
+
+  const int top = int(levels.size()) - 1;
+  int k = top;
+  double s = ta;
+  while (s <= tb)
+  {
+    // Cell of the current level containing the current point
+    const int side = 1 << k;
+    const Vector p = o + s * d;
+    const int x = std::min(std::max(int(floor(p[0])) >> k, 0), rows[k] - 1);
+    const int y = std::min(std::max(int(floor(p[1])) >> k, 0), columns[k] - 1);
+
+    // Exit of the cell
+    double exit = tb;
+    const double x0 = x * side, x1 = std::min((x + 1) * side, width - 1);
+    const double y0 = y * side, y1 = std::min((y + 1) * side, length - 1);
+    if (d[0] != 0.0)
+      exit = std::min(exit, ((d[0] > 0.0 ? x1 : x0) - o[0]) / d[0]);
+    if (d[1] != 0.0)
+      exit = std::min(exit, ((d[1] > 0.0 ? y1 : y0) - o[1]) / d[1]);
+    exit = std::max(exit, s);
+
+    // Skip cells below the ray
+    const double z = std::min(o[2] + s * d[2], o[2] + exit * d[2]);
+    if (z > levels[k][size_t(x) * columns[k] + y])
+    {
+      s = exit + 1.0e-9 * std::max(1.0, std::abs(exit));
+      k = std::min(k + 1, top);
+      continue;
+    }
+
+    if (k > 0)
+    {
+      k--;
+      continue;
+    }
+
+    // Hits are searched in the whole interval, so that hits on the border of squares are not missed by rounding
+    if (Cell(x, y, o, d, ta, tb, t))
+      return true;
+    s = exit + 1.0e-9 * std::max(1.0, std::abs(exit));
+  }
+  return false;
+}
+
+/*!
+\brief Intersect a set of rays with the height field, in parallel.
+\param rays The rays.
+\param t Returned intersection depths, negative for rays missing the height field.
+\return The number of intersected rays.
+*/
+int HeightFieldTracer::Intersect(const std::vector<Ray>& rays, std::vector<double>& t) const
+{
+  const int n = int(rays.size());
+  t.resize(n);
+  int hits = 0;
+#pragma omp parallel for schedule(dynamic, 64) reduction(+:hits)
+  for (int i = 0; i < n; i++)
+  {
+    if (Intersect(rays[i], t[i]))
+      hits++;
+    else
+      t[i] = -1.0;
+  }
+  return hits;
+}
+
+/*!
+\brief Check if two points see each other, for line of sight and shadows.
+\param p, q Points.
+*/
+bool HeightFieldTracer::Visible(const Vector& p, const Vector& q) const
+{
+  const double distance = Norm(q - p);
+  if (distance == 0.0)
+    return true;
+  double t;
+  return !Intersect(Ray(p, (q - p) / distance), t, distance);
+}
+
+/*!
+\brief Find the sample of the height field closest to the first intersection with a ray.
+\param ray The ray.
+\param i, j Returned sample.
+*/
+bool HeightFieldTracer::Pick(const Ray& ray, int& i, int& j) const
+{
+  double t;
+  if (!Intersect(ray, t))
+    return false;
+  const Vector p = ray(t);
+  i = std::min(std::max(int(floor((p[0] + 0.5 * width * squareSize) / squareSize + 0.5)), 0), width - 1);
+  j = std::min(std::max(int(floor(length - (p[1] + 0.5 * length * squareSize) / squareSize + 0.5)), 0), length - 1);
+  return true;
+}
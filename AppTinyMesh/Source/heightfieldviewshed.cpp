@@ -0,0 +1,274 @@
+// HeightFieldViewshed
+
+#include "heightfieldviewshed.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/*!
+\class HeightFieldViewshed heightfieldviewshed.h
+\brief Visibility from observers and horizon angles over a height field.
+
+The viewshed of an observer follows the XDraw approximation: the grid is swept by square rings centered on the
+observer, and the largest slope of the lines of sight reaching a sample is interpolated from the two samples of the
+previous ring closest to the line toward the observer. Every ring only depends on the previous one, so that the samples
+of a ring are processed in parallel and vectorized. The four quadrants, along rows and along columns, are swept one after
+the other, with their own rings so that they do not depend on each other.
+
+Horizon angles along one of 8 directions are computed exactly on every line of the grid in that direction, by sweeping
+the line backward while maintaining the upper convex hull of the profile ahead, in parallel over lines.
+
+Results are masks with one value per sample, row after row, which is also the order of the vertices generated by
+HeightField::generateSmoothMesh(), so that they can be used to color meshes.
+
+\code
+HeightFieldViewshed visibility(hf, heightMax, squareSize);
+MeshColor mesh = hf.generateSmoothMesh(heightMax, squareSize, mult);
+HeightFieldViewshed::Tint(mesh, visibility.Viewshed(i, j, 2.0), Color(1.0, 0.0, 0.0));
+\endcode
+*/
+
+const int HeightFieldViewshed::Directions[8][2] = { { 1, 0 }, { 1, 1 }, { 0, 1 }, { -1, 1 }, { -1, 0 }, { -1, -1 }, { 0, -1 }, { 1, -1 } };
+
+/*!
+\brief Create the visibility queries of a height field.
+
+The height field is referenced.
+\param hf The height field.
+\param heightMax Height scale.
+\param squareSize Size of a square of the grid.
+*/
+HeightFieldViewshed::HeightFieldViewshed(const HeightField& hf, double heightMax, double squareSize) :hf(hf), heightMax(heightMax), squareSize(squareSize), width(hf.getWidth()), length(hf.getLength())
+{
+}
+
+/*!
+\brief Compute the samples visible from an observer.
+\param i, j Sample of the observer.
+\param observer Height of the observer above the ground, in world units.
+\param target Height of the targets above the ground, in world units.
+\return The mask of the visible samples, row after row.
+*/
+std::vector<uint8_t> HeightFieldViewshed::Viewshed(int i, int j, double observer, double target) const
+{
+  std::vector<uint8_t> mask(size_t(width) * length, 0);
+  if (i < 0 || i >= width || j < 0 || j >= length)
+    return mask;
+  mask[size_t(i) * length + j] = 1;
+
+  const float zo = float(hf[i][j] * heightMax + observer);
+  const float zt = float(target);
+  const float scale = float(heightMax);
+
+  for (int q = 0; q < 4; q++)
+  {
+    // Primary axis of the rings, along the rows for the first two quadrants
+    const bool rows = q < 2;
+    const int sign = (q % 2 == 0) ? 1 : -1;
+    const int p0 = rows ? i : j, c0 = rows ? j : i;
+    const int np = rows ? width : length, nc = rows ? length : width;
+    const int rings = (sign > 0) ? np - 1 - p0 : p0;
+    if (rings <= 0)
+      continue;
+
+    // Largest slope of the lines of sight reaching the samples of the previous and current rings
+    const int n = std::max(rings, std::max(c0, nc - 1 - c0)) + 1;
+    std::vector<float> previous(2 * size_t(n) + 1, -std::numeric_limits<float>::max());
+    std::vector<float> current(2 * size_t(n) + 1, -std::numeric_limits<float>::max());
+
+#pragma omp parallel
+    {
+      float* s0 = previous.data() + n;
+      float* s1 = current.data() + n;
+      for (int k = 1; k <= rings; k++)
+      {
+        const int p = p0 + sign * k;
+        const int m0 = std::max(-k, -c0), m1 = std::min(k, nc - 1 - c0);
+        const float ratio = float(k - 1) / float(k);
+        const float* row = rows ? hf[p] + c0 : nullptr;
+        uint8_t* visible = rows ? &mask[size_t(p) * length + c0] : nullptr;
+
+        // Quadrants along columns own the samples strictly inside their octants
+#pragma omp for simd schedule(static)
+        for (int m = m0; m <= m1; m++)
+        {
+          const float pos = float(m) * ratio;
+          const int lo = int(std::floor(pos)), hi = std::min(lo + 1, k - 1);
+          const float f = pos - float(lo);
+          const float slope = (1.0f - f) * s0[lo] + f * s0[hi];
+
+          const float h = scale * (rows ? row[m] : hf[c0 + m][p]);
+          const float d = float(squareSize) * std::sqrt(float(k) * float(k) + float(m) * float(m));
+          const float ground = (h - zo) / d;
+          const bool seen = (h + zt - zo) / d >= slope;
+          s1[m] = std::max(slope, ground);
+          if (rows)
+            visible[m] = seen ? 1 : 0;
+          else if (m != -k && m != k)
+            mask[size_t(c0 + m) * length + p] = seen ? 1 : 0;
+        }
+        std::swap(s0, s1);
+      }
+    }
+  }
+  return mask;
+}
+
+/*!
+\brief Compute the horizon angle of every sample in a direction.
+
+The horizon angle is the largest elevation angle of the samples of the grid ahead in the direction, negative
+if all of them are below, and minus half pi for samples on the border facing the direction.
+\param direction Direction, from 0 to 7, rotating from the rows toward the columns by eighth of turns.
+\return The horizon angles, in radians, row after row.
+*/
+std::vector<float> HeightFieldViewshed::Horizon(int direction) const
+{
+  std::vector<float> horizon(size_t(width) * length, float(-0.5 * M_PI));
+  const int di = Directions[direction & 7][0], dj = Directions[direction & 7][1];
+  const double step = squareSize * std::sqrt(double(di * di + dj * dj));
+
+  // Lines start on the samples whose previous sample is outside of the grid
+  std::vector<int> starts;
+  for (int a = 0; a < width; a++)
+  {
+    // Only samples on the border of the grid may start a line
+    const bool border = (a == 0 || a == width - 1);
+    for (int b = 0; b < length; b += (border || b == length - 1) ? 1 : std::max(length - 1 - b, 1))
+    {
+      const int pa = a - di, pb = b - dj;
+      if (pa < 0 || pa >= width || pb < 0 || pb >= length)
+        starts.push_back(a * length + b);
+    }
+  }
+
+  // Lines are processed by blocks of consecutive starts, which are neighbors in memory, so that gathering the heights
+  // of lines across rows reads consecutive heights
+  const int block = 16;
+  const int blocks = (int(starts.size()) + block - 1) / block;
+#pragma omp parallel
+  {
+    std::vector<float> z(size_t(block) * (std::max(width, length) + 1));
+    std::vector<float> angle(z.size());
+    std::vector<int> hull;
+#pragma omp for schedule(dynamic, 1)
+    for (int c = 0; c < blocks; c++)
+    {
+      const int first = c * block, count = std::min(block, int(starts.size()) - first);
+      const int stride = std::max(width, length) + 1;
+      const float d = float(step);
+
+      // Number of samples of the lines
+      int lines[block], longest = 0;
+      for (int l = 0; l < count; l++)
+      {
+        const int a = starts[first + l] / length, b = starts[first + l] % length;
+        const int na = (di > 0) ? width - a : (di < 0) ? a + 1 : width + length;
+        const int nb = (dj > 0) ? length - b : (dj < 0) ? b + 1 : width + length;
+        lines[l] = std::min(na, nb);
+        longest = std::max(longest, lines[l]);
+      }
+
+      // Gather the heights in lockstep
+      for (int t = 0; t < longest; t++)
+      {
+        for (int l = 0; l < count; l++)
+        {
+          if (t < lines[l])
+            z[size_t(l) * stride + t] = float(hf.View()(starts[first + l] / length + t * di, starts[first + l] % length + t * dj) * heightMax);
+        }
+      }
+
+      // Upper convex hull of the profile ahead, swept backward
+      for (int l = 0; l < count; l++)
+      {
+        const float* p = &z[size_t(l) * stride];
+        float* o = &angle[size_t(l) * stride];
+        hull.clear();
+        for (int k = lines[l] - 1; k >= 0; k--)
+        {
+          while (hull.size() >= 2)
+          {
+            const int u = hull[hull.size() - 1], v = hull[hull.size() - 2];
+            if ((p[u] - p[k]) * float(v - k) > (p[v] - p[k]) * float(u - k))
+              break;
+            hull.pop_back();
+          }
+          o[k] = hull.empty() ? -std::numeric_limits<float>::infinity() : (p[hull.back()] - p[k]) / (float(hull.back() - k) * d);
+          hull.push_back(k);
+        }
+      }
+
+      // Angles from the slopes, vectorized
+#pragma omp simd
+      for (size_t k = 0; k < size_t(count) * stride; k++)
+      {
+        angle[k] = std::atan(angle[k]);
+      }
+
+      // Scatter the angles in lockstep
+      for (int t = 0; t < longest; t++)
+      {
+        for (int l = 0; l < count; l++)
+        {
+          if (t < lines[l])
+            horizon[size_t(starts[first + l] / length + t * di) * length + starts[first + l] % length + t * dj] = angle[size_t(l) * stride + t];
+        }
+      }
+    }
+  }
+  return horizon;
+}
+
+/*!
+\brief Compute the fraction of the sky visible from every sample, from the horizons in 8 directions.
+\return The sky view factors, between 0 and 1, row after row.
+*/
+std::vector<float> HeightFieldViewshed::SkyView() const
+{
+  std::vector<float> sky(size_t(width) * length, 0.0f);
+  for (int d = 0; d < 8; d++)
+  {
+    const std::vector<float> horizon = Horizon(d);
+#pragma omp parallel for simd
+    for (long long k = 0; k < (long long)(sky.size()); k++)
+    {
+      sky[k] += 0.125f * (1.0f - std::sin(std::max(horizon[k], 0.0f)));
+    }
+  }
+  return sky;
+}
+
+/*!
+\brief Tint the vertices of a mesh generated by HeightField::generateSmoothMesh() with a mask.
+\param mesh The mesh.
+\param mask The mask, with one value per vertex.
+\param color Color of the masked vertices.
+\param strength Strength of the tint, between 0 and 1.
+*/
+void HeightFieldViewshed::Tint(MeshColor& mesh, const std::vector<uint8_t>& mask, const Color& color, double strength)
+{
+  const int n = std::min(int(mask.size()), mesh.Vertexes());
+#pragma omp parallel for schedule(static)
+  for (int k = 0; k < n; k++)
+  {
+    if (mask[k] != 0)
+      mesh.SetColor(k, Color::Lerp(strength, mesh.GetColor(k), color));
+  }
+}
+
+/*!
+\brief Darken the vertices of a mesh generated by HeightField::generateSmoothMesh(), typically with the sky view factors.
+\param mesh The mesh.
+\param factors The factors, with one value between 0 and 1 per vertex.
+*/
+void HeightFieldViewshed::Shade(MeshColor& mesh, const std::vector<float>& factors)
+{
+  const int n = std::min(int(factors.size()), mesh.Vertexes());
+#pragma omp parallel for schedule(static)
+  for (int k = 0; k < n; k++)
+  {
+    mesh.SetColor(k, mesh.GetColor(k) * double(factors[k]));
+  }
+}
@@ -21,6 +21,9 @@ double AnalyticScalarField::Value(const Vector& p) const
 /*!
 \brief Compute the polygonal mesh approximating the implicit surface.
 
+The field is evaluated in parallel, layer by layer, and so are the vertices on the straddling edges:
+Value() should be thread safe.
+
 \param box %Box defining the region that will be polygonized.
 \param n Discretization parameter.
 \param g Returned geometry.
@@ -37,6 +40,28 @@ void AnalyticScalarField::Polygonize(int n, Mesh& g, const Box& box, const doubl
   normal.reserve(20000);
   triangle.reserve(20000);
 
+  // Straddling edges, whose vertices are computed in parallel
+  struct Straddling
+  {
+    Vector a, b;
+    double va, vb, length;
+  };
+  std::vector<Straddling> straddling;
+  auto solve = [&]()
+    {
+      const int first = int(vertex.size());
+      vertex.resize(first + straddling.size());
+      normal.resize(first + straddling.size());
+#pragma omp parallel for schedule(dynamic, 16)
+      for (int i = 0; i < int(straddling.size()); i++)
+      {
+        const Straddling& e = straddling[i];
+        vertex[first + i] = Dichotomy(e.a, e.b, e.va, e.vb, e.length, epsilon);
+        normal[first + i] = Normal(vertex[first + i]);
+      }
+      straddling.clear();
+    };
+
   int nv = 0;
   const int nx = n;
   const int ny = n;
@@ -75,6 +100,7 @@ void AnalyticScalarField::Polygonize(int n, Mesh& g, const Box& box, const doubl
   double za = 0.0;
 
   // Compute field inside lower Oxy plane
+#pragma omp parallel for schedule(dynamic, 1)
   for (int i = nax; i < nbx; i++)
   {
     for (int j = nay; j < nby; j++)
@@ -92,8 +118,7 @@ void AnalyticScalarField::Polygonize(int n, Mesh& g, const Box& box, const doubl
       // We need a xor b, which can be implemented a == !b 
       if (!((a[i * ny + j] < 0.0) == !(a[(i + 1) * ny + j] >= 0.0)))
       {
-        vertex.push_back(Dichotomy(u[i * ny + j], u[(i + 1) * ny + j], a[i * ny + j], a[(i + 1) * ny + j], d[0], epsilon));
-        normal.push_back(Normal(vertex.back()));
+        straddling.push_back(Straddling{ u[i * ny + j], u[(i + 1) * ny + j], a[i * ny + j], a[(i + 1) * ny + j], d[0] });
         eax[i * ny + j] = nv;
         nv++;
       }
@@ -105,14 +130,15 @@ void AnalyticScalarField::Polygonize(int n, Mesh& g, const Box& box, const doubl
     {
       if (!((a[i * ny + j] < 0.0) == !(a[i * ny + (j + 1)] >= 0.0)))
       {
-        vertex.push_back(Dichotomy(u[i * ny + j], u[i * ny + (j + 1)], a[i * ny + j], a[i * ny + (j + 1)], d[1], epsilon));
-        normal.push_back(Normal(vertex.back()));
+        straddling.push_back(Straddling{ u[i * ny + j], u[i * ny + (j + 1)], a[i * ny + j], a[i * ny + (j + 1)], d[1] });
         eay[i * ny + j] = nv;
         nv++;
       }
     }
   }
 
+  solve();
+
   // Array for edge vertices
   int e[12];
 
@@ -120,6 +146,7 @@ void AnalyticScalarField::Polygonize(int n, Mesh& g, const Box& box, const doubl
   for (int k = naz; k < nbz; k++)
   {
     double zb = za + d[2];
+#pragma omp parallel for schedule(dynamic, 1)
     for (int i = nax; i < nbx; i++)
     {
       for (int j = nay; j < nby; j++)
@@ -137,8 +164,7 @@ void AnalyticScalarField::Polygonize(int n, Mesh& g, const Box& box, const doubl
         //   if (((b[i*ny + j] < 0.0) && (b[(i + 1)*ny + j] >= 0.0)) || ((b[i*ny + j] >= 0.0) && (b[(i + 1)*ny + j] < 0.0)))
         if (!((b[i * ny + j] < 0.0) == !(b[(i + 1) * ny + j] >= 0.0)))
         {
-          vertex.push_back(Dichotomy(v[i * ny + j], v[(i + 1) * ny + j], b[i * ny + j], b[(i + 1) * ny + j], d[0], epsilon));
-          normal.push_back(Normal(vertex.back()));
+          straddling.push_back(Straddling{ v[i * ny + j], v[(i + 1) * ny + j], b[i * ny + j], b[(i + 1) * ny + j], d[0] });
           ebx[i * ny + j] = nv;
           nv++;
         }
@@ -152,8 +178,7 @@ void AnalyticScalarField::Polygonize(int n, Mesh& g, const Box& box, const doubl
         // if (((b[i*ny + j] < 0.0) && (b[i*ny + (j + 1)] >= 0.0)) || ((b[i*ny + j] >= 0.0) && (b[i*ny + (j + 1)] < 0.0)))
         if (!((b[i * ny + j] < 0.0) == !(b[i * ny + (j + 1)] >= 0.0)))
         {
-          vertex.push_back(Dichotomy(v[i * ny + j], v[i * ny + (j + 1)], b[i * ny + j], b[i * ny + (j + 1)], d[1], epsilon));
-          normal.push_back(Normal(vertex.back()));
+          straddling.push_back(Straddling{ v[i * ny + j], v[i * ny + (j + 1)], b[i * ny + j], b[i * ny + (j + 1)], d[1] });
           eby[i * ny + j] = nv;
           nv++;
         }
@@ -168,14 +193,15 @@ void AnalyticScalarField::Polygonize(int n, Mesh& g, const Box& box, const doubl
         // if ((a[i*ny + j] < 0.0) && (b[i*ny + j] >= 0.0) || (a[i*ny + j] >= 0.0) && (b[i*ny + j] < 0.0))
         if (!((a[i * ny + j] < 0.0) == !(b[i * ny + j] >= 0.0)))
         {
-          vertex.push_back(Dichotomy(u[i * ny + j], v[i * ny + j], a[i * ny + j], b[i * ny + j], d[2], epsilon));
-          normal.push_back(Normal(vertex.back()));
+          straddling.push_back(Straddling{ u[i * ny + j], v[i * ny + j], a[i * ny + j], b[i * ny + j], d[2] });
           ez[i * ny + j] = nv;
           nv++;
         }
       }
     }
 
+    solve();
+
     // Create mesh
     for (int i = nax; i < nbx - 1; i++)
     {
@@ -276,6 +302,60 @@ Vector AnalyticScalarField::Dichotomy(Vector a, Vector b, double va, double vb,
   return c;
 }
 
+/*!
+\brief Return the Lipschitz constant of the field.
+
+The field never varies faster than this bound, so |f(p)|/K is a conservative distance to the surface.
+The default field is the signed distance to the unit sphere, derived classes should override this function.
+*/
+double AnalyticScalarField::K() const
+{
+  return 1.0;
+}
+
+/*!
+\brief Compute the first intersection between a ray and the implicit surface by sphere tracing.
+
+Steps are derived from the Lipschitz constant, the intersection is refined by dichotomy.
+\param ray The ray.
+\param a,b Interval of depth along the ray, typically clipped to the bounding box of the surface.
+\param t Returned intersection depth.
+\param epsilon Precision.
+\sa AnalyticScalarField::K()
+*/
+bool AnalyticScalarField::SphereTrace(const Ray& ray, double a, double b, double& t, const double& epsilon) const
+{
+  const double k = K();
+  double ta = a;
+  double va = Value(ray(a));
+
+  // Starting inside
+  if (va < 0.0)
+  {
+    t = a;
+    return true;
+  }
+
+  t = a;
+  while (t < b)
+  {
+    double v = Value(ray(t));
+    if (v < 0.0)
+    {
+      // Refine between the previous point outside and the current one
+      Vector p = Dichotomy(ray(ta), ray(t), va, v, t - ta, epsilon);
+      t = (p - ray.Origin()) * ray.Direction();
+      return true;
+    }
+    if (v < epsilon)
+      return true;
+    ta = t;
+    va = v;
+    t += Math::Max(v / k, epsilon);
+  }
+  return false;
+}
+
 
 /*!
 \brief Compute the gradient of the field.
@@ -0,0 +1,324 @@
+// KdTree
+
+#include "kdtree.h"
+
+#include <algorithm>
+#include <limits>
+
+/*!
+\class KdTree kdtree.h
+\brief A static kd-tree for nearest neighbor and radius queries on points.
+
+The tree is balanced: nodes are split at the median along the largest extent of their points,
+and the top levels are built in parallel with OpenMP tasks. Points are stored in leaf order as
+structure of arrays in single precision, so that leaves are scanned by vectorized loops.
+Queries return the indexes of the points in the array given at construction.
+
+\code
+KdTree tree(points);
+std::vector<int> neighbors;
+std::vector<double> d;
+tree.KNearest(p, 8, neighbors, d);
+\endcode
+
+Batch queries process the query points in parallel.
+*/
+
+/*!
+\brief Build the tree of a set of points.
+\param points Array of points.
+*/
+KdTree::KdTree(const std::vector<Vector>& points)
+{
+  const int n = int(points.size());
+  id.resize(n);
+  for (int i = 0; i < n; i++)
+  {
+    id[i] = i;
+  }
+  if (n == 0)
+    return;
+
+  // Median splits create leaves with at least Leaf/2 points, hence at most 2n/Leaf leaves
+  nodes.resize(4 * (n / Leaf + 1));
+  std::atomic<int> next(1);
+
+#pragma omp parallel
+#pragma omp single
+  Build(0, 0, n, points, next);
+
+  nodes.resize(next);
+
+  for (int k = 0; k < 3; k++)
+  {
+    p[k].resize(n);
+  }
+  for (int i = 0; i < n; i++)
+  {
+    for (int k = 0; k < 3; k++)
+    {
+      p[k][i] = float(points[id[i]][k]);
+    }
+  }
+}
+
+/*!
+\brief Recursively build a node of the tree.
+\param n Index of the node.
+\param first, last Range of points, last excluded.
+\param points Array of points.
+\param next Index of the next free node.
+*/
+void KdTree::Build(int n, int first, int last, const std::vector<Vector>& points, std::atomic<int>& next)
+{
+  Node& node = nodes[n];
+
+  if (last - first <= Leaf)
+  {
+    node.axis = -1;
+    node.index = first;
+    node.count = last - first;
+    return;
+  }
+
+  // Largest extent
+  Vector a = points[id[first]];
+  Vector b = a;
+  for (int i = first + 1; i < last; i++)
+  {
+    a = Vector::Min(a, points[id[i]]);
+    b = Vector::Max(b, points[id[i]]);
+  }
+  const Vector d = b - a;
+  const int axis = (d[0] > d[1]) ? ((d[0] > d[2]) ? 0 : 2) : ((d[1] > d[2]) ? 1 : 2);
+
+  // Median
+  const int mid = (first + last) / 2;
+  std::nth_element(id.begin() + first, id.begin() + mid, id.begin() + last, [&](int i, int j)
+    {
+      return points[i][axis] < points[j][axis];
+    });
+
+  const int child = next.fetch_add(2);
+  node.axis = axis;
+  node.split = float(points[id[mid]][axis]);
+  node.index = child;
+  node.count = 0;
+
+  if (last - first > 16384)
+  {
+#pragma omp task shared(points, next)
+    Build(child, first, mid, points, next);
+#pragma omp task shared(points, next)
+    Build(child + 1, mid, last, points, next);
+#pragma omp taskwait
+  }
+  else
+  {
+    Build(child, first, mid, points, next);
+    Build(child + 1, mid, last, points, next);
+  }
+}
+
+/*!
+\brief Compute the squared distances between a point and the points of a leaf.
+\param node The leaf.
+\param q Point.
+\param d Returned squared distances.
+*/
+void KdTree::Scan(const Node& node, const Vector& q, float* d) const
+{
+  const float qx = float(q[0]), qy = float(q[1]), qz = float(q[2]);
+  const float* x = p[0].data() + node.index;
+  const float* y = p[1].data() + node.index;
+  const float* z = p[2].data() + node.index;
+
+#pragma omp simd
+  for (int i = 0; i < node.count; i++)
+  {
+    const float dx = x[i] - qx, dy = y[i] - qy, dz = z[i] - qz;
+    d[i] = dx * dx + dy * dy + dz * dz;
+  }
+}
+
+/*!
+\brief Find the nearest point.
+\param q Query point.
+\param d Returned distance.
+\return Index of the nearest point, -1 if the tree is empty.
+*/
+int KdTree::Nearest(const Vector& q, double& d) const
+{
+  std::vector<int> i;
+  std::vector<double> e;
+  if (KNearest(q, 1, i, e) == 0)
+    return -1;
+  d = sqrt(e[0]);
+  return i[0];
+}
+
+/*!
+\brief Find the k nearest points.
+\param q Query point.
+\param k Number of neighbors.
+\param neighbors Returned indexes, sorted by increasing distance.
+\param d Returned squared distances.
+\return Number of neighbors, k unless the tree has fewer points.
+*/
+int KdTree::KNearest(const Vector& q, int k, std::vector<int>& neighbors, std::vector<double>& d) const
+{
+  neighbors.clear();
+  d.clear();
+  if (nodes.empty() || k <= 0)
+    return 0;
+
+  // Max heap of the best candidates
+  std::vector<std::pair<float, int>> heap;
+  heap.reserve(k + 1);
+  float bound = std::numeric_limits<float>::max();
+
+  float e[Leaf];
+  std::pair<int, float> stack[64];
+  int size = 0;
+  stack[size++] = std::make_pair(0, 0.0f);
+  while (size > 0)
+  {
+    const std::pair<int, float> top = stack[--size];
+    if (top.second > bound)
+      continue;
+
+    const Node& node = nodes[top.first];
+    if (node.axis < 0)
+    {
+      Scan(node, q, e);
+      for (int i = 0; i < node.count; i++)
+      {
+        if (e[i] < bound || int(heap.size()) < k)
+        {
+          heap.push_back(std::make_pair(e[i], node.index + i));
+          std::push_heap(heap.begin(), heap.end());
+          if (int(heap.size()) > k)
+          {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.pop_back();
+          }
+          if (int(heap.size()) == k)
+          {
+            bound = heap.front().first;
+          }
+        }
+      }
+    }
+    else
+    {
+      // Visit the side of the query first, the far side only if the plane is closer than the bound
+      const float t = float(q[node.axis]) - node.split;
+      const int nearest = (t < 0.0f) ? 0 : 1;
+      stack[size++] = std::make_pair(node.index + 1 - nearest, t * t);
+      stack[size++] = std::make_pair(node.index + nearest, top.second);
+    }
+  }
+
+  std::sort_heap(heap.begin(), heap.end());
+  for (int i = 0; i < int(heap.size()); i++)
+  {
+    neighbors.push_back(id[heap[i].second]);
+    d.push_back(heap[i].first);
+  }
+  return int(heap.size());
+}
+
+/*!
+\brief Find the points inside a sphere.
+\param c Center.
+\param r Radius.
+\param neighbors Returned indexes, in no particular order.
+\return Number of points.
+*/
+int KdTree::Radius(const Vector& c, double r, std::vector<int>& neighbors) const
+{
+  neighbors.clear();
+  if (nodes.empty())
+    return 0;
+
+  const float bound = float(r * r);
+
+  float e[Leaf];
+  std::pair<int, float> stack[64];
+  int size = 0;
+  stack[size++] = std::make_pair(0, 0.0f);
+  while (size > 0)
+  {
+    const std::pair<int, float> top = stack[--size];
+    if (top.second > bound)
+      continue;
+
+    const Node& node = nodes[top.first];
+    if (node.axis < 0)
+    {
+      Scan(node, c, e);
+      for (int i = 0; i < node.count; i++)
+      {
+        if (e[i] <= bound)
+        {
+          neighbors.push_back(id[node.index + i]);
+        }
+      }
+    }
+    else
+    {
+      const float t = float(c[node.axis]) - node.split;
+      const int nearest = (t < 0.0f) ? 0 : 1;
+      stack[size++] = std::make_pair(node.index + 1 - nearest, t * t);
+      stack[size++] = std::make_pair(node.index + nearest, top.second);
+    }
+  }
+  return int(neighbors.size());
+}
+
+/*!
+\brief Find the k nearest points of a set of query points, in parallel.
+
+Results are stored with a stride of k, missing neighbors have index -1.
+\param q Query points.
+\param k Number of neighbors.
+\param neighbors Returned indexes.
+\param d Returned squared distances.
+*/
+void KdTree::KNearest(const std::vector<Vector>& q, int k, std::vector<int>& neighbors, std::vector<double>& d) const
+{
+  const int n = int(q.size());
+  neighbors.assign(size_t(n) * k, -1);
+  d.assign(size_t(n) * k, std::numeric_limits<double>::max());
+
+#pragma omp parallel
+  {
+    std::vector<int> ni;
+    std::vector<double> nd;
+#pragma omp for schedule(dynamic, 64)
+    for (int i = 0; i < n; i++)
+    {
+      int m = KNearest(q[i], k, ni, nd);
+      std::copy(ni.begin(), ni.begin() + m, neighbors.begin() + size_t(i) * k);
+      std::copy(nd.begin(), nd.begin() + m, d.begin() + size_t(i) * k);
+    }
+  }
+}
+
+/*!
+\brief Find the points inside spheres of the same radius centered at a set of query points, in parallel.
+\param c Centers.
+\param r Radius.
+*/
+std::vector<std::vector<int>> KdTree::Radius(const std::vector<Vector>& c, double r) const
+{
+  const int n = int(c.size());
+  std::vector<std::vector<int>> neighbors(n);
+
+#pragma omp parallel for schedule(dynamic, 64)
+  for (int i = 0; i < n; i++)
+  {
+    Radius(c[i], r, neighbors[i]);
+  }
+  return neighbors;
+}
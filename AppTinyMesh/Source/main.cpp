@@ -1,8 +1,97 @@
 #include "qte.h"
+#include "pathtracer.h"
+#include "spheretracer.h"
+#include "meshanalysis.h"
 #include <QtWidgets/qapplication.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+// Offline rendering without graphics hardware: AppTinyMesh --render mesh.obj image.png [samples] [width] [height]
+static int Render(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+
+	const int spp = (argc > 4) ? atoi(argv[4]) : 64;
+	const int w = (argc > 5) ? atoi(argv[5]) : 1280;
+	const int h = (argc > 6) ? atoi(argv[6]) : 720;
+
+	Mesh mesh;
+	mesh.Load(QString(argv[2]));
+
+	// Frame the object
+	Box box = mesh.GetBox();
+	Vector c = box.Center();
+	double r = box.Radius();
+
+	PathTracer renderer(w, h);
+	renderer.Add(mesh);
+	renderer.SetCamera(Camera(c + Normalized(Vector(1.0, -1.5, 0.8)) * 2.5 * r, c, Vector::Z, 1.0, 1.0, 1.0, 1000.0 * r));
+
+	// Progressive passes
+	for (int i = 0; i < spp; i += 8)
+	{
+		renderer.Render(std::min(8, spp - i));
+		std::cout << renderer.Samples() << "/" << spp << " samples" << std::endl;
+	}
+
+	std::cout << renderer.Rays() << " rays, " << renderer.RaysPerSecond() << " rays/s, " << renderer.RaysPerSecondPerCore() << " rays/s/core on " << PathTracer::Threads() << " threads" << std::endl;
+
+	return renderer.Save(QString(argv[3])) ? 0 : 1;
+}
+
+// Preview of the implicit surface without polygonization: AppTinyMesh --field image.png [width] [height]
+static int RenderField(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+
+	const int w = (argc > 3) ? atoi(argv[3]) : 1920;
+	const int h = (argc > 4) ? atoi(argv[4]) : 1080;
+
+	AnalyticScalarField implicit;
+	SphereTracer renderer(implicit, Box(2.0));
+	QImage image = renderer.Render(Camera(Vector(-4.0, 3.0, 2.5), Vector::Null, Vector::Z, 1.0, 1.0, 1.0, 1000.0), w, h);
+
+	std::cout << renderer.Rays() << " rays in " << renderer.Seconds() << " s" << std::endl;
+
+	return image.save(QString(argv[2])) ? 0 : 1;
+}
+
+// Quality and validity report in JSON format: AppTinyMesh --analyze mesh.obj [report.json]
+static int Analyze(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+
+	Mesh mesh;
+	mesh.Load(QString(argv[2]));
+
+	const std::string report = MeshAnalysis(mesh).Json();
+	if (argc > 3)
+	{
+		std::ofstream file(argv[3]);
+		file << report << std::endl;
+		return file ? 0 : 1;
+	}
+
+	std::cout << report << std::endl;
+	return 0;
+}
 
 int main(int argc, char *argv[])
 {
+	if (argc > 3 && QString(argv[1]) == "--render")
+	{
+		return Render(argc, argv);
+	}
+	if (argc > 2 && QString(argv[1]) == "--field")
+	{
+		return RenderField(argc, argv);
+	}
+	if (argc > 2 && QString(argv[1]) == "--analyze")
+	{
+		return Analyze(argc, argv);
+	}
+
 	QApplication app(argc, argv);
 
 	MainWindow mainWin;
@@ -11,6 +11,8 @@
 #include <QtGui/QPainter>
 
 #include <fstream>
+#include <cstddef>
+#include <cstdint>
 
 /*!
 \brief Default constructor.
@@ -25,10 +27,139 @@ MeshWidget::MeshGL::MeshGL()
     vao = 0;
     fullBuffer = 0;
     indexBuffer = 0;
+    indexType = GL_UNSIGNED_INT;
     triangleCount = 0;
+    pointCount = 0;
+    bytes = 0;
+    deindexedBytes = 0;
     SetFrame(Vector::Null);
 }
 
+/*!
+\brief Vertex of the compact layout of meshes, 20 bytes.
+*/
+struct PackedVertex
+{
+    float position[3];			//!< Position.
+    int16_t normal[2];			//!< Normal, octahedral encoding in normalized shorts.
+    uint8_t color[4];			//!< Color, in bytes.
+};
+
+/*!
+\brief Encode a normal on the octahedron, unfolded on the square [-1, 1]^2.
+\param n the normal
+\param e returned encoding, in normalized shorts
+*/
+static inline void OctahedralEncode(const Vector& n, int16_t e[2])
+{
+    const double l = fabs(n[0]) + fabs(n[1]) + fabs(n[2]);
+    double u = (l > 0.0) ? n[0] / l : 0.0;
+    double v = (l > 0.0) ? n[1] / l : 0.0;
+
+    // Fold the lower half over the diagonals
+    if (n[2] < 0.0)
+    {
+        const double a = (1.0 - fabs(v)) * (u >= 0.0 ? 1.0 : -1.0);
+        v = (1.0 - fabs(u)) * (v >= 0.0 ? 1.0 : -1.0);
+        u = a;
+    }
+    e[0] = int16_t(std::lround(Math::Clamp(u, -1.0, 1.0) * 32767.0));
+    e[1] = int16_t(std::lround(Math::Clamp(v, -1.0, 1.0) * 32767.0));
+}
+
+/*!
+\brief Pack the vertex of a triangle corner.
+\param mesh the mesh
+\param colors the mesh with colors, or nullptr for white
+\param corner the corner, three per triangle
+\param p returned vertex
+*/
+static void Pack(const Mesh& mesh, const MeshColor* colors, int corner, PackedVertex& p)
+{
+    const int t = corner / 3, k = corner % 3;
+
+    const Vector vertex = mesh.Vertex(mesh.VertexIndex(t, k));
+    p.position[0] = float(vertex[0]);
+    p.position[1] = float(vertex[1]);
+    p.position[2] = float(vertex[2]);
+
+    OctahedralEncode(mesh.Normal(mesh.NormalIndex(t, k)), p.normal);
+
+    const Color color = (colors != nullptr) ? colors->GetColor(colors->ColorIndex(t, k)) : Color(1.0);
+    for (int j = 0; j < 3; j++)
+        p.color[j] = uint8_t(std::lround(Math::Clamp(color[j]) * 255.0));
+    p.color[3] = 255;
+}
+
+/*!
+\brief Hash an index tuple.
+\param v, n, c vertex, normal and color indexes
+*/
+static inline size_t HashTuple(int v, int n, int c)
+{
+    const uint64_t h = uint64_t(uint32_t(v)) * 0x9E3779B97F4A7C15ull ^ uint64_t(uint32_t(n)) * 0xC2B2AE3D27D4EB4Full ^ uint64_t(uint32_t(c)) * 0x165667B19E3779F9ull;
+    return size_t(h ^ (h >> 32));
+}
+
+/*!
+\brief Merge the triangle corners with the same vertex, normal and color indexes.
+
+Index tuples are hashed in an open addressing table, grown when half full, and vertices are numbered in the order
+of their first corner.
+\param va, na, ca vertex, normal and color indexes of the corners, color indexes may be empty
+\param hint expected number of vertices
+\param corners returned vertex of every corner
+\param sources returned first corner of every vertex
+*/
+static void Deduplicate(const std::vector<int>& va, const std::vector<int>& na, const std::vector<int>& ca, int hint, std::vector<int>& corners, std::vector<int>& sources)
+{
+    const size_t n = va.size();
+    size_t capacity = 16;
+    while (capacity < 2 * size_t(hint))
+        capacity *= 2;
+    std::vector<int> table(capacity, -1);
+
+    corners.resize(n);
+    sources.clear();
+    for (size_t i = 0; i < n; i++)
+    {
+        const int c = ca.empty() ? 0 : ca[i];
+        size_t s = HashTuple(va[i], na[i], c) & (capacity - 1);
+        while (true)
+        {
+            const int v = table[s];
+            if (v < 0)
+            {
+                table[s] = corners[i] = int(sources.size());
+                sources.push_back(int(i));
+                break;
+            }
+            const int k = sources[v];
+            if (va[k] == va[i] && na[k] == na[i] && (ca.empty() || ca[k] == c))
+            {
+                corners[i] = v;
+                break;
+            }
+            s = (s + 1) & (capacity - 1);
+        }
+
+        // Grow the table and insert the vertices again
+        if (2 * sources.size() > capacity)
+        {
+            capacity *= 2;
+            table.assign(capacity, -1);
+            for (int v = 0; v < int(sources.size()); v++)
+            {
+                const int k = sources[v];
+                s = HashTuple(va[k], na[k], ca.empty() ? 0 : ca[k]) & (capacity - 1);
+                while (table[s] >= 0)
+                    s = (s + 1) & (capacity - 1);
+                table[s] = v;
+            }
+        }
+    }
+}
+
 /*!
 \brief Constructor from a Mesh and a frame scaled.
 */
@@ -36,36 +167,43 @@ MeshWidget::MeshGL::MeshGL(const Mesh& mesh, const Vector& position) : MeshGL()
 {
     SetFrame(position);
     bbox = mesh.GetBox();
+    Upload(mesh, nullptr);
+}
 
-    // Compute plain arrays of sorted vertices & normals
-    std::vector<int> vertexIndexes = mesh.VertexIndexes();
-    std::vector<int> normalIndexes = mesh.NormalIndexes();
-    assert(vertexIndexes.size() == normalIndexes.size());
+/*!
+\brief Constructor from a MeshColor and a frame scaled.
+*/
+MeshWidget::MeshGL::MeshGL(const MeshColor& mesh, const Vector& fr) : MeshGL()
+{
+    SetFrame(fr);
+    bbox = mesh.GetBox();
+    Upload(mesh, &mesh);
+}
 
-    int nbVertex = int(vertexIndexes.size());
-    int singleBufferSize = nbVertex * 3;
-    float* vertices = new float[singleBufferSize];
-    float* normals = new float[singleBufferSize];
-    for (int i = 0; i < nbVertex; i++)
-    {
-        int indexVertex = vertexIndexes[i];
-        int indexNormal = normalIndexes[i];
+/*!
+\brief Upload a mesh with shared vertices, in a compact interleaved layout.
 
-        Vector vertex = mesh.Vertex(indexVertex);
-        vertices[i * 3 + 0] = float(vertex[0]);
-        vertices[i * 3 + 1] = float(vertex[1]);
-        vertices[i * 3 + 2] = float(vertex[2]);
+Corners with the same vertex, normal and color indexes share a single vertex, which stores the position in floats,
+the normal with an octahedral encoding in two normalized shorts, and the color in bytes: 20 bytes instead of the
+36 bytes of separate float arrays. Indexes are 16 bits when there are few enough vertices.
+\param mesh the mesh
+\param colors the mesh with colors, or nullptr for white
+*/
+void MeshWidget::MeshGL::Upload(const Mesh& mesh, const MeshColor* colors)
+{
+    const std::vector<int> vertexIndexes = mesh.VertexIndexes();
+    const std::vector<int> normalIndexes = mesh.NormalIndexes();
+    const std::vector<int> colorIndexes = (colors != nullptr) ? colors->ColorIndexes() : std::vector<int>();
+    assert(vertexIndexes.size() == normalIndexes.size());
+    std::vector<int> corners, sources;
+    Deduplicate(vertexIndexes, normalIndexes, colorIndexes, std::max(mesh.Vertexes(), mesh.Normals()), corners, sources);
+    triangleCount = int(corners.size());
 
-        Vector normal = mesh.Normal(indexNormal);
-        normals[i * 3 + 0] = float(normal[0]);
-        normals[i * 3 + 1] = float(normal[1]);
-        normals[i * 3 + 2] = float(normal[2]);
-    }
-    // Indices are now sorted
-    int* indices = new int[nbVertex];
+    const int nbVertex = int(sources.size());
+    std::vector<PackedVertex> vertices(nbVertex);
+#pragma omp parallel for
     for (int i = 0; i < nbVertex; i++)
-        indices[i] = i;
-    triangleCount = nbVertex;
+        Pack(mesh, colors, sources[i], vertices[i]);
 
     // Generate vao & buffers
     if (vao == 0)
@@ -75,133 +213,238 @@ MeshWidget::MeshGL::MeshGL(const Mesh& mesh, const Vector& position) : MeshGL()
     if (indexBuffer == 0)
         glGenBuffers(1, &indexBuffer);
 
-
     glBindVertexArray(vao);
-    size_t fullSize = sizeof(float) * singleBufferSize
-            + sizeof(float) * singleBufferSize;
     glBindBuffer(GL_ARRAY_BUFFER, fullBuffer);
-    glBufferData(GL_ARRAY_BUFFER, fullSize, nullptr, GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(PackedVertex) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
 
-    // Vertices(0)
-    size_t size = 0;
-    size_t offset = 0;
-    size = sizeof(float) * singleBufferSize;
-    glBufferSubData(GL_ARRAY_BUFFER, offset, size, vertices);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (const void*)offset);
+    // Vertices(0), Normals(1), Colors(2)
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (const void*)offsetof(PackedVertex, position));
     glEnableVertexAttribArray(0);
-
-    // Normals(1)
-    offset = offset + size;
-    size = sizeof(float) * singleBufferSize;
-    glBufferSubData(GL_ARRAY_BUFFER, offset, size, normals);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (const void*)offset);
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (const void*)offsetof(PackedVertex, normal));
     glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedVertex), (const void*)offsetof(PackedVertex, color));
+    glEnableVertexAttribArray(2);
 
     // Triangles
-    glGenBuffers(1, &indexBuffer);
+    size_t indexSize = 0;
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(int) * nbVertex, indices, GL_STATIC_DRAW);
+    if (nbVertex <= 65536)
+    {
+        indexType = GL_UNSIGNED_SHORT;
+        const std::vector<uint16_t> indices(corners.begin(), corners.end());
+        indexSize = sizeof(uint16_t) * indices.size();
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize, indices.data(), GL_STATIC_DRAW);
+    }
+    else
+    {
+        indexType = GL_UNSIGNED_INT;
+        indexSize = sizeof(int) * corners.size();
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize, corners.data(), GL_STATIC_DRAW);
+    }
 
-    // Free data
-    delete[] vertices;
-    delete[] normals;
-    delete[] indices;
+    // Float positions and normals, and colors if any, for every corner, with 32 bit indexes
+    bytes = sizeof(PackedVertex) * vertices.size() + indexSize;
+    deindexedBytes = corners.size() * (sizeof(float) * 3 * ((colors != nullptr) ? 3 : 2) + sizeof(int));
 }
 
 /*!
-\brief Constructor from a MeshColor and a frame scaled.
+\brief Constructor from a PointCloud and a frame scaled.
+
+Points are drawn as is, without triangles nor index buffer. Points without normals are drawn with a constant color.
 */
-MeshWidget::MeshGL::MeshGL(const MeshColor& mesh, const Vector& fr) : MeshGL()
+MeshWidget::MeshGL::MeshGL(const PointCloud& cloud, const Vector& fr) : MeshGL()
 {
     SetFrame(fr);
-    bbox = mesh.GetBox();
-
-    // Compute plain arrays of sorted vertices & normals
-    std::vector<int> vertexIndexes = mesh.VertexIndexes();
-    std::vector<int> normalIndexes = mesh.NormalIndexes();
-    std::vector<int> colorIndexes = mesh.ColorIndexes();
-    assert(vertexIndexes.size() == normalIndexes.size());
-
-    int nbVertex = int(vertexIndexes.size());
-    int singleBufferSize = nbVertex * 3;
-    float* vertices = new float[singleBufferSize];
-    float* normals = new float[singleBufferSize];
-    float* colors = new float[singleBufferSize];
+    bbox = cloud.GetBox();
+
+    // Plain arrays of vertices & normals
+    const int nbVertex = cloud.Size();
+    const size_t singleBufferSize = size_t(nbVertex) * 3;
+    std::vector<float> vertices(singleBufferSize);
+    std::vector<float> normals(singleBufferSize);
+#pragma omp parallel for
     for (int i = 0; i < nbVertex; i++)
     {
-        int indexVertex = vertexIndexes[i];
-        int indexNormal = normalIndexes[i];
-        int indexColor = colorIndexes[i];
-
-        Vector vertex = mesh.Vertex(indexVertex);
+        Vector vertex = cloud.Point(i);
         vertices[i * 3 + 0] = float(vertex[0]);
         vertices[i * 3 + 1] = float(vertex[1]);
         vertices[i * 3 + 2] = float(vertex[2]);
 
-        Vector normal = mesh.Normal(indexNormal);
+        Vector normal = cloud.Normal(i);
         normals[i * 3 + 0] = float(normal[0]);
         normals[i * 3 + 1] = float(normal[1]);
         normals[i * 3 + 2] = float(normal[2]);
-
-        Color color = mesh.GetColor(indexColor);
-        colors[i * 3 + 0] = float(color[0]);
-        colors[i * 3 + 1] = float(color[1]);
-        colors[i * 3 + 2] = float(color[2]);
     }
-    // Indices are now sorted
-    int* indices = new int[nbVertex];
-    for (int i = 0; i < nbVertex; i++)
-        indices[i] = i;
-    triangleCount = nbVertex;
+    pointCount = nbVertex;
 
-    // Generate vao & buffers
-    if (vao == 0)
-        glGenVertexArrays(1, &vao);
-    if (fullBuffer == 0)
-        glGenBuffers(1, &fullBuffer);
-    if (indexBuffer == 0)
-        glGenBuffers(1, &indexBuffer);
+    // Generate vao & buffer
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &fullBuffer);
 
     glBindVertexArray(vao);
-    size_t fullSize =
-            sizeof(float) * singleBufferSize	// Vertices
-            + sizeof(float) * singleBufferSize	// Normals
-            + sizeof(float) * singleBufferSize;	// Colors
+    size_t size = sizeof(float) * singleBufferSize;
     glBindBuffer(GL_ARRAY_BUFFER, fullBuffer);
-    glBufferData(GL_ARRAY_BUFFER, fullSize, nullptr, GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, 2 * size, nullptr, GL_STATIC_DRAW);
 
     // Vertices(0)
-    size_t size = 0;
     size_t offset = 0;
-    size = sizeof(float) * singleBufferSize;
-    glBufferSubData(GL_ARRAY_BUFFER, offset, size, vertices);
+    glBufferSubData(GL_ARRAY_BUFFER, offset, size, vertices.data());
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (const void*)offset);
     glEnableVertexAttribArray(0);
 
     // Normals(1)
     offset = offset + size;
-    size = sizeof(float) * singleBufferSize;
-    glBufferSubData(GL_ARRAY_BUFFER, offset, size, normals);
+    glBufferSubData(GL_ARRAY_BUFFER, offset, size, normals.data());
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (const void*)offset);
     glEnableVertexAttribArray(1);
+}
 
-    // Colors(2)
-    offset = offset + size;
-    size = sizeof(float) * singleBufferSize;
-    glBufferSubData(GL_ARRAY_BUFFER, offset, size, colors);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, (const void*)offset);
-    glEnableVertexAttribArray(2);
+/*!
+\brief Constructor from a HeightField, uploaded as a texture.
+
+The terrain is drawn as instances of a single patch of the grid, displaced in the vertex shader,
+so that no mesh is generated on the CPU. Patches are selected every frame in a quadtree, with a step between
+their vertices that depends on their projected error, and their border is extended by a skirt to hide cracks.
+\param hf the height field
+\param h height scale
+\param s size of a square of the grid
+\param mult slope coefficient of the coloring
+\param program terrain shader program
+*/
+MeshWidget::TerrainGL::TerrainGL(const HeightField& hf, double h, double s, double mult, GLuint program) :quadtree(hf, Patch, h, s)
+{
+    width = hf.getWidth();
+    length = hf.getLength();
+    heightMax = float(h);
+    squareSize = float(s);
+    slope = float(mult);
+    bbox = Box(Vector(-0.5 * width * s, s - 0.5 * length * s, 0.0), Vector((width - 1) * s - 0.5 * width * s, 0.5 * length * s, h));
+    material = MeshMaterial::Color;
+    tolerance = 2.0;
+    instanceCount = 0;
+
+    // Local coordinates of the vertices of a patch, with a flag for skirt vertices
+    std::vector<float> vertices;
+    for (int u = 0; u <= Patch; u++)
+    {
+        for (int v = 0; v <= Patch; v++)
+        {
+            vertices.insert(vertices.end(), { float(u), float(v), 0.0f });
+        }
+    }
+
+    // Two triangles per square, oriented upward
+    std::vector<int> indices;
+    for (int u = 1; u <= Patch; u++)
+    {
+        for (int v = 1; v <= Patch; v++)
+        {
+            const int fourth = u * (Patch + 1) + v;
+            const int first = fourth - Patch - 2, second = fourth - Patch - 1, third = fourth - 1;
+            indices.insert(indices.end(), { first, second, fourth, first, fourth, third });
+        }
+    }
+
+    // Skirts along the four sides
+    const int sides[4][2][2] = { { { 0, 0 }, { 0, 1 } }, { { Patch, 0 }, { 0, 1 } }, { { 0, 0 }, { 1, 0 } }, { { 0, Patch }, { 1, 0 } } };
+    for (int e = 0; e < 4; e++)
+    {
+        const int skirt = int(vertices.size() / 3);
+        for (int t = 0; t <= Patch; t++)
+        {
+            vertices.insert(vertices.end(), { float(sides[e][0][0] + t * sides[e][1][0]), float(sides[e][0][1] + t * sides[e][1][1]), 1.0f });
+        }
+        for (int t = 0; t < Patch; t++)
+        {
+            const int a = (sides[e][0][0] + t * sides[e][1][0]) * (Patch + 1) + sides[e][0][1] + t * sides[e][1][1];
+            const int b = a + sides[e][1][0] * (Patch + 1) + sides[e][1][1];
+            indices.insert(indices.end(), { a, b, skirt + t + 1, a, skirt + t + 1, skirt + t });
+        }
+    }
+    indexCount = int(indices.size());
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    glGenBuffers(1, &vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+    GLint location = glGetAttribLocation(program, "vertex");
+    glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glEnableVertexAttribArray(location);
+
+    // Filled every frame by Select()
+    glGenBuffers(1, &instanceBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_STREAM_DRAW);
+    location = glGetAttribLocation(program, "tile");
+    glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glEnableVertexAttribArray(location);
+    glVertexAttribDivisor(location, 1);
 
-    // Triangles
     glGenBuffers(1, &indexBuffer);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(int) * nbVertex, indices, GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(int) * indices.size(), indices.data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+
+    // Heights, rows of the height field are rows of the texture
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, length, width, 0, GL_RED, GL_FLOAT, hf[0]);
+}
+
+/*!
+\brief Upload a rectangle of modified heights.
+\param hf the height field
+\param i, j first height of the rectangle
+\param w, l size of the rectangle
+*/
+void MeshWidget::TerrainGL::Update(const HeightField& hf, int i, int j, int w, int l)
+{
+    // Clip to the grid
+    const int i0 = std::max(i, 0), j0 = std::max(j, 0);
+    const int i1 = std::min(i + w, width), j1 = std::min(j + l, length);
+    if (i1 <= i0 || j1 <= j0)
+        return;
+
+    quadtree.Update(hf, i0, j0, i1 - i0, j1 - j0);
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, length);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, j0, i0, j1 - j0, i1 - i0, GL_RED, GL_FLOAT, hf[i0] + j0);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
+/*!
+\brief Select the patches to draw from the camera, and upload them.
+\param camera The camera.
+\param w, h Size of the viewport.
+*/
+void MeshWidget::TerrainGL::Select(const Camera& camera, int w, int h)
+{
+    quadtree.Select(camera, w, h, tolerance, tiles);
+    instanceCount = int(tiles.size());
+
+    // Orphan the previous buffer
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(TerrainQuadtree::Tile) * tiles.size(), tiles.data(), GL_STREAM_DRAW);
+}
 
-    // Free data
-    delete[] vertices;
-    delete[] normals;
-    delete[] colors;
-    delete[] indices;
+/*!
+\brief Delete all opengl buffers and the texture.
+*/
+void MeshWidget::TerrainGL::Delete()
+{
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vertexBuffer);
+    glDeleteBuffers(1, &instanceBuffer);
+    glDeleteBuffers(1, &indexBuffer);
+    glDeleteTextures(1, &texture);
 }
 
 /*!
@@ -258,8 +501,18 @@ MeshWidget::~MeshWidget()
     // Destroy all meshes
     ClearAll();
 
-    // Release shader
+    // Release shaders
     release_program(mainShaderProgram);
+    release_program(pointShaderProgram);
+    release_program(terrainShaderProgram);
+
+    // Release slice buffers
+    glDeleteVertexArrays(1, &sliceVAO);
+    glDeleteBuffers(1, &sliceBuffer);
+
+    // Release contour buffers
+    glDeleteVertexArrays(1, &contourVAO);
+    glDeleteBuffers(1, &contourBuffer);
 }
 
 /*!
@@ -283,12 +536,15 @@ void MeshWidget::initializeGL()
 
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glEnable(GL_PROGRAM_POINT_SIZE);
 
     // If you have any problem with rendering, switch to these two lines.
     //const QString usedMeshShader = "mesh_basic.glsl";
    // const QString usedSkyShader = "skybox_basic.glsl";
     const QString usedMeshShader = "mesh.glsl";
     const QString usedSkyShader = "skybox.glsl";
+    const QString usedPointShader = "points.glsl";
+    const QString usedTerrainShader = "terrain.glsl";
 
     // Find path of shader files (depends on IDE: QtCreator or Visual Studio...)
     QString shaderPath;
@@ -316,6 +572,16 @@ void MeshWidget::initializeGL()
     ba = fullPath.toLocal8Bit();
     skyboxShader = read_program(ba.data());
     glGenVertexArrays(1, &skyboxVAO);
+
+    // Points
+    fullPath = shaderPath + usedPointShader;
+    ba = fullPath.toLocal8Bit();
+    pointShaderProgram = read_program(ba.data());
+
+    // Terrain
+    fullPath = shaderPath + usedTerrainShader;
+    ba = fullPath.toLocal8Bit();
+    terrainShaderProgram = read_program(ba.data());
 }
 
 /*!
@@ -389,7 +655,7 @@ void MeshWidget::paintGL()
 
     for (MeshIterator i = objects.begin(); i != objects.end(); i++)
     {
-        if (!i.value()->enabled)
+        if (!i.value()->enabled || i.value()->pointCount > 0)
             continue;
 
         // Uniforms
@@ -401,7 +667,75 @@ void MeshWidget::paintGL()
 
         // Draw
         glBindVertexArray(i.value()->vao);
-        glDrawElements(GL_TRIANGLES, (GLsizei)i.value()->triangleCount, GL_UNSIGNED_INT, nullptr);
+        glDrawElements(GL_TRIANGLES, (GLsizei)i.value()->triangleCount, i.value()->indexType, nullptr);
+    }
+
+    // Draw terrain
+    if (terrain != nullptr)
+    {
+        const float identity[16] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+        glUseProgram(terrainShaderProgram);
+        glUniformMatrix4fv(glGetUniformLocation(terrainShaderProgram, "ModelViewMatrix"), 1, 0, ModelViewMatrix);
+        glUniformMatrix4fv(glGetUniformLocation(terrainShaderProgram, "ProjectionMatrix"), 1, 0, ProjectionMatrix);
+        glUniformMatrix4fv(glGetUniformLocation(terrainShaderProgram, "TRSMatrix"), 1, GL_FALSE, identity);
+        glUniform3f(glGetUniformLocation(terrainShaderProgram, "viewDir"), view[0], view[1], view[2]);
+        glUniform1i(glGetUniformLocation(terrainShaderProgram, "material"), (int)terrain->material);
+        glUniform2i(glGetUniformLocation(terrainShaderProgram, "size"), terrain->width, terrain->length);
+        glUniform1f(glGetUniformLocation(terrainShaderProgram, "squareSize"), terrain->squareSize);
+        glUniform1f(glGetUniformLocation(terrainShaderProgram, "heightMax"), terrain->heightMax);
+        glUniform1f(glGetUniformLocation(terrainShaderProgram, "slope"), terrain->slope);
+        glUniform1i(glGetUniformLocation(terrainShaderProgram, "heights"), 0);
+
+        terrain->Select(camera, width(), height());
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, terrain->texture);
+        glBindVertexArray(terrain->vao);
+        glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)terrain->indexCount, GL_UNSIGNED_INT, nullptr, (GLsizei)terrain->instanceCount);
+    }
+
+    // Draw point clouds
+    glUseProgram(pointShaderProgram);
+    glUniformMatrix4fv(glGetUniformLocation(pointShaderProgram, "ModelViewMatrix"), 1, 0, ModelViewMatrix);
+    glUniformMatrix4fv(glGetUniformLocation(pointShaderProgram, "ProjectionMatrix"), 1, 0, ProjectionMatrix);
+    glUniform3f(glGetUniformLocation(pointShaderProgram, "viewDir"), view[0], view[1], view[2]);
+    glUniform1f(glGetUniformLocation(pointShaderProgram, "pointSize"), pointSize);
+    for (MeshIterator i = objects.begin(); i != objects.end(); i++)
+    {
+        if (!i.value()->enabled || i.value()->pointCount == 0)
+            continue;
+
+        glUniformMatrix4fv(glGetUniformLocation(pointShaderProgram, "TRSMatrix"), 1, GL_FALSE, &i.value()->TRSMatrix[0]);
+        glUniform1i(glGetUniformLocation(pointShaderProgram, "material"), (int)i.value()->material);
+
+        glBindVertexArray(i.value()->vao);
+        glDrawArrays(GL_POINTS, 0, (GLsizei)i.value()->pointCount);
+    }
+
+    // Draw contour lines slightly pulled toward the camera so that they are not hidden by the surface they lie on
+    if (!contourCounts.empty())
+    {
+        const float identity[16] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+        glUniformMatrix4fv(glGetUniformLocation(pointShaderProgram, "TRSMatrix"), 1, GL_FALSE, identity);
+        glDepthRange(0.0, 0.9995);
+        glBindVertexArray(contourVAO);
+        glVertexAttrib3f(1, 0.0f, 0.0f, 0.0f);
+        glMultiDrawArrays(GL_LINE_STRIP, contourFirsts.data(), contourCounts.data(), (GLsizei)contourCounts.size());
+        glDepthRange(0.0, 1.0);
+    }
+
+    // Draw slice on top of meshes, lines have null normals and a constant color
+    if (sliceVertexCount > 0)
+    {
+        const float identity[16] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+        glUniformMatrix4fv(glGetUniformLocation(pointShaderProgram, "TRSMatrix"), 1, GL_FALSE, identity);
+        glDisable(GL_DEPTH_TEST);
+        glBindVertexArray(sliceVAO);
+        glVertexAttrib3f(1, 0.0f, 0.0f, 0.0f);
+        glLineWidth(2.0f);
+        glDrawArrays(GL_LINES, 0, (GLsizei)sliceVertexCount);
+        glLineWidth(1.0f);
+        glEnable(GL_DEPTH_TEST);
     }
     profiler.EndGPU();
 
@@ -438,6 +772,17 @@ void MeshWidget::AddMesh(const QString& name, const MeshColor& mesh, const Vecto
     objects.insert(name, new MeshGL(mesh, frame));
 }
 
+/*!
+\brief Add a new point cloud in the scene.
+\param cloud new point cloud
+\param frame point cloud frame, identity by default.
+*/
+void MeshWidget::AddPoints(const QString& name, const PointCloud& cloud, const Vector& frame)
+{
+    makeCurrent();
+    objects.insert(name, new MeshGL(cloud, frame));
+}
+
 /*!
 \brief Delete a mesh in the scene from its name.
 \param name mesh name
@@ -496,6 +841,10 @@ void MeshWidget::ClearAll()
         delete i.value();
     }
     objects.clear();
+
+    ClearSlice();
+    ClearTerrain();
+    ClearContours();
 }
 
 /*!
@@ -580,6 +929,8 @@ void MeshWidget::SetMaterialGlobal(MeshMaterial mat)
 {
     for (MeshIterator i = objects.begin(); i != objects.end(); i++)
         i.value()->material = mat;
+    if (terrain != nullptr)
+        terrain->material = mat;
 }
 
 /*!
@@ -623,6 +974,174 @@ void MeshWidget::SetShadingGlobal(MeshShading shading)
         i.value()->shading = shading;
 }
 
+/*!
+\brief Changes the size of the points of point clouds.
+\param size size in pixels
+*/
+void MeshWidget::SetPointSize(double size)
+{
+    pointSize = float(size);
+}
+
+/*!
+\brief Set the mesh cut by the slice plane.
+
+The cross section is displayed once the plane is dragged with Alt + Left Mouse Move.
+\param mesh the mesh
+\param normal normal of the slice plane
+*/
+void MeshWidget::SetSlice(const Mesh& mesh, const Vector& normal)
+{
+    delete slicer;
+    slicer = new MeshSlicer(mesh);
+    sliceNormal = Normalized(normal);
+    sliceOffset = sliceNormal * slicer->GetBox().Center();
+    sliceVertexCount = 0;
+}
+
+/*!
+\brief Set the terrain, replacing the previous one.
+
+Heights are uploaded once as a texture and displaced on the GPU.
+\param hf the height field
+\param h height scale
+\param s size of a square of the grid
+\param mult slope coefficient of the coloring
+*/
+void MeshWidget::SetTerrain(const HeightField& hf, double h, double s, double mult)
+{
+    ClearTerrain();
+    if (hf.getWidth() < 2 || hf.getLength() < 2)
+        return;
+    makeCurrent();
+    terrain = new TerrainGL(hf, h, s, mult, terrainShaderProgram);
+}
+
+/*!
+\brief Upload modified heights of the terrain.
+\param hf the height field, with the same size as the terrain
+\param i, j first height of the modified rectangle
+\param w, l size of the modified rectangle
+*/
+void MeshWidget::UpdateTerrain(const HeightField& hf, int i, int j, int w, int l)
+{
+    if (terrain == nullptr)
+        return;
+    makeCurrent();
+    terrain->Update(hf, i, j, w, l);
+}
+
+/*!
+\brief Remove the terrain.
+*/
+void MeshWidget::ClearTerrain()
+{
+    if (terrain == nullptr)
+        return;
+    makeCurrent();
+    terrain->Delete();
+    delete terrain;
+    terrain = nullptr;
+}
+
+/*!
+\brief Remove the slice plane.
+*/
+void MeshWidget::ClearSlice()
+{
+    delete slicer;
+    slicer = nullptr;
+    sliceVertexCount = 0;
+}
+
+/*!
+\brief Set the contour lines drawn over the scene, replacing the previous ones.
+
+Every polyline is drawn as a line strip, with the constant color of the slice.
+\param polylines the lines, typically computed by HeightFieldContour
+*/
+void MeshWidget::SetContours(const std::vector<std::vector<Vector>>& polylines)
+{
+    contourFirsts.clear();
+    contourCounts.clear();
+    std::vector<float> vertices;
+    for (const std::vector<Vector>& polyline : polylines)
+    {
+        if (polyline.size() < 2)
+            continue;
+        contourFirsts.push_back(GLint(vertices.size() / 3));
+        contourCounts.push_back(GLsizei(polyline.size()));
+        for (const Vector& p : polyline)
+        {
+            vertices.push_back(float(p[0]));
+            vertices.push_back(float(p[1]));
+            vertices.push_back(float(p[2]));
+        }
+    }
+
+    makeCurrent();
+    if (contourVAO == 0)
+    {
+        glGenVertexArrays(1, &contourVAO);
+        glGenBuffers(1, &contourBuffer);
+    }
+    glBindVertexArray(contourVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, contourBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertices.size(), vertices.data(), GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glEnableVertexAttribArray(0);
+    glDisableVertexAttribArray(1);
+}
+
+/*!
+\brief Remove the contour lines.
+*/
+void MeshWidget::ClearContours()
+{
+    contourFirsts.clear();
+    contourCounts.clear();
+}
+
+/*!
+\brief Compute the cross section at the current slice plane and upload its segments.
+*/
+void MeshWidget::UpdateSlice()
+{
+    if (slicer == nullptr)
+        return;
+
+    std::vector<std::vector<Vector>> polylines = slicer->Slice(sliceNormal * sliceOffset, sliceNormal);
+
+    // Segments as pairs of vertices
+    std::vector<float> vertices;
+    for (const std::vector<Vector>& polyline : polylines)
+    {
+        for (size_t i = 1; i < polyline.size(); i++)
+        {
+            for (const Vector& p : { polyline[i - 1], polyline[i] })
+            {
+                vertices.push_back(float(p[0]));
+                vertices.push_back(float(p[1]));
+                vertices.push_back(float(p[2]));
+            }
+        }
+    }
+    sliceVertexCount = int(vertices.size() / 3);
+
+    makeCurrent();
+    if (sliceVAO == 0)
+    {
+        glGenVertexArrays(1, &sliceVAO);
+        glGenBuffers(1, &sliceBuffer);
+    }
+    glBindVertexArray(sliceVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, sliceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertices.size(), vertices.data(), GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glEnableVertexAttribArray(0);
+    glDisableVertexAttribArray(1);
+}
+
 
 /*!
 \brief Capture the rendering viewport and save it to disk.
@@ -683,7 +1202,20 @@ void MeshWidget::RenderStats()
     const int bX = 10;
     const int bY = 10;
     const int sizeX = 200;
-    const int sizeY = 65;
+    const int sizeY = 95;
+
+    // Memory of the meshes, compared to one vertex per triangle corner
+    size_t triangles = 0, bytes = 0, deindexedBytes = 0;
+    for (MeshIterator i = objects.begin(); i != objects.end(); i++)
+    {
+        if (i.value()->pointCount > 0)
+            continue;
+        triangles += i.value()->triangleCount / 3;
+        bytes += i.value()->bytes;
+        deindexedBytes += i.value()->deindexedBytes;
+    }
+    const double perTriangle = (triangles > 0) ? double(bytes) / triangles : 0.0;
+    const double deindexedPerTriangle = (triangles > 0) ? double(deindexedBytes) / triangles : 0.0;
 
     // Background
     painter.setPen(penLineGrey);
@@ -700,6 +1232,8 @@ void MeshWidget::RenderStats()
     painter.drawText(10 + 5, bY + 10 + 20, "CPU FPS:\t" + QString::number(profiler.framePerSecond));
     painter.drawText(10 + 5, bY + 10 + 35, "CPU Frame:\t" + QString::number(profiler.msPerFrame) + "ms");
     painter.drawText(10 + 5, bY + 10 + 50, "GPU:\t" + QString::number(profiler.elapsedTimeGPU / 1000000.0) + "ms");
+    painter.drawText(10 + 5, bY + 10 + 65, "Meshes:\t" + QString::number(perTriangle, 'f', 1) + " B/triangle");
+    painter.drawText(10 + 5, bY + 10 + 80, "Unshared:\t" + QString::number(deindexedPerTriangle, 'f', 1) + " B/triangle");
 
     painter.end();
 
@@ -800,6 +1334,16 @@ void MeshWidget::mouseMoveEvent(QMouseEvent* e)
 
         emit _signalMouseMove(e);
     }
+    if ((e->modifiers() & Qt::AltModifier) && (e->buttons() & Qt::LeftButton) && slicer != nullptr)
+    {
+        // Alt + Left Mouse Move     : Drag the slice plane along its normal
+        const Box box = slicer->GetBox();
+        const double c = sliceNormal * box.Center();
+        sliceOffset = Math::Clamp(sliceOffset + (y0 - y) * 2.0 * box.Radius() / height(), c - box.Radius(), c + box.Radius());
+        UpdateSlice();
+
+        _InternalGetMouseGlobalPosition(e, x0, y0);
+    }
     if (e->modifiers() & Qt::ShiftModifier)
     {
         emit _signalMouseMoveEdit(e);
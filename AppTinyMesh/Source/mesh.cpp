@@ -1,5 +1,7 @@
 #include "mesh.h"
+#include "kdtree.h"
 #include <QDebug>
+#include <cfloat>
 #include <string>
 
 /*!
@@ -41,6 +43,17 @@ Mesh::Mesh(const std::vector<Vector>& vertices, const std::vector<Vector>& norma
 {
 }
 
+/*!
+\brief Create the mesh by moving arrays, which avoids copying large meshes.
+
+\param vertices Array of vertices.
+\param normals Array of normals.
+\param va, na Array of vertex and normal indexes.
+*/
+Mesh::Mesh(std::vector<Vector>&& vertices, std::vector<Vector>&& normals, std::vector<int>&& va, std::vector<int>&& na) :vertices(std::move(vertices)), normals(std::move(normals)), varray(std::move(va)), narray(std::move(na))
+{
+}
+
 /*!
 \brief Reserve memory for arrays.
 \param nv,nn,nvi,nvn Number of vertices, normals, vertex indexes and vertex normals.
@@ -587,6 +600,35 @@ void Mesh::SphereWarp(const Vector& center, double radius, const Vector& directi
   }
 }
 
+/*!
+\brief Translate vertices located in a sphere, using a point index to visit only the vertices inside the sphere.
+
+The result is the same as SphereWarp(const Vector&, double, const Vector&), but the cost depends on the number
+of vertices in the sphere rather than on the size of the mesh, which is useful for interactive editing.
+\param tree Index of the vertices, built from the current vertices of the mesh.
+\param center The center of the sphere.
+\param radius The radius of the sphere.
+\param direction The vector direction that indicate where to translate to and the "strength".
+*/
+void Mesh::SphereWarp(const KdTree& tree, const Vector& center, double radius, const Vector& direction)
+{
+  // The index stores single precision coordinates, whose rounding grows with their magnitude:
+  // enlarge the query by a few units in the last place and check exactly
+  std::vector<int> inside;
+  tree.Radius(center, radius + 4.0 * (Norm(center) + radius) * FLT_EPSILON, inside);
+
+  double rad = radius * radius;
+  for (int k = 0; k < int(inside.size()); k++)
+  {
+    const int i = inside[k];
+    double distance = SquaredNorm(center - vertices[i]);
+    if (distance < rad)
+    {
+      vertices[i] += (radius - sqrt(distance)) * direction;
+    }
+  }
+}
+
 
 
 #include <QtCore/QFile>
@@ -0,0 +1,468 @@
+// MeshAnalysis
+
+#include "meshanalysis.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+/*!
+\class MeshAnalysis meshanalysis.h
+\brief A quality and validity report of a triangle mesh.
+
+The analysis checks vertex indexes, counts degenerate and duplicate triangles, classifies edges as boundary,
+manifold or non-manifold, counts boundary loops, and computes the total area, the enclosed volume and the centroid.
+It also computes histograms of the aspect ratio and of the smallest angle of the triangles.
+
+Triangles are processed in parallel by fixed blocks with compensated sums, and the sums of the blocks
+are added pairwise, so that results do not depend on the number of threads.
+Edges and triangles are sorted with a parallel bucket sort on their smallest vertex index,
+which scales to meshes with hundreds of millions of triangles.
+
+\code
+MeshAnalysis analysis(mesh);
+std::cout << analysis.Json() << std::endl;
+\endcode
+*/
+
+// Compensated sum
+struct KahanSum
+{
+  double s = 0.0; //!< Sum.
+  double c = 0.0; //!< Compensation of the lost low order bits.
+
+  //! Add a term.
+  void Add(double x)
+  {
+    const double y = x - c;
+    const double t = s + y;
+    c = (t - s) - y;
+    s = t;
+  }
+};
+
+// Sums computed per block of triangles
+enum { SumArea, SumVolume, SumVX, SumVY, SumVZ, SumAX, SumAY, SumAZ, SumAspect, Sums };
+
+/*!
+\brief Pairwise sum of a component of the block sums.
+\param v Block sums.
+\param k Component.
+\param a, b Range of blocks, b excluded.
+*/
+static double PairwiseSum(const std::vector<std::array<double, Sums>>& v, int k, int a, int b)
+{
+  if (b - a == 0)
+    return 0.0;
+  if (b - a == 1)
+    return v[a][k];
+  const int m = (a + b) / 2;
+  return PairwiseSum(v, k, a, m) + PairwiseSum(v, k, m, b);
+}
+
+/*!
+\brief Sort an array in parallel.
+
+Elements are scattered into buckets, which should be ordered consistently with the elements, and buckets are then sorted in parallel.
+\param a Array.
+\param buckets Number of buckets.
+\param bucket Function returning the bucket of an element.
+\return Start of the buckets in the sorted array, with the size of the array as last entry.
+*/
+template <typename T, typename B>
+static std::vector<size_t> BucketSort(std::vector<T>& a, int buckets, B bucket)
+{
+  const size_t n = a.size();
+  const int blocks = 64;
+
+  // Count per block and bucket
+  std::vector<size_t> count(size_t(blocks) * buckets, 0);
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int k = 0; k < blocks; k++)
+  {
+    for (size_t i = n * k / blocks; i < n * (k + 1) / blocks; i++)
+    {
+      count[size_t(k) * buckets + bucket(a[i])]++;
+    }
+  }
+
+  // Offsets, bucket major
+  std::vector<size_t> start(buckets + 1);
+  size_t s = 0;
+  for (int b = 0; b < buckets; b++)
+  {
+    start[b] = s;
+    for (int k = 0; k < blocks; k++)
+    {
+      const size_t c = count[size_t(k) * buckets + b];
+      count[size_t(k) * buckets + b] = s;
+      s += c;
+    }
+  }
+  start[buckets] = n;
+
+  // Scatter
+  std::vector<T> sorted(n);
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int k = 0; k < blocks; k++)
+  {
+    for (size_t i = n * k / blocks; i < n * (k + 1) / blocks; i++)
+    {
+      sorted[count[size_t(k) * buckets + bucket(a[i])]++] = a[i];
+    }
+  }
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int b = 0; b < buckets; b++)
+  {
+    std::sort(sorted.begin() + start[b], sorted.begin() + start[b + 1]);
+  }
+
+  a.swap(sorted);
+  return start;
+}
+
+/*!
+\brief Analyze a mesh.
+\param mesh The mesh.
+*/
+MeshAnalysis::MeshAnalysis(const Mesh& mesh)
+{
+  const auto start = std::chrono::high_resolution_clock::now();
+
+  vertices = mesh.Vertexes();
+  triangles = mesh.Triangles();
+
+  Geometry(mesh);
+  Topology(mesh);
+
+  seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+/*!
+\brief Check the indexes and compute the geometric quantities and quality histograms.
+\param mesh The mesh.
+*/
+void MeshAnalysis::Geometry(const Mesh& mesh)
+{
+  const int block = 1 << 16;
+  const int blocks = (triangles + block - 1) / block;
+
+  // Counters: invalid, degenerate, then histograms
+  const int Counters = 2 + 2 * Bins;
+  std::vector<std::array<double, Sums>> sums(blocks);
+  std::vector<std::array<long long, Counters>> counts(blocks);
+  std::vector<Vector> lo(blocks), hi(blocks);
+  std::vector<double> minAspect(blocks), maxAspect(blocks), minAngle(blocks);
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int b = 0; b < blocks; b++)
+  {
+    KahanSum sum[Sums];
+    std::array<long long, Counters> count = { 0 };
+    Vector a(std::numeric_limits<double>::max()), c(-std::numeric_limits<double>::max());
+    double amin = 1.0, amax = 0.0, gmin = 60.0;
+
+    for (int t = b * block; t < std::min(triangles, (b + 1) * block); t++)
+    {
+      const int i0 = mesh.VertexIndex(t, 0), i1 = mesh.VertexIndex(t, 1), i2 = mesh.VertexIndex(t, 2);
+      if (i0 < 0 || i1 < 0 || i2 < 0 || i0 >= vertices || i1 >= vertices || i2 >= vertices)
+      {
+        count[0]++;
+        continue;
+      }
+
+      const Vector p0 = mesh.Vertex(i0), p1 = mesh.Vertex(i1), p2 = mesh.Vertex(i2);
+      a = Vector::Min(Vector::Min(a, p0), Vector::Min(p1, p2));
+      c = Vector::Max(Vector::Max(c, p0), Vector::Max(p1, p2));
+
+      // Area, signed volume of the tetrahedron with the origin and centroids
+      const Vector e0 = p1 - p0, e1 = p2 - p1, e2 = p0 - p2;
+      const double ta = 0.5 * Norm(e0 / e2);
+      const double tv = (p0 * (p1 / p2)) / 6.0;
+      const Vector g = (p0 + p1 + p2) / 3.0;
+      sum[SumArea].Add(ta);
+      sum[SumVolume].Add(tv);
+      for (int k = 0; k < 3; k++)
+      {
+        sum[SumVX + k].Add(0.75 * tv * g[k]);
+        sum[SumAX + k].Add(ta * g[k]);
+      }
+
+      // Quality, null for degenerate triangles
+      const double l = Math::Max(SquaredNorm(e0), SquaredNorm(e1), SquaredNorm(e2));
+      double aspect = 0.0, angle = 0.0;
+      if (i0 == i1 || i1 == i2 || i2 == i0 || ta <= 1.0e-12 * l)
+      {
+        count[1]++;
+      }
+      else
+      {
+        aspect = Math::Clamp(Triangle(p0, p1, p2).Aspect(), 0.0, 1.0);
+        const double n = 2.0 * ta;
+        angle = Math::Min(atan2(n, -(e0 * e2)), atan2(n, -(e0 * e1)), atan2(n, -(e1 * e2))) * 180.0 / M_PI;
+      }
+      sum[SumAspect].Add(aspect);
+      amin = Math::Min(amin, aspect);
+      amax = Math::Max(amax, aspect);
+      gmin = Math::Min(gmin, angle);
+      count[2 + std::min(int(aspect * Bins), Bins - 1)]++;
+      count[2 + Bins + std::min(int(angle / 60.0 * Bins), Bins - 1)]++;
+    }
+
+    for (int k = 0; k < Sums; k++)
+    {
+      sums[b][k] = sum[k].s;
+    }
+    counts[b] = count;
+    lo[b] = a;
+    hi[b] = c;
+    minAspect[b] = amin;
+    maxAspect[b] = amax;
+    minAngle[b] = gmin;
+  }
+
+  // Reduction
+  std::array<long long, Counters> count = { 0 };
+  Vector a(std::numeric_limits<double>::max()), c(-std::numeric_limits<double>::max());
+  aspect[0] = 1.0;
+  aspect[1] = 0.0;
+  angle = 60.0;
+  for (int b = 0; b < blocks; b++)
+  {
+    for (int k = 0; k < Counters; k++)
+    {
+      count[k] += counts[b][k];
+    }
+    a = Vector::Min(a, lo[b]);
+    c = Vector::Max(c, hi[b]);
+    aspect[0] = Math::Min(aspect[0], minAspect[b]);
+    aspect[1] = Math::Max(aspect[1], maxAspect[b]);
+    angle = Math::Min(angle, minAngle[b]);
+  }
+
+  invalid = count[0];
+  degenerate = count[1];
+  for (int k = 0; k < Bins; k++)
+  {
+    aspectHistogram[k] = count[2 + k];
+    angleHistogram[k] = count[2 + Bins + k];
+  }
+
+  const long long valid = triangles - invalid;
+  box = (valid > 0) ? Box(a, c) : Box::Null;
+  if (valid == 0)
+  {
+    aspect[0] = aspect[1] = angle = 0.0;
+  }
+
+  area = PairwiseSum(sums, SumArea, 0, blocks);
+  volume = PairwiseSum(sums, SumVolume, 0, blocks);
+  aspect[2] = (valid > 0) ? PairwiseSum(sums, SumAspect, 0, blocks) / valid : 0.0;
+
+  // Volume centroid for closed meshes, surface centroid otherwise
+  const Vector vc(PairwiseSum(sums, SumVX, 0, blocks), PairwiseSum(sums, SumVY, 0, blocks), PairwiseSum(sums, SumVZ, 0, blocks));
+  const Vector ac(PairwiseSum(sums, SumAX, 0, blocks), PairwiseSum(sums, SumAY, 0, blocks), PairwiseSum(sums, SumAZ, 0, blocks));
+  if (fabs(volume) > 1.0e-12 * pow(box.Radius(), 3.0))
+    centroid = vc / volume;
+  else if (area > 0.0)
+    centroid = ac / area;
+  else
+    centroid = Vector::Null;
+}
+
+/*!
+\brief Classify the edges, count boundary loops and duplicate triangles.
+\param mesh The mesh.
+*/
+void MeshAnalysis::Topology(const Mesh& mesh)
+{
+  const int buckets = 4096;
+  const size_t n = size_t(triangles);
+
+  // Edge keys: smallest vertex, largest vertex, and orientation in the lowest bit
+  const uint64_t none = ~uint64_t(0);
+  std::vector<uint64_t> keys(3 * n);
+#pragma omp parallel for
+  for (int t = 0; t < triangles; t++)
+  {
+    int v[3];
+    bool valid = true;
+    for (int k = 0; k < 3; k++)
+    {
+      v[k] = mesh.VertexIndex(t, k);
+      valid = valid && v[k] >= 0 && v[k] < vertices;
+    }
+    valid = valid && v[0] != v[1] && v[1] != v[2] && v[2] != v[0];
+    for (int k = 0; k < 3; k++)
+    {
+      const int a = v[k], b = v[(k + 1) % 3];
+      keys[3 * size_t(t) + k] = valid ? ((uint64_t(std::min(a, b)) << 32 | uint64_t(std::max(a, b))) << 1 | (a > b ? 1 : 0)) : none;
+    }
+  }
+
+  std::vector<size_t> start = BucketSort(keys, buckets, [&](uint64_t key)
+    {
+      return (key == none) ? buckets - 1 : int((key >> 33) * buckets / uint64_t(vertices));
+    });
+
+  // Edges never straddle buckets
+  long long e = 0, be = 0, nme = 0, ie = 0;
+  std::vector<std::vector<std::pair<int, int>>> open(buckets);
+#pragma omp parallel for schedule(dynamic, 16) reduction(+:e, be, nme, ie)
+  for (int b = 0; b < buckets; b++)
+  {
+    size_t i = start[b];
+    while (i < start[b + 1] && keys[i] != none)
+    {
+      size_t j = i + 1;
+      while (j < start[b + 1] && (keys[j] >> 1) == (keys[i] >> 1))
+        j++;
+
+      e++;
+      if (j - i == 1)
+      {
+        be++;
+        open[b].push_back(std::make_pair(int(keys[i] >> 33), int((keys[i] >> 1) & 0xFFFFFFFF)));
+      }
+      else if (j - i == 2)
+      {
+        if ((keys[i] & 1) == (keys[i + 1] & 1))
+          ie++;
+      }
+      else
+        nme++;
+      i = j;
+    }
+  }
+  edges = e;
+  boundary = be;
+  nonManifold = nme;
+  inconsistent = ie;
+  keys = std::vector<uint64_t>();
+
+  // Boundary loops are the connected components of the boundary edges
+  loops = 0;
+  if (boundary > 0)
+  {
+    std::vector<int> parent(vertices, -1);
+    auto find = [&](int x)
+      {
+        while (parent[x] != x)
+        {
+          parent[x] = parent[parent[x]];
+          x = parent[x];
+        }
+        return x;
+      };
+    for (int b = 0; b < buckets; b++)
+    {
+      for (const std::pair<int, int>& edge : open[b])
+      {
+        for (int v : { edge.first, edge.second })
+        {
+          if (parent[v] < 0)
+          {
+            parent[v] = v;
+            loops++;
+          }
+        }
+        const int r0 = find(edge.first), r1 = find(edge.second);
+        if (r0 != r1)
+        {
+          parent[r0] = r1;
+          loops--;
+        }
+      }
+    }
+  }
+
+  // Duplicate triangles share the same sorted vertices
+  std::vector<std::array<int, 3>> sorted(n);
+#pragma omp parallel for
+  for (int t = 0; t < triangles; t++)
+  {
+    std::array<int, 3> v = { mesh.VertexIndex(t, 0), mesh.VertexIndex(t, 1), mesh.VertexIndex(t, 2) };
+    std::sort(v.begin(), v.end());
+    if (v[0] < 0 || v[2] >= vertices)
+      v = { INT_MAX, INT_MAX, INT_MAX };
+    sorted[t] = v;
+  }
+
+  start = BucketSort(sorted, buckets, [&](const std::array<int, 3>& v)
+    {
+      return (v[0] == INT_MAX) ? buckets - 1 : int(uint64_t(v[0]) * buckets / uint64_t(vertices));
+    });
+
+  long long d = 0;
+#pragma omp parallel for schedule(dynamic, 16) reduction(+:d)
+  for (int b = 0; b < buckets; b++)
+  {
+    for (size_t i = start[b] + 1; i < start[b + 1]; i++)
+    {
+      if (sorted[i][0] != INT_MAX && sorted[i] == sorted[i - 1])
+        d++;
+    }
+  }
+  duplicate = d;
+}
+
+/*!
+\brief Return the report in JSON format.
+*/
+std::string MeshAnalysis::Json() const
+{
+  std::ostringstream s;
+  s << std::setprecision(12);
+
+  auto vector = [&](const Vector& v)
+    {
+      s << "[" << v[0] << ", " << v[1] << ", " << v[2] << "]";
+    };
+  auto histogram = [&](const long long* h)
+    {
+      s << "[";
+      for (int i = 0; i < Bins; i++)
+      {
+        s << (i > 0 ? ", " : "") << h[i];
+      }
+      s << "]";
+    };
+
+  s << "{\n";
+  s << "  \"vertices\": " << vertices << ",\n";
+  s << "  \"triangles\": " << triangles << ",\n";
+  s << "  \"invalid_triangles\": " << invalid << ",\n";
+  s << "  \"degenerate_triangles\": " << degenerate << ",\n";
+  s << "  \"duplicate_triangles\": " << duplicate << ",\n";
+  s << "  \"edges\": " << edges << ",\n";
+  s << "  \"boundary_edges\": " << boundary << ",\n";
+  s << "  \"non_manifold_edges\": " << nonManifold << ",\n";
+  s << "  \"inconsistent_edges\": " << inconsistent << ",\n";
+  s << "  \"boundary_loops\": " << loops << ",\n";
+  s << "  \"closed\": " << (IsClosed() ? "true" : "false") << ",\n";
+  s << "  \"manifold\": " << (IsManifold() ? "true" : "false") << ",\n";
+  s << "  \"area\": " << area << ",\n";
+  s << "  \"volume\": " << volume << ",\n";
+  s << "  \"centroid\": ";
+  vector(centroid);
+  s << ",\n  \"box\": { \"min\": ";
+  vector(box[0]);
+  s << ", \"max\": ";
+  vector(box[1]);
+  s << " },\n";
+  s << "  \"aspect\": { \"min\": " << aspect[0] << ", \"max\": " << aspect[1] << ", \"mean\": " << aspect[2] << ", \"histogram\": ";
+  histogram(aspectHistogram);
+  s << " },\n";
+  s << "  \"min_angle\": { \"min\": " << angle << ", \"histogram\": ";
+  histogram(angleHistogram);
+  s << " },\n";
+  s << "  \"seconds\": " << seconds << "\n";
+  s << "}";
+  return s.str();
+}
@@ -17,6 +17,16 @@ MeshColor::MeshColor(const Mesh& m, const std::vector<Color>& cols, const std::v
 {
 }
 
+/*!
+\brief Constructor moving a Mesh, a color array and indices, which avoids copying large meshes.
+\param m Base mesh.
+\param cols Color array.
+\param carr Color indexes, should be the same size as Mesh::varray and Mesh::narray.
+*/
+MeshColor::MeshColor(Mesh&& m, std::vector<Color>&& cols, std::vector<int>&& carr) : Mesh(std::move(m)), colors(std::move(cols)), carray(std::move(carr))
+{
+}
+
 /*!
 \brief Constructor from a Mesh.
 \param m the base mesh
@@ -0,0 +1,270 @@
+// MeshComponents
+
+#include "meshcomponents.h"
+
+#include <atomic>
+#include <limits>
+
+/*!
+\class MeshComponents meshcomponents.h
+\brief Connected components of the triangles of a mesh, two triangles being connected if they share a vertex.
+
+Components are labeled with a lock-free concurrent union-find over the vertices: roots are linked with
+a compare and swap, always from the larger to the smaller index, and paths are compressed by halving.
+Components are numbered in the order of their first triangle, so the labeling does not depend on the number of threads.
+
+\code
+Mesh mesh;
+implicit.Polygonize(128, mesh, Box(2.0));
+mesh = MeshComponents(mesh).Remove(mesh, 100); // Remove debris with less than 100 triangles
+\endcode
+*/
+
+/*!
+\brief Find the root of an element, with path halving.
+\param parent Parents.
+\param x Element.
+*/
+static int Find(std::atomic<int>* parent, int x)
+{
+  while (true)
+  {
+    int y = parent[x].load(std::memory_order_relaxed);
+    if (y == x)
+      return x;
+    const int z = parent[y].load(std::memory_order_relaxed);
+    if (z != y)
+    {
+      // Halving may fail if another thread changed the parent, which is harmless
+      parent[x].compare_exchange_weak(y, z, std::memory_order_relaxed);
+    }
+    x = z;
+  }
+}
+
+/*!
+\brief Merge the sets of two elements.
+\param parent Parents.
+\param a, b Elements.
+*/
+static void Unite(std::atomic<int>* parent, int a, int b)
+{
+  while (true)
+  {
+    a = Find(parent, a);
+    b = Find(parent, b);
+    if (a == b)
+      return;
+    // Link the larger root to the smaller one, which cannot create cycles
+    if (a < b)
+      std::swap(a, b);
+    int root = a;
+    if (parent[a].compare_exchange_strong(root, b, std::memory_order_relaxed))
+      return;
+  }
+}
+
+/*!
+\brief Label the connected components of a mesh.
+\param mesh The mesh.
+*/
+MeshComponents::MeshComponents(const Mesh& mesh)
+{
+  const int n = mesh.Triangles();
+  const int nv = mesh.Vertexes();
+  const std::vector<int> va = mesh.VertexIndexes();
+
+  std::vector<std::atomic<int>> parent(nv);
+#pragma omp parallel for
+  for (int i = 0; i < nv; i++)
+  {
+    parent[i].store(i, std::memory_order_relaxed);
+  }
+
+#pragma omp parallel for schedule(dynamic, 4096)
+  for (int t = 0; t < n; t++)
+  {
+    Unite(parent.data(), va[3 * t], va[3 * t + 1]);
+    Unite(parent.data(), va[3 * t], va[3 * t + 2]);
+  }
+
+  label.resize(n);
+#pragma omp parallel for
+  for (int t = 0; t < n; t++)
+  {
+    label[t] = Find(parent.data(), va[3 * t]);
+  }
+
+  // Number the roots in the order of the first triangle of their component
+  std::vector<int> id(nv, -1);
+  int components = 0;
+  for (int t = 0; t < n; t++)
+  {
+    if (id[label[t]] < 0)
+      id[label[t]] = components++;
+  }
+#pragma omp parallel for
+  for (int t = 0; t < n; t++)
+  {
+    label[t] = id[label[t]];
+  }
+
+  // Sort triangles by component with a counting sort, preserving their order
+  start.assign(components + 1, 0);
+  for (int t = 0; t < n; t++)
+  {
+    start[label[t] + 1]++;
+  }
+  for (int c = 0; c < components; c++)
+  {
+    start[c + 1] += start[c];
+  }
+  order.resize(n);
+  std::vector<int> next(start.begin(), start.end() - 1);
+  for (int t = 0; t < n; t++)
+  {
+    order[next[label[t]]++] = t;
+  }
+
+  // Boxes and areas
+  boxes.resize(components);
+  areas.resize(components);
+#pragma omp parallel for schedule(dynamic, 16)
+  for (int c = 0; c < components; c++)
+  {
+    Vector a(std::numeric_limits<double>::max()), b(-std::numeric_limits<double>::max());
+    double area = 0.0;
+    for (int i = start[c]; i < start[c + 1]; i++)
+    {
+      const int t = order[i];
+      const Vector p0 = mesh.Vertex(va[3 * t]), p1 = mesh.Vertex(va[3 * t + 1]), p2 = mesh.Vertex(va[3 * t + 2]);
+      a = Vector::Min(Vector::Min(a, p0), Vector::Min(p1, p2));
+      b = Vector::Max(Vector::Max(b, p0), Vector::Max(p1, p2));
+      area += 0.5 * Norm((p1 - p0) / (p2 - p0));
+    }
+    boxes[c] = Box(a, b);
+    areas[c] = area;
+  }
+}
+
+/*!
+\brief Create a mesh from a subset of triangles, keeping only the referenced vertices and normals.
+
+Maps should be filled with -1, and are restored on return so that they can be reused.
+\param mesh The mesh.
+\param va, na Vertex and normal indexes of the mesh, na may be empty.
+\param t, n Triangle indexes and their number.
+\param vm, nm Vertex and normal maps.
+*/
+static Mesh Gather(const Mesh& mesh, const std::vector<int>& va, const std::vector<int>& na, const int* t, int n, std::vector<int>& vm, std::vector<int>& nm)
+{
+  std::vector<Vector> vertices, normals;
+  std::vector<int> vi, ni;
+  vi.reserve(3 * n);
+  if (!na.empty())
+    ni.reserve(3 * n);
+
+  for (int i = 0; i < n; i++)
+  {
+    for (int k = 0; k < 3; k++)
+    {
+      const int v = va[3 * t[i] + k];
+      if (vm[v] < 0)
+      {
+        vm[v] = int(vertices.size());
+        vertices.push_back(mesh.Vertex(v));
+      }
+      vi.push_back(vm[v]);
+
+      if (!na.empty())
+      {
+        const int m = na[3 * t[i] + k];
+        if (nm[m] < 0)
+        {
+          nm[m] = int(normals.size());
+          normals.push_back(mesh.Normal(m));
+        }
+        ni.push_back(nm[m]);
+      }
+    }
+  }
+
+  // Restore maps
+  for (int i = 0; i < n; i++)
+  {
+    for (int k = 0; k < 3; k++)
+    {
+      vm[va[3 * t[i] + k]] = -1;
+      if (!na.empty())
+        nm[na[3 * t[i] + k]] = -1;
+    }
+  }
+
+  if (na.empty())
+    return Mesh(vertices, vi);
+  return Mesh(vertices, normals, vi, ni);
+}
+
+/*!
+\brief Extract a set of components.
+\param mesh The mesh that was labeled.
+\param components Components to extract.
+*/
+Mesh MeshComponents::Extract(const Mesh& mesh, const std::vector<int>& components) const
+{
+  const std::vector<int> va = mesh.VertexIndexes();
+  std::vector<int> na = mesh.NormalIndexes();
+  if (na.size() != va.size())
+    na.clear();
+
+  std::vector<int> t;
+  for (int c : components)
+  {
+    t.insert(t.end(), order.begin() + start[c], order.begin() + start[c + 1]);
+  }
+
+  std::vector<int> vm(mesh.Vertexes(), -1), nm(na.empty() ? 0 : mesh.Normals(), -1);
+  return Gather(mesh, va, na, t.data(), int(t.size()), vm, nm);
+}
+
+/*!
+\brief Split a mesh into its components.
+\param mesh The mesh that was labeled.
+*/
+std::vector<Mesh> MeshComponents::Split(const Mesh& mesh) const
+{
+  const std::vector<int> va = mesh.VertexIndexes();
+  std::vector<int> na = mesh.NormalIndexes();
+  if (na.size() != va.size())
+    na.clear();
+
+  std::vector<Mesh> meshes(Size());
+#pragma omp parallel
+  {
+    // Maps of the thread
+    std::vector<int> vm(mesh.Vertexes(), -1), nm(na.empty() ? 0 : mesh.Normals(), -1);
+#pragma omp for schedule(dynamic, 1)
+    for (int c = 0; c < Size(); c++)
+    {
+      meshes[c] = Gather(mesh, va, na, Indexes(c), Triangles(c), vm, nm);
+    }
+  }
+  return meshes;
+}
+
+/*!
+\brief Remove small components, such as the debris of a polygonization.
+\param mesh The mesh that was labeled.
+\param n Minimum number of triangles of the kept components.
+\param a Minimum area of the kept components.
+*/
+Mesh MeshComponents::Remove(const Mesh& mesh, int n, double a) const
+{
+  std::vector<int> kept;
+  for (int c = 0; c < Size(); c++)
+  {
+    if (Triangles(c) >= n && areas[c] >= a)
+      kept.push_back(c);
+  }
+  return Extract(mesh, kept);
+}
@@ -0,0 +1,282 @@
+// MeshDistance
+
+#include "meshdistance.h"
+
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+
+/*!
+\class MeshDistance meshdistance.h
+\brief Unsigned and signed distance queries to a triangle mesh.
+
+Closest points are found with a BVH of the triangles. The sign is given by angle weighted pseudo-normals:
+depending on whether the closest point lies inside a face, on an edge or on a vertex, the direction from the closest point
+to the query point is compared with the normal of the face, the sum of the normals of the two faces sharing the edge,
+or the sum of the normals of the faces incident to the vertex weighted by their angle at the vertex.
+The sign is correct for closed manifold meshes with consistently outward oriented triangles.
+
+After J. Andreas Baerentzen and Henrik Aanaes, <I>Signed distance computation using the angle weighted pseudonormal</I>,
+<B>IEEE Transactions on Visualization and Computer Graphics</B>, 11(3):243-253, 2005.
+
+Batch queries process points in parallel.
+*/
+
+/*!
+\brief Create the distance queries of a mesh.
+\param m The mesh.
+*/
+MeshDistance::MeshDistance(const Mesh& m) :mesh(m), bvh(m)
+{
+  const int n = mesh.Triangles();
+
+  faceNormals.resize(n);
+  vertexNormals.assign(mesh.Vertexes(), Vector::Null);
+  edgeNormals.resize(3 * n);
+
+  std::unordered_map<long long, Vector> edges;
+  edges.reserve(3 * n);
+
+  for (int i = 0; i < n; i++)
+  {
+    const Triangle t = mesh.GetTriangle(i);
+    const Vector normal = t.Normal();
+    faceNormals[i] = normal;
+
+    for (int k = 0; k < 3; k++)
+    {
+      // Angle at the vertex
+      Vector a = Normalized(t[(k + 1) % 3] - t[k]);
+      Vector b = Normalized(t[(k + 2) % 3] - t[k]);
+      vertexNormals[mesh.VertexIndex(i, k)] += acos(Math::Clamp(a * b, -1.0, 1.0)) * normal;
+
+      // Edge from vertex k to vertex k+1
+      int ea = mesh.VertexIndex(i, k);
+      int eb = mesh.VertexIndex(i, (k + 1) % 3);
+      long long key = (long long)(std::min(ea, eb)) << 32 | std::max(ea, eb);
+      edges[key] += normal;
+    }
+  }
+
+  for (int i = 0; i < n; i++)
+  {
+    for (int k = 0; k < 3; k++)
+    {
+      int ea = mesh.VertexIndex(i, k);
+      int eb = mesh.VertexIndex(i, (k + 1) % 3);
+      edgeNormals[3 * i + k] = edges[(long long)(std::min(ea, eb)) << 32 | std::max(ea, eb)];
+    }
+  }
+}
+
+/*!
+\brief Compute the pseudo-normal at the closest point.
+\param i Triangle index.
+\param u,v Parametric coordinates of the closest point in the triangle.
+*/
+Vector MeshDistance::PseudoNormal(int i, double u, double v) const
+{
+  const double e = 1.0e-9;
+
+  // Vertices, coordinates are exact
+  if (u == 0.0 && v == 0.0)
+    return vertexNormals[mesh.VertexIndex(i, 0)];
+  if (u == 1.0)
+    return vertexNormals[mesh.VertexIndex(i, 1)];
+  if (v == 1.0)
+    return vertexNormals[mesh.VertexIndex(i, 2)];
+
+  // Edges
+  if (v < e)
+    return edgeNormals[3 * i];
+  if (1.0 - u - v < e)
+    return edgeNormals[3 * i + 1];
+  if (u < e)
+    return edgeNormals[3 * i + 2];
+
+  return faceNormals[i];
+}
+
+/*!
+\brief Compute the closest point of the mesh.
+
+The closest point is Triangle::Vertex(u, v) of the returned triangle.
+\param p Point.
+\param u,v Parametric coordinates of the closest point in the triangle.
+\param d Distance, the largest double if the mesh is empty.
+\return Index of the closest triangle, -1 if the mesh is empty.
+*/
+int MeshDistance::Closest(const Vector& p, double& u, double& v, double& d) const
+{
+  int i = bvh.Closest(p, u, v, d);
+  if (i < 0)
+  {
+    d = std::numeric_limits<double>::max();
+    return -1;
+  }
+
+  // Exact closest point, the hierarchy stores single precision triangles
+  d = Norm(mesh.GetTriangle(i).Closest(p, u, v) - p);
+  return i;
+}
+
+/*!
+\brief Compute the distance to the mesh.
+\param p Point.
+*/
+double MeshDistance::Distance(const Vector& p) const
+{
+  double u, v, d;
+  Closest(p, u, v, d);
+  return d;
+}
+
+/*!
+\brief Compute the signed distance to the mesh, negative inside.
+\param p Point.
+*/
+double MeshDistance::Signed(const Vector& p) const
+{
+  double u, v, d;
+  int i = Closest(p, u, v, d);
+  if (i < 0)
+    return d;
+
+  const Vector q = mesh.GetTriangle(i).Vertex(u, v);
+  return ((p - q) * PseudoNormal(i, u, v) < 0.0) ? -d : d;
+}
+
+/*!
+\brief Compute the gradient of the signed distance.
+
+This is the unit vector from the closest point to the query point, or the pseudo-normal on the surface.
+\param p Point.
+*/
+Vector MeshDistance::Gradient(const Vector& p) const
+{
+  double u, v, d;
+  int i = Closest(p, u, v, d);
+  if (i < 0)
+    return Vector::Null;
+
+  const Vector n = PseudoNormal(i, u, v);
+  if (d < 1.0e-9)
+    return Normalized(n);
+
+  const Vector g = (p - mesh.GetTriangle(i).Vertex(u, v)) / d;
+  return (g * n < 0.0) ? -g : g;
+}
+
+/*!
+\brief Compute the closest points of a set of points, in parallel.
+\param p Points.
+\param t Returned indexes of the closest triangles.
+\param u,v Returned parametric coordinates of the closest points.
+\param d Returned distances.
+*/
+void MeshDistance::Closest(const std::vector<Vector>& p, std::vector<int>& t, std::vector<double>& u, std::vector<double>& v, std::vector<double>& d) const
+{
+  const int n = int(p.size());
+  t.resize(n);
+  u.resize(n);
+  v.resize(n);
+  d.resize(n);
+
+#pragma omp parallel for schedule(dynamic, 64)
+  for (int i = 0; i < n; i++)
+  {
+    t[i] = Closest(p[i], u[i], v[i], d[i]);
+  }
+}
+
+/*!
+\brief Compute the distances of a set of points, in parallel.
+\param p Points.
+*/
+std::vector<double> MeshDistance::Distance(const std::vector<Vector>& p) const
+{
+  const int n = int(p.size());
+  std::vector<double> d(n);
+
+#pragma omp parallel for schedule(dynamic, 64)
+  for (int i = 0; i < n; i++)
+  {
+    d[i] = Distance(p[i]);
+  }
+  return d;
+}
+
+/*!
+\brief Compute the signed distances of a set of points, in parallel.
+\param p Points.
+*/
+std::vector<double> MeshDistance::Signed(const std::vector<Vector>& p) const
+{
+  const int n = int(p.size());
+  std::vector<double> d(n);
+
+#pragma omp parallel for schedule(dynamic, 64)
+  for (int i = 0; i < n; i++)
+  {
+    d[i] = Signed(p[i]);
+  }
+  return d;
+}
+
+/*!
+\class SignedDistanceField meshdistance.h
+\brief The signed distance to a closed triangle mesh as an implicit field.
+
+This converts meshes into implicit surfaces, which can then be remeshed:
+\code
+Mesh mesh;
+mesh.Load("bunny.obj");
+SignedDistanceField field(mesh);
+Mesh remeshed;
+field.Polygonize(128, remeshed, field.GetBox());
+\endcode
+*/
+
+/*!
+\brief Create the signed distance field of a mesh.
+\param mesh The mesh.
+*/
+SignedDistanceField::SignedDistanceField(const Mesh& mesh) :distance(mesh)
+{
+}
+
+/*!
+\brief Compute the signed distance, negative inside.
+\param p Point.
+*/
+double SignedDistanceField::Value(const Vector& p) const
+{
+  return distance.Signed(p);
+}
+
+/*!
+\brief Compute the gradient of the signed distance.
+\param p Point.
+*/
+Vector SignedDistanceField::Gradient(const Vector& p) const
+{
+  return distance.Gradient(p);
+}
+
+/*!
+\brief Return the Lipschitz constant, a distance field is 1-Lipschitz.
+*/
+double SignedDistanceField::K() const
+{
+  return 1.0;
+}
+
+/*!
+\brief Return the box of the mesh, slightly enlarged so that the surface lies strictly inside.
+*/
+Box SignedDistanceField::GetBox() const
+{
+  Box box = distance.GetBox();
+  const Vector r(0.05 * box.Radius());
+  return Box(box[0] - r, box[1] + r);
+}
@@ -0,0 +1,389 @@
+// MeshSlicer
+
+#include "meshslicer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+
+/*!
+\class MeshSlicer meshslicer.h
+\brief Plane cross sections of a triangle mesh.
+
+Vertices are stored as a structure of arrays, so that their signed distances to a plane are computed
+by a vectorized kernel. Vertices on the plane are considered above it, so that every edge crosses the plane at most once,
+and every crossed triangle contributes a single segment. Segments are oriented by the triangles and chained
+into polylines through a hash of the keys of the crossed edges, which also handles inconsistently oriented meshes.
+Non-manifold edges, shared by more than two crossed triangles, join their segments in the order of the chains reaching them.
+
+\code
+MeshSlicer slicer(mesh);
+std::vector<std::vector<Vector>> loops = slicer.Slice(Vector::Null, Vector::Z); // Closed loops end with their first point
+Mesh below, above;
+slicer.Cut(Vector::Null, Vector::Z, below, above);
+\endcode
+*/
+
+// Number of triangles processed by a task
+static const int Block = 1 << 16;
+
+/*!
+\brief Key of an edge, independent of its orientation.
+\param a, b Vertex indexes.
+*/
+static inline uint64_t EdgeKey(int a, int b)
+{
+  return (a < b) ? (uint64_t(a) << 32 | uint64_t(b)) : (uint64_t(b) << 32 | uint64_t(a));
+}
+
+/*!
+\brief Create the slicer.
+\param mesh The mesh.
+*/
+MeshSlicer::MeshSlicer(const Mesh& mesh) :va(mesh.VertexIndexes()), box(mesh.GetBox())
+{
+  const int n = mesh.Vertexes();
+  x.resize(n);
+  y.resize(n);
+  z.resize(n);
+#pragma omp parallel for
+  for (int i = 0; i < n; i++)
+  {
+    const Vector p = mesh.Vertex(i);
+    x[i] = p[0];
+    y[i] = p[1];
+    z[i] = p[2];
+  }
+}
+
+/*!
+\brief Compute the signed distances of the vertices to a plane.
+\param p, n Point and normal of the plane.
+\param d Signed distances.
+\param s Sides, 1 above or on the plane, 0 below.
+*/
+void MeshSlicer::Distances(const Vector& p, const Vector& n, std::vector<double>& d, std::vector<char>& s) const
+{
+  const Vector u = Normalized(n);
+  const double ux = u[0], uy = u[1], uz = u[2];
+  const double c = u * p;
+  const int size = int(x.size());
+
+  d.resize(size);
+  s.resize(size);
+  const double* px = x.data();
+  const double* py = y.data();
+  const double* pz = z.data();
+  double* pd = d.data();
+  char* ps = s.data();
+
+#pragma omp parallel for simd schedule(static)
+  for (int i = 0; i < size; i++)
+  {
+    const double e = ux * px[i] + uy * py[i] + uz * pz[i] - c;
+    pd[i] = e;
+    ps[i] = e >= 0.0;
+  }
+}
+
+/*!
+\brief Compute the intersection between an edge and the plane.
+
+The point does not depend on the orientation of the edge, so that adjacent triangles share it exactly.
+\param a, b Vertex indexes, on opposite sides of the plane.
+\param d Signed distances.
+*/
+Vector MeshSlicer::Crossing(int a, int b, const std::vector<double>& d) const
+{
+  if (a > b)
+    std::swap(a, b);
+  const double t = d[a] / (d[a] - d[b]);
+  return Vector(x[a] + t * (x[b] - x[a]), y[a] + t * (y[b] - y[a]), z[a] + t * (z[b] - z[a]));
+}
+
+/*!
+\brief Compute the cross section of the mesh by a plane.
+
+Polylines follow the orientation of the triangles when it is consistent. Closed loops end with their first point,
+open polylines occur on the boundary of open meshes.
+\param p, n Point and normal of the plane.
+*/
+std::vector<std::vector<Vector>> MeshSlicer::Slice(const Vector& p, const Vector& n) const
+{
+  std::vector<double> d;
+  std::vector<char> s;
+  Distances(p, n, d, s);
+
+  // Segment from the edge leaving to the edge entering the half space above the plane
+  struct Segment
+  {
+    uint64_t a, b; //!< Edge keys.
+    Vector pa, pb; //!< End points.
+  };
+
+  const int triangles = int(va.size() / 3);
+  const int blocks = (triangles + Block - 1) / Block;
+  std::vector<std::vector<Segment>> segments(blocks);
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int k = 0; k < blocks; k++)
+  {
+    for (int t = k * Block; t < std::min(triangles, (k + 1) * Block); t++)
+    {
+      const int* v = &va[3 * t];
+      const int side = s[v[0]] + s[v[1]] + s[v[2]];
+      if (side == 0 || side == 3)
+        continue;
+
+      Segment segment;
+      for (int j = 0; j < 3; j++)
+      {
+        const int a = v[j], b = v[(j + 1) % 3];
+        if (s[a] == s[b])
+          continue;
+        if (s[a] == 0)
+        {
+          segment.b = EdgeKey(a, b);
+          segment.pb = Crossing(a, b, d);
+        }
+        else
+        {
+          segment.a = EdgeKey(a, b);
+          segment.pa = Crossing(a, b, d);
+        }
+      }
+      segments[k].push_back(segment);
+    }
+  }
+
+  // Gather in triangle order
+  std::vector<Segment> all;
+  for (std::vector<Segment>& block : segments)
+  {
+    all.insert(all.end(), block.begin(), block.end());
+  }
+
+  // Hash of the crossed edges with their segments, two for manifold edges and a list for further ones
+  struct Incidence
+  {
+    int s[2] = { -1, -1 }; //!< Segments.
+    int more = -1;         //!< Index of the list of further segments, if any.
+  };
+  std::unordered_map<uint64_t, Incidence> edges;
+  std::vector<std::vector<int>> more;
+  edges.reserve(all.size());
+  for (int i = 0; i < int(all.size()); i++)
+  {
+    for (uint64_t key : { all[i].a, all[i].b })
+    {
+      Incidence& e = edges[key];
+      if (e.s[0] < 0)
+        e.s[0] = i;
+      else if (e.s[1] < 0)
+        e.s[1] = i;
+      else
+      {
+        if (e.more < 0)
+        {
+          e.more = int(more.size());
+          more.emplace_back();
+        }
+        more[e.more].push_back(i);
+      }
+    }
+  }
+
+  // Check if a segment is the only one on an edge
+  auto single = [&](uint64_t key)
+    {
+      return edges[key].s[1] < 0;
+    };
+
+  // Find an unused segment sharing an edge
+  std::vector<bool> used(all.size(), false);
+  auto other = [&](uint64_t key, int i)
+    {
+      const Incidence& e = edges[key];
+      for (int j : e.s)
+      {
+        if (j >= 0 && j != i && !used[j])
+          return j;
+      }
+      if (e.more >= 0)
+      {
+        for (int j : more[e.more])
+        {
+          if (j != i && !used[j])
+            return j;
+        }
+      }
+      return -1;
+    };
+
+  // Chains are followed through shared edges regardless of the orientation of segments, and reversed if needed
+  std::vector<std::vector<Vector>> polylines;
+  auto chain = [&](int i, bool forward)
+    {
+      uint64_t key = forward ? all[i].a : all[i].b;
+      std::vector<Vector> polyline(1, forward ? all[i].pa : all[i].pb);
+      while (i >= 0 && !used[i])
+      {
+        used[i] = true;
+        const bool a = (all[i].a == key);
+        key = a ? all[i].b : all[i].a;
+        polyline.push_back(a ? all[i].pb : all[i].pa);
+        i = other(key, i);
+      }
+      if (!forward)
+        std::reverse(polyline.begin(), polyline.end());
+      polylines.push_back(polyline);
+    };
+
+  // Open polylines first, from the segments with a free end, then closed loops
+  for (int i = 0; i < int(all.size()); i++)
+  {
+    if (used[i])
+      continue;
+    if (single(all[i].a))
+      chain(i, true);
+    else if (single(all[i].b))
+      chain(i, false);
+  }
+  for (int i = 0; i < int(all.size()); i++)
+  {
+    if (!used[i])
+      chain(i, true);
+  }
+
+  return polylines;
+}
+
+/*!
+\brief Create a mesh from a subset of the vertices, keeping only the referenced ones.
+\param vertices Vertices.
+\param indexes Vertex indexes of the triangles.
+*/
+static Mesh Compact(const std::vector<Vector>& vertices, const std::vector<int>& indexes)
+{
+  std::vector<int> map(vertices.size(), -1);
+  std::vector<Vector> v;
+  std::vector<int> vi(indexes.size());
+  for (size_t i = 0; i < indexes.size(); i++)
+  {
+    int& m = map[indexes[i]];
+    if (m < 0)
+    {
+      m = int(v.size());
+      v.push_back(vertices[indexes[i]]);
+    }
+    vi[i] = m;
+  }
+
+  Mesh mesh(v, vi);
+  mesh.SmoothNormals();
+  return mesh;
+}
+
+/*!
+\brief Cut the mesh into two halves by a plane.
+
+Crossed triangles are split along the plane, and both halves share the vertices created on the plane.
+\param p, n Point and normal of the plane.
+\param below, above Returned halves.
+*/
+void MeshSlicer::Cut(const Vector& p, const Vector& n, Mesh& below, Mesh& above) const
+{
+  std::vector<double> d;
+  std::vector<char> s;
+  Distances(p, n, d, s);
+
+  const int triangles = int(va.size() / 3);
+  const int blocks = (triangles + Block - 1) / Block;
+
+  // Classify triangles
+  std::vector<std::vector<int>> side[3];
+  std::vector<std::vector<uint64_t>> keys(blocks);
+  for (int j = 0; j < 3; j++)
+    side[j].resize(blocks);
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int k = 0; k < blocks; k++)
+  {
+    for (int t = k * Block; t < std::min(triangles, (k + 1) * Block); t++)
+    {
+      const int* v = &va[3 * t];
+      const int sum = s[v[0]] + s[v[1]] + s[v[2]];
+      // Below, above, or crossed
+      const int j = (sum == 0) ? 0 : (sum == 3) ? 1 : 2;
+      side[j][k].push_back(t);
+      if (j == 2)
+      {
+        for (int e = 0; e < 3; e++)
+        {
+          if (s[v[e]] != s[v[(e + 1) % 3]])
+            keys[k].push_back(EdgeKey(v[e], v[(e + 1) % 3]));
+        }
+      }
+    }
+  }
+
+  // Vertices created on the plane, indexed after the vertices of the mesh
+  std::vector<uint64_t> crossed;
+  for (const std::vector<uint64_t>& block : keys)
+  {
+    crossed.insert(crossed.end(), block.begin(), block.end());
+  }
+  std::sort(crossed.begin(), crossed.end());
+  crossed.erase(std::unique(crossed.begin(), crossed.end()), crossed.end());
+
+  const int nv = int(x.size());
+  std::vector<Vector> vertices(nv + crossed.size());
+#pragma omp parallel for
+  for (int i = 0; i < nv; i++)
+  {
+    vertices[i] = Vector(x[i], y[i], z[i]);
+  }
+#pragma omp parallel for
+  for (int i = 0; i < int(crossed.size()); i++)
+  {
+    vertices[nv + i] = Crossing(int(crossed[i] >> 32), int(crossed[i] & 0xFFFFFFFF), d);
+  }
+  auto vertex = [&](int a, int b)
+    {
+      return nv + int(std::lower_bound(crossed.begin(), crossed.end(), EdgeKey(a, b)) - crossed.begin());
+    };
+
+  std::vector<int> half[2];
+  for (int j = 0; j < 2; j++)
+  {
+    for (const std::vector<int>& block : side[j])
+    {
+      for (int t : block)
+      {
+        half[j].insert(half[j].end(), va.begin() + 3 * t, va.begin() + 3 * t + 3);
+      }
+    }
+  }
+
+  // Split crossed triangles into a triangle on the side of the single vertex and a quadrangle on the other
+  for (const std::vector<int>& block : side[2])
+  {
+    for (int t : block)
+    {
+      const int* v = &va[3 * t];
+      int k = 0;
+      while (s[v[k]] == s[v[(k + 1) % 3]] || s[v[k]] == s[v[(k + 2) % 3]])
+        k++;
+      const int a = v[k], b = v[(k + 1) % 3], c = v[(k + 2) % 3];
+      const int ab = vertex(a, b), ac = vertex(a, c);
+
+      std::vector<int>& single = half[int(s[a])];
+      std::vector<int>& other = half[1 - int(s[a])];
+      single.insert(single.end(), { a, ab, ac });
+      other.insert(other.end(), { ab, b, c, ab, c, ac });
+    }
+  }
+
+  below = Compact(vertices, half[0]);
+  above = Compact(vertices, half[1]);
+}
@@ -0,0 +1,1081 @@
+// Packet
+
+#include "packet.h"
+
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PACKET_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define PACKET_AVX2
+#else
+#define PACKET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+const float Packet::epsilon = 1.0e-7f;
+const double Packet::Infinity = std::numeric_limits<double>::infinity();
+
+/*!
+\class TrianglePacket packet.h
+\brief A set of triangles stored as a structure of arrays.
+
+Triangles are stored as their first vertex and two edge vectors in single precision,
+which is the layout expected by the Moller-Trumbore kernels of Packet. Arrays are padded
+with degenerate triangles up to a multiple of Packet::Lanes so that kernels never need a scalar tail loop.
+*/
+
+/*!
+\brief Create a packet from a set of triangles.
+\param t Array of triangles.
+*/
+TrianglePacket::TrianglePacket(const std::vector<Triangle>& t)
+{
+  Reserve(int(t.size()));
+  for (int i = 0; i < int(t.size()); i++)
+  {
+    Append(t[i]);
+  }
+}
+
+/*!
+\brief Create a packet with all the triangles of a mesh.
+\param mesh The mesh.
+*/
+TrianglePacket::TrianglePacket(const Mesh& mesh)
+{
+  Reserve(mesh.Triangles());
+  for (int i = 0; i < mesh.Triangles(); i++)
+  {
+    Append(mesh.GetTriangle(i));
+  }
+}
+
+/*!
+\brief Reserve memory for a given number of triangles.
+\param size Number of triangles.
+*/
+void TrianglePacket::Reserve(int size)
+{
+  size = (size + Packet::Lanes - 1) & ~(Packet::Lanes - 1);
+  for (int k = 0; k < 3; k++)
+  {
+    p[k].reserve(size);
+  }
+  for (int k = 0; k < 6; k++)
+  {
+    e[k].reserve(size);
+  }
+}
+
+/*!
+\brief Add a triangle to the packet.
+\param t The triangle.
+*/
+void TrianglePacket::Append(const Triangle& t)
+{
+  // Grow by a full block of degenerate triangles
+  if (n % Packet::Lanes == 0)
+  {
+    for (int k = 0; k < 3; k++)
+    {
+      p[k].resize(n + Packet::Lanes, 0.0f);
+    }
+    for (int k = 0; k < 6; k++)
+    {
+      e[k].resize(n + Packet::Lanes, 0.0f);
+    }
+  }
+
+  Vector e1 = t[1] - t[0];
+  Vector e2 = t[2] - t[0];
+  for (int k = 0; k < 3; k++)
+  {
+    p[k][n] = float(t[0][k]);
+    e[k][n] = float(e1[k]);
+    e[k + 3][n] = float(e2[k]);
+  }
+  n++;
+}
+
+/*!
+\brief Remove all triangles.
+*/
+void TrianglePacket::Clear()
+{
+  n = 0;
+  for (int k = 0; k < 3; k++)
+  {
+    p[k].clear();
+  }
+  for (int k = 0; k < 6; k++)
+  {
+    e[k].clear();
+  }
+}
+
+/*!
+\class RayPacket packet.h
+\brief A set of rays stored as a structure of arrays.
+
+The inverse of the direction is stored along with the direction for slab tests against boxes.
+*/
+
+/*!
+\brief Create a packet from a set of rays.
+\param r Array of rays.
+*/
+RayPacket::RayPacket(const std::vector<Ray>& r)
+{
+  Reserve(int(r.size()));
+  for (int i = 0; i < int(r.size()); i++)
+  {
+    Append(r[i]);
+  }
+}
+
+/*!
+\brief Reserve memory for a given number of rays.
+\param size Number of rays.
+*/
+void RayPacket::Reserve(int size)
+{
+  size = (size + Packet::Lanes - 1) & ~(Packet::Lanes - 1);
+  for (int k = 0; k < 3; k++)
+  {
+    o[k].reserve(size);
+    d[k].reserve(size);
+    inv[k].reserve(size);
+  }
+}
+
+/*!
+\brief Add a ray to the packet.
+\param ray The ray.
+*/
+void RayPacket::Append(const Ray& ray)
+{
+  if (n % Packet::Lanes == 0)
+  {
+    for (int k = 0; k < 3; k++)
+    {
+      o[k].resize(n + Packet::Lanes, 0.0f);
+      d[k].resize(n + Packet::Lanes, 0.0f);
+      inv[k].resize(n + Packet::Lanes, 0.0f);
+    }
+  }
+
+  for (int k = 0; k < 3; k++)
+  {
+    o[k][n] = float(ray.Origin()[k]);
+    d[k][n] = float(ray.Direction()[k]);
+    inv[k][n] = 1.0f / float(ray.Direction()[k]);
+  }
+  n++;
+}
+
+/*!
+\brief Remove all rays.
+*/
+void RayPacket::Clear()
+{
+  n = 0;
+  for (int k = 0; k < 3; k++)
+  {
+    o[k].clear();
+    d[k].clear();
+    inv[k].clear();
+  }
+}
+
+/*!
+\class BoxPacket packet.h
+\brief A set of axis aligned boxes stored as a structure of arrays.
+
+Boxes are slightly enlarged by Box::epsilon so that slab tests against flat boxes,
+such as the bounding box of an axis aligned triangle, remain robust.
+*/
+
+/*!
+\brief Create a packet from a set of boxes.
+\param boxes Array of boxes.
+*/
+BoxPacket::BoxPacket(const std::vector<Box>& boxes)
+{
+  Reserve(int(boxes.size()));
+  for (int i = 0; i < int(boxes.size()); i++)
+  {
+    Append(boxes[i]);
+  }
+}
+
+/*!
+\brief Reserve memory for a given number of boxes.
+\param size Number of boxes.
+*/
+void BoxPacket::Reserve(int size)
+{
+  size = (size + Packet::Lanes - 1) & ~(Packet::Lanes - 1);
+  for (int k = 0; k < 3; k++)
+  {
+    a[k].reserve(size);
+    b[k].reserve(size);
+  }
+}
+
+/*!
+\brief Add a box to the packet.
+\param box The box.
+*/
+void BoxPacket::Append(const Box& box)
+{
+  if (n % Packet::Lanes == 0)
+  {
+    for (int k = 0; k < 3; k++)
+    {
+      a[k].resize(n + Packet::Lanes, 0.0f);
+      b[k].resize(n + Packet::Lanes, 0.0f);
+    }
+  }
+
+  for (int k = 0; k < 3; k++)
+  {
+    a[k][n] = float(box[0][k] - Box::epsilon);
+    b[k][n] = float(box[1][k] + Box::epsilon);
+  }
+  n++;
+}
+
+/*!
+\brief Remove all boxes.
+*/
+void BoxPacket::Clear()
+{
+  n = 0;
+  for (int k = 0; k < 3; k++)
+  {
+    a[k].clear();
+    b[k].clear();
+  }
+}
+
+/*!
+\class Packet packet.h
+\brief Ray intersection kernels processing several triangles, rays or boxes at once.
+
+Kernels are provided for scalar code, SSE (4 lanes) and AVX2 (8 lanes) in single precision.
+The widest instruction set supported by the processor is selected at runtime the first time
+a kernel is called, so that the same binary runs on any x86 machine:
+
+\code
+TrianglePacket triangles(mesh);
+double t, u, v;
+int i = Packet::Intersect(ray, triangles, t, u, v); // Index of the closest triangle, or -1
+\endcode
+
+Results are single precision: when full accuracy is needed, the hit should be refined with Triangle::Intersect().
+*/
+
+// Kernel table
+struct PacketKernels
+{
+  Packet::Isa isa;
+  int width;
+  int (*rayTriangles)(const float*, const float*, const TrianglePacket&, int, int, float&, float&, float&);
+  int (*raysTriangle)(const RayPacket&, const float*, const float*, const float*, float*, float*, float*);
+  int (*raysBoxes)(const RayPacket&, const BoxPacket&, int, float*, float*);
+  int (*rayBoxes)(const float*, const float*, const BoxPacket&, float, float*);
+};
+
+// Scalar kernels
+
+static int RayTrianglesScalar(const float* o, const float* d, const TrianglePacket& tp, int first, int last, float& t, float& u, float& v)
+{
+  const float* px = tp.Origin(0), * py = tp.Origin(1), * pz = tp.Origin(2);
+  const float* ax = tp.Edge(0), * ay = tp.Edge(1), * az = tp.Edge(2);
+  const float* bx = tp.Edge(3), * by = tp.Edge(4), * bz = tp.Edge(5);
+
+  int hit = -1;
+  for (int i = first; i < last; i++)
+  {
+    // Moller-Trumbore, see Triangle::Intersect()
+    float qx = d[1] * bz[i] - d[2] * by[i];
+    float qy = d[2] * bx[i] - d[0] * bz[i];
+    float qz = d[0] * by[i] - d[1] * bx[i];
+    float det = ax[i] * qx + ay[i] * qy + az[i] * qz;
+    if ((det > -Packet::epsilon) && (det < Packet::epsilon))
+      continue;
+    float inv = 1.0f / det;
+
+    float sx = o[0] - px[i], sy = o[1] - py[i], sz = o[2] - pz[i];
+    float uu = (sx * qx + sy * qy + sz * qz) * inv;
+    if ((uu < 0.0f) || (uu > 1.0f))
+      continue;
+
+    float rx = sy * az[i] - sz * ay[i];
+    float ry = sz * ax[i] - sx * az[i];
+    float rz = sx * ay[i] - sy * ax[i];
+    float vv = (d[0] * rx + d[1] * ry + d[2] * rz) * inv;
+    if ((vv < 0.0f) || (uu + vv > 1.0f))
+      continue;
+
+    float tt = (bx[i] * rx + by[i] * ry + bz[i] * rz) * inv;
+    if ((tt > 0.0f) && (tt < t))
+    {
+      t = tt;
+      u = uu;
+      v = vv;
+      hit = i;
+    }
+  }
+  return hit;
+}
+
+static int RaysTriangleScalar(const RayPacket& rp, const float* p, const float* a, const float* b, float* t, float* u, float* v)
+{
+  const float* ox = rp.Origin(0), * oy = rp.Origin(1), * oz = rp.Origin(2);
+  const float* dx = rp.Direction(0), * dy = rp.Direction(1), * dz = rp.Direction(2);
+
+  int hits = 0;
+  for (int i = 0; i < rp.Size(); i++)
+  {
+    t[i] = float(Packet::Infinity);
+
+    float qx = dy[i] * b[2] - dz[i] * b[1];
+    float qy = dz[i] * b[0] - dx[i] * b[2];
+    float qz = dx[i] * b[1] - dy[i] * b[0];
+    float det = a[0] * qx + a[1] * qy + a[2] * qz;
+    if ((det > -Packet::epsilon) && (det < Packet::epsilon))
+      continue;
+    float inv = 1.0f / det;
+
+    float sx = ox[i] - p[0], sy = oy[i] - p[1], sz = oz[i] - p[2];
+    float uu = (sx * qx + sy * qy + sz * qz) * inv;
+    if ((uu < 0.0f) || (uu > 1.0f))
+      continue;
+
+    float rx = sy * a[2] - sz * a[1];
+    float ry = sz * a[0] - sx * a[2];
+    float rz = sx * a[1] - sy * a[0];
+    float vv = (dx[i] * rx + dy[i] * ry + dz[i] * rz) * inv;
+    if ((vv < 0.0f) || (uu + vv > 1.0f))
+      continue;
+
+    float tt = (b[0] * rx + b[1] * ry + b[2] * rz) * inv;
+    if (tt > 0.0f)
+    {
+      t[i] = tt;
+      u[i] = uu;
+      v[i] = vv;
+      hits++;
+    }
+  }
+  return hits;
+}
+
+static int RaysBoxesScalar(const RayPacket& rp, const BoxPacket& bp, int n, float* tn, float* tf)
+{
+  int hits = 0;
+  for (int i = 0; i < n; i++)
+  {
+    float t0 = 0.0f;
+    float t1 = float(Packet::Infinity);
+    for (int k = 0; k < 3; k++)
+    {
+      float ta = (bp.Lower(k)[i] - rp.Origin(k)[i]) * rp.InverseDirection(k)[i];
+      float tb = (bp.Upper(k)[i] - rp.Origin(k)[i]) * rp.InverseDirection(k)[i];
+      t0 = Math::Max(t0, Math::Min(ta, tb));
+      t1 = Math::Min(t1, Math::Max(ta, tb));
+    }
+    if (t0 <= t1)
+    {
+      tn[i] = t0;
+      tf[i] = t1;
+      hits++;
+    }
+    else
+    {
+      tn[i] = tf[i] = float(Packet::Infinity);
+    }
+  }
+  return hits;
+}
+
+static int RayBoxesScalar(const float* o, const float* inv, const BoxPacket& bp, float tmax, float* tn)
+{
+  int hits = 0;
+  for (int i = 0; i < bp.Size(); i++)
+  {
+    float t0 = 0.0f;
+    float t1 = tmax;
+    for (int k = 0; k < 3; k++)
+    {
+      float ta = (bp.Lower(k)[i] - o[k]) * inv[k];
+      float tb = (bp.Upper(k)[i] - o[k]) * inv[k];
+      t0 = Math::Max(t0, Math::Min(ta, tb));
+      t1 = Math::Min(t1, Math::Max(ta, tb));
+    }
+    tn[i] = (t0 <= t1) ? t0 : float(Packet::Infinity);
+    hits += (t0 <= t1);
+  }
+  return hits;
+}
+
+static const PacketKernels ScalarKernels = { Packet::Isa::Scalar, 1, RayTrianglesScalar, RaysTriangleScalar, RaysBoxesScalar, RayBoxesScalar };
+
+#ifdef PACKET_X86
+
+// SSE kernels, 4 lanes
+
+static int RayTrianglesSSE(const float* o, const float* d, const TrianglePacket& tp, int first, int last, float& t, float& u, float& v)
+{
+  const __m128 dx = _mm_set1_ps(d[0]), dy = _mm_set1_ps(d[1]), dz = _mm_set1_ps(d[2]);
+  const __m128 ox = _mm_set1_ps(o[0]), oy = _mm_set1_ps(o[1]), oz = _mm_set1_ps(o[2]);
+  const __m128 eps = _mm_set1_ps(Packet::epsilon);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 sign = _mm_set1_ps(-0.0f);
+
+  __m128 bestt = _mm_set1_ps(t);
+  __m128 bestu = zero, bestv = zero;
+  __m128i besti = _mm_set1_epi32(-1);
+  const __m128i lower = _mm_set1_epi32(first - 1);
+  const __m128i upper = _mm_set1_epi32(last);
+  const __m128i step = _mm_set1_epi32(4);
+
+  // Start on a register boundary so that loads stay in the padded arrays
+  const int start = first & ~3;
+  __m128i index = _mm_add_epi32(_mm_set1_epi32(start), _mm_setr_epi32(0, 1, 2, 3));
+  for (int i = start; i < last; i += 4)
+  {
+    __m128 ax = _mm_loadu_ps(tp.Edge(0) + i), ay = _mm_loadu_ps(tp.Edge(1) + i), az = _mm_loadu_ps(tp.Edge(2) + i);
+    __m128 bx = _mm_loadu_ps(tp.Edge(3) + i), by = _mm_loadu_ps(tp.Edge(4) + i), bz = _mm_loadu_ps(tp.Edge(5) + i);
+
+    __m128 qx = _mm_sub_ps(_mm_mul_ps(dy, bz), _mm_mul_ps(dz, by));
+    __m128 qy = _mm_sub_ps(_mm_mul_ps(dz, bx), _mm_mul_ps(dx, bz));
+    __m128 qz = _mm_sub_ps(_mm_mul_ps(dx, by), _mm_mul_ps(dy, bx));
+    __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, qx), _mm_mul_ps(ay, qy)), _mm_mul_ps(az, qz));
+    __m128 mask = _mm_cmpgt_ps(_mm_andnot_ps(sign, det), eps);
+    __m128i range = _mm_and_si128(_mm_cmpgt_epi32(index, lower), _mm_cmplt_epi32(index, upper));
+    mask = _mm_and_ps(mask, _mm_castsi128_ps(range));
+    __m128 inv = _mm_div_ps(one, det);
+
+    __m128 sx = _mm_sub_ps(ox, _mm_loadu_ps(tp.Origin(0) + i));
+    __m128 sy = _mm_sub_ps(oy, _mm_loadu_ps(tp.Origin(1) + i));
+    __m128 sz = _mm_sub_ps(oz, _mm_loadu_ps(tp.Origin(2) + i));
+    __m128 uu = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, qx), _mm_mul_ps(sy, qy)), _mm_mul_ps(sz, qz)), inv);
+
+    __m128 rx = _mm_sub_ps(_mm_mul_ps(sy, az), _mm_mul_ps(sz, ay));
+    __m128 ry = _mm_sub_ps(_mm_mul_ps(sz, ax), _mm_mul_ps(sx, az));
+    __m128 rz = _mm_sub_ps(_mm_mul_ps(sx, ay), _mm_mul_ps(sy, ax));
+    __m128 vv = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, rx), _mm_mul_ps(dy, ry)), _mm_mul_ps(dz, rz)), inv);
+    __m128 tt = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(bx, rx), _mm_mul_ps(by, ry)), _mm_mul_ps(bz, rz)), inv);
+
+    mask = _mm_and_ps(mask, _mm_cmpge_ps(uu, zero));
+    mask = _mm_and_ps(mask, _mm_cmpge_ps(vv, zero));
+    mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(uu, vv), one));
+    mask = _mm_and_ps(mask, _mm_cmpgt_ps(tt, zero));
+    mask = _mm_and_ps(mask, _mm_cmplt_ps(tt, bestt));
+
+    if (_mm_movemask_ps(mask) != 0)
+    {
+      bestt = _mm_or_ps(_mm_and_ps(mask, tt), _mm_andnot_ps(mask, bestt));
+      bestu = _mm_or_ps(_mm_and_ps(mask, uu), _mm_andnot_ps(mask, bestu));
+      bestv = _mm_or_ps(_mm_and_ps(mask, vv), _mm_andnot_ps(mask, bestv));
+      __m128i m = _mm_castps_si128(mask);
+      besti = _mm_or_si128(_mm_and_si128(m, index), _mm_andnot_si128(m, besti));
+    }
+    index = _mm_add_epi32(index, step);
+  }
+
+  // Reduce lanes
+  alignas(16) float lt[4], lu[4], lv[4];
+  alignas(16) int li[4];
+  _mm_store_ps(lt, bestt);
+  _mm_store_ps(lu, bestu);
+  _mm_store_ps(lv, bestv);
+  _mm_store_si128((__m128i*)li, besti);
+  int hit = -1;
+  for (int k = 0; k < 4; k++)
+  {
+    if ((li[k] >= 0) && (lt[k] < t))
+    {
+      t = lt[k];
+      u = lu[k];
+      v = lv[k];
+      hit = li[k];
+    }
+  }
+  return hit;
+}
+
+static int RaysTriangleSSE(const RayPacket& rp, const float* p, const float* a, const float* b, float* t, float* u, float* v)
+{
+  const __m128 ax = _mm_set1_ps(a[0]), ay = _mm_set1_ps(a[1]), az = _mm_set1_ps(a[2]);
+  const __m128 bx = _mm_set1_ps(b[0]), by = _mm_set1_ps(b[1]), bz = _mm_set1_ps(b[2]);
+  const __m128 px = _mm_set1_ps(p[0]), py = _mm_set1_ps(p[1]), pz = _mm_set1_ps(p[2]);
+  const __m128 eps = _mm_set1_ps(Packet::epsilon);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 sign = _mm_set1_ps(-0.0f);
+  const __m128 miss = _mm_set1_ps(float(Packet::Infinity));
+
+  int hits = 0;
+  for (int i = 0; i < rp.Size(); i += 4)
+  {
+    __m128 dx = _mm_loadu_ps(rp.Direction(0) + i), dy = _mm_loadu_ps(rp.Direction(1) + i), dz = _mm_loadu_ps(rp.Direction(2) + i);
+
+    __m128 qx = _mm_sub_ps(_mm_mul_ps(dy, bz), _mm_mul_ps(dz, by));
+    __m128 qy = _mm_sub_ps(_mm_mul_ps(dz, bx), _mm_mul_ps(dx, bz));
+    __m128 qz = _mm_sub_ps(_mm_mul_ps(dx, by), _mm_mul_ps(dy, bx));
+    __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, qx), _mm_mul_ps(ay, qy)), _mm_mul_ps(az, qz));
+    __m128 mask = _mm_cmpgt_ps(_mm_andnot_ps(sign, det), eps);
+    __m128 inv = _mm_div_ps(one, det);
+
+    __m128 sx = _mm_sub_ps(_mm_loadu_ps(rp.Origin(0) + i), px);
+    __m128 sy = _mm_sub_ps(_mm_loadu_ps(rp.Origin(1) + i), py);
+    __m128 sz = _mm_sub_ps(_mm_loadu_ps(rp.Origin(2) + i), pz);
+    __m128 uu = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, qx), _mm_mul_ps(sy, qy)), _mm_mul_ps(sz, qz)), inv);
+
+    __m128 rx = _mm_sub_ps(_mm_mul_ps(sy, az), _mm_mul_ps(sz, ay));
+    __m128 ry = _mm_sub_ps(_mm_mul_ps(sz, ax), _mm_mul_ps(sx, az));
+    __m128 rz = _mm_sub_ps(_mm_mul_ps(sx, ay), _mm_mul_ps(sy, ax));
+    __m128 vv = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, rx), _mm_mul_ps(dy, ry)), _mm_mul_ps(dz, rz)), inv);
+    __m128 tt = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(bx, rx), _mm_mul_ps(by, ry)), _mm_mul_ps(bz, rz)), inv);
+
+    mask = _mm_and_ps(mask, _mm_cmpge_ps(uu, zero));
+    mask = _mm_and_ps(mask, _mm_cmpge_ps(vv, zero));
+    mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(uu, vv), one));
+    mask = _mm_and_ps(mask, _mm_cmpgt_ps(tt, zero));
+    tt = _mm_or_ps(_mm_and_ps(mask, tt), _mm_andnot_ps(mask, miss));
+
+    // Padded lanes are not written
+    alignas(16) float lt[4], lu[4], lv[4];
+    _mm_store_ps(lt, tt);
+    _mm_store_ps(lu, uu);
+    _mm_store_ps(lv, vv);
+    int bits = _mm_movemask_ps(mask);
+    for (int k = 0; k < 4 && i + k < rp.Size(); k++)
+    {
+      t[i + k] = lt[k];
+      u[i + k] = lu[k];
+      v[i + k] = lv[k];
+      hits += (bits >> k) & 1;
+    }
+  }
+  return hits;
+}
+
+static int RaysBoxesSSE(const RayPacket& rp, const BoxPacket& bp, int n, float* tn, float* tf)
+{
+  const __m128 miss = _mm_set1_ps(float(Packet::Infinity));
+
+  int hits = 0;
+  for (int i = 0; i < n; i += 4)
+  {
+    __m128 t0 = _mm_setzero_ps();
+    __m128 t1 = miss;
+    for (int k = 0; k < 3; k++)
+    {
+      __m128 o = _mm_loadu_ps(rp.Origin(k) + i);
+      __m128 inv = _mm_loadu_ps(rp.InverseDirection(k) + i);
+      __m128 ta = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(bp.Lower(k) + i), o), inv);
+      __m128 tb = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(bp.Upper(k) + i), o), inv);
+      t0 = _mm_max_ps(t0, _mm_min_ps(ta, tb));
+      t1 = _mm_min_ps(t1, _mm_max_ps(ta, tb));
+    }
+    __m128 mask = _mm_cmple_ps(t0, t1);
+    t0 = _mm_or_ps(_mm_and_ps(mask, t0), _mm_andnot_ps(mask, miss));
+    t1 = _mm_or_ps(_mm_and_ps(mask, t1), _mm_andnot_ps(mask, miss));
+
+    alignas(16) float l0[4], l1[4];
+    _mm_store_ps(l0, t0);
+    _mm_store_ps(l1, t1);
+    int bits = _mm_movemask_ps(mask);
+    for (int k = 0; k < 4 && i + k < n; k++)
+    {
+      tn[i + k] = l0[k];
+      tf[i + k] = l1[k];
+      hits += (bits >> k) & 1;
+    }
+  }
+  return hits;
+}
+
+static int RayBoxesSSE(const float* o, const float* inv, const BoxPacket& bp, float tmax, float* tn)
+{
+  const __m128 miss = _mm_set1_ps(float(Packet::Infinity));
+  const __m128 tfar = _mm_set1_ps(tmax);
+  __m128 ro[3], ri[3];
+  for (int k = 0; k < 3; k++)
+  {
+    ro[k] = _mm_set1_ps(o[k]);
+    ri[k] = _mm_set1_ps(inv[k]);
+  }
+
+  int hits = 0;
+  for (int i = 0; i < bp.Size(); i += 4)
+  {
+    __m128 t0 = _mm_setzero_ps();
+    __m128 t1 = tfar;
+    for (int k = 0; k < 3; k++)
+    {
+      __m128 ta = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(bp.Lower(k) + i), ro[k]), ri[k]);
+      __m128 tb = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(bp.Upper(k) + i), ro[k]), ri[k]);
+      t0 = _mm_max_ps(t0, _mm_min_ps(ta, tb));
+      t1 = _mm_min_ps(t1, _mm_max_ps(ta, tb));
+    }
+    __m128 mask = _mm_cmple_ps(t0, t1);
+    t0 = _mm_or_ps(_mm_and_ps(mask, t0), _mm_andnot_ps(mask, miss));
+
+    alignas(16) float l0[4];
+    _mm_store_ps(l0, t0);
+    int bits = _mm_movemask_ps(mask);
+    for (int k = 0; k < 4 && i + k < bp.Size(); k++)
+    {
+      tn[i + k] = l0[k];
+      hits += (bits >> k) & 1;
+    }
+  }
+  return hits;
+}
+
+static const PacketKernels SSEKernels = { Packet::Isa::SSE, 4, RayTrianglesSSE, RaysTriangleSSE, RaysBoxesSSE, RayBoxesSSE };
+
+// AVX2 kernels, 8 lanes
+
+PACKET_AVX2 static inline __m256 Cross8(__m256 ay, __m256 az, __m256 by, __m256 bz)
+{
+  return _mm256_fmsub_ps(ay, bz, _mm256_mul_ps(az, by));
+}
+
+PACKET_AVX2 static inline __m256 Dot8(__m256 ax, __m256 ay, __m256 az, __m256 bx, __m256 by, __m256 bz)
+{
+  return _mm256_fmadd_ps(ax, bx, _mm256_fmadd_ps(ay, by, _mm256_mul_ps(az, bz)));
+}
+
+PACKET_AVX2 static int RayTrianglesAVX2(const float* o, const float* d, const TrianglePacket& tp, int first, int last, float& t, float& u, float& v)
+{
+  const __m256 dx = _mm256_set1_ps(d[0]), dy = _mm256_set1_ps(d[1]), dz = _mm256_set1_ps(d[2]);
+  const __m256 ox = _mm256_set1_ps(o[0]), oy = _mm256_set1_ps(o[1]), oz = _mm256_set1_ps(o[2]);
+  const __m256 eps = _mm256_set1_ps(Packet::epsilon);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 sign = _mm256_set1_ps(-0.0f);
+
+  __m256 bestt = _mm256_set1_ps(t);
+  __m256 bestu = zero, bestv = zero;
+  __m256i besti = _mm256_set1_epi32(-1);
+  const __m256i lower = _mm256_set1_epi32(first - 1);
+  const __m256i upper = _mm256_set1_epi32(last);
+  const __m256i step = _mm256_set1_epi32(8);
+
+  const int start = first & ~7;
+  __m256i index = _mm256_add_epi32(_mm256_set1_epi32(start), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+  for (int i = start; i < last; i += 8)
+  {
+    __m256 ax = _mm256_loadu_ps(tp.Edge(0) + i), ay = _mm256_loadu_ps(tp.Edge(1) + i), az = _mm256_loadu_ps(tp.Edge(2) + i);
+    __m256 bx = _mm256_loadu_ps(tp.Edge(3) + i), by = _mm256_loadu_ps(tp.Edge(4) + i), bz = _mm256_loadu_ps(tp.Edge(5) + i);
+
+    __m256 qx = Cross8(dy, dz, by, bz);
+    __m256 qy = Cross8(dz, dx, bz, bx);
+    __m256 qz = Cross8(dx, dy, bx, by);
+    __m256 det = Dot8(ax, ay, az, qx, qy, qz);
+    __m256 mask = _mm256_cmp_ps(_mm256_andnot_ps(sign, det), eps, _CMP_GT_OQ);
+    __m256i range = _mm256_and_si256(_mm256_cmpgt_epi32(index, lower), _mm256_cmpgt_epi32(upper, index));
+    mask = _mm256_and_ps(mask, _mm256_castsi256_ps(range));
+    __m256 inv = _mm256_div_ps(one, det);
+
+    __m256 sx = _mm256_sub_ps(ox, _mm256_loadu_ps(tp.Origin(0) + i));
+    __m256 sy = _mm256_sub_ps(oy, _mm256_loadu_ps(tp.Origin(1) + i));
+    __m256 sz = _mm256_sub_ps(oz, _mm256_loadu_ps(tp.Origin(2) + i));
+    __m256 uu = _mm256_mul_ps(Dot8(sx, sy, sz, qx, qy, qz), inv);
+
+    __m256 rx = Cross8(sy, sz, ay, az);
+    __m256 ry = Cross8(sz, sx, az, ax);
+    __m256 rz = Cross8(sx, sy, ax, ay);
+    __m256 vv = _mm256_mul_ps(Dot8(dx, dy, dz, rx, ry, rz), inv);
+    __m256 tt = _mm256_mul_ps(Dot8(bx, by, bz, rx, ry, rz), inv);
+
+    mask = _mm256_and_ps(mask, _mm256_cmp_ps(uu, zero, _CMP_GE_OQ));
+    mask = _mm256_and_ps(mask, _mm256_cmp_ps(vv, zero, _CMP_GE_OQ));
+    mask = _mm256_and_ps(mask, _mm256_cmp_ps(_mm256_add_ps(uu, vv), one, _CMP_LE_OQ));
+    mask = _mm256_and_ps(mask, _mm256_cmp_ps(tt, zero, _CMP_GT_OQ));
+    mask = _mm256_and_ps(mask, _mm256_cmp_ps(tt, bestt, _CMP_LT_OQ));
+
+    if (_mm256_movemask_ps(mask) != 0)
+    {
+      bestt = _mm256_blendv_ps(bestt, tt, mask);
+      bestu = _mm256_blendv_ps(bestu, uu, mask);
+      bestv = _mm256_blendv_ps(bestv, vv, mask);
+      besti = _mm256_blendv_epi8(besti, index, _mm256_castps_si256(mask));
+    }
+    index = _mm256_add_epi32(index, step);
+  }
+
+  // Reduce lanes
+  alignas(32) float lt[8], lu[8], lv[8];
+  alignas(32) int li[8];
+  _mm256_store_ps(lt, bestt);
+  _mm256_store_ps(lu, bestu);
+  _mm256_store_ps(lv, bestv);
+  _mm256_store_si256((__m256i*)li, besti);
+  int hit = -1;
+  for (int k = 0; k < 8; k++)
+  {
+    if ((li[k] >= 0) && (lt[k] < t))
+    {
+      t = lt[k];
+      u = lu[k];
+      v = lv[k];
+      hit = li[k];
+    }
+  }
+  return hit;
+}
+
+PACKET_AVX2 static int RaysTriangleAVX2(const RayPacket& rp, const float* p, const float* a, const float* b, float* t, float* u, float* v)
+{
+  const __m256 ax = _mm256_set1_ps(a[0]), ay = _mm256_set1_ps(a[1]), az = _mm256_set1_ps(a[2]);
+  const __m256 bx = _mm256_set1_ps(b[0]), by = _mm256_set1_ps(b[1]), bz = _mm256_set1_ps(b[2]);
+  const __m256 px = _mm256_set1_ps(p[0]), py = _mm256_set1_ps(p[1]), pz = _mm256_set1_ps(p[2]);
+  const __m256 eps = _mm256_set1_ps(Packet::epsilon);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 sign = _mm256_set1_ps(-0.0f);
+  const __m256 miss = _mm256_set1_ps(float(Packet::Infinity));
+
+  int hits = 0;
+  for (int i = 0; i < rp.Size(); i += 8)
+  {
+    __m256 dx = _mm256_loadu_ps(rp.Direction(0) + i), dy = _mm256_loadu_ps(rp.Direction(1) + i), dz = _mm256_loadu_ps(rp.Direction(2) + i);
+
+    __m256 qx = Cross8(dy, dz, by, bz);
+    __m256 qy = Cross8(dz, dx, bz, bx);
+    __m256 qz = Cross8(dx, dy, bx, by);
+    __m256 det = Dot8(ax, ay, az, qx, qy, qz);
+    __m256 mask = _mm256_cmp_ps(_mm256_andnot_ps(sign, det), eps, _CMP_GT_OQ);
+    __m256 inv = _mm256_div_ps(one, det);
+
+    __m256 sx = _mm256_sub_ps(_mm256_loadu_ps(rp.Origin(0) + i), px);
+    __m256 sy = _mm256_sub_ps(_mm256_loadu_ps(rp.Origin(1) + i), py);
+    __m256 sz = _mm256_sub_ps(_mm256_loadu_ps(rp.Origin(2) + i), pz);
+    __m256 uu = _mm256_mul_ps(Dot8(sx, sy, sz, qx, qy, qz), inv);
+
+    __m256 rx = Cross8(sy, sz, ay, az);
+    __m256 ry = Cross8(sz, sx, az, ax);
+    __m256 rz = Cross8(sx, sy, ax, ay);
+    __m256 vv = _mm256_mul_ps(Dot8(dx, dy, dz, rx, ry, rz), inv);
+    __m256 tt = _mm256_mul_ps(Dot8(bx, by, bz, rx, ry, rz), inv);
+
+    mask = _mm256_and_ps(mask, _mm256_cmp_ps(uu, zero, _CMP_GE_OQ));
+    mask = _mm256_and_ps(mask, _mm256_cmp_ps(vv, zero, _CMP_GE_OQ));
+    mask = _mm256_and_ps(mask, _mm256_cmp_ps(_mm256_add_ps(uu, vv), one, _CMP_LE_OQ));
+    mask = _mm256_and_ps(mask, _mm256_cmp_ps(tt, zero, _CMP_GT_OQ));
+    tt = _mm256_blendv_ps(miss, tt, mask);
+
+    alignas(32) float lt[8], lu[8], lv[8];
+    _mm256_store_ps(lt, tt);
+    _mm256_store_ps(lu, uu);
+    _mm256_store_ps(lv, vv);
+    int bits = _mm256_movemask_ps(mask);
+    for (int k = 0; k < 8 && i + k < rp.Size(); k++)
+    {
+      t[i + k] = lt[k];
+      u[i + k] = lu[k];
+      v[i + k] = lv[k];
+      hits += (bits >> k) & 1;
+    }
+  }
+  return hits;
+}
+
+PACKET_AVX2 static int RaysBoxesAVX2(const RayPacket& rp, const BoxPacket& bp, int n, float* tn, float* tf)
+{
+  const __m256 miss = _mm256_set1_ps(float(Packet::Infinity));
+
+  int hits = 0;
+  for (int i = 0; i < n; i += 8)
+  {
+    __m256 t0 = _mm256_setzero_ps();
+    __m256 t1 = miss;
+    for (int k = 0; k < 3; k++)
+    {
+      __m256 o = _mm256_loadu_ps(rp.Origin(k) + i);
+      __m256 inv = _mm256_loadu_ps(rp.InverseDirection(k) + i);
+      __m256 ta = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(bp.Lower(k) + i), o), inv);
+      __m256 tb = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(bp.Upper(k) + i), o), inv);
+      t0 = _mm256_max_ps(t0, _mm256_min_ps(ta, tb));
+      t1 = _mm256_min_ps(t1, _mm256_max_ps(ta, tb));
+    }
+    __m256 mask = _mm256_cmp_ps(t0, t1, _CMP_LE_OQ);
+    t0 = _mm256_blendv_ps(miss, t0, mask);
+    t1 = _mm256_blendv_ps(miss, t1, mask);
+
+    alignas(32) float l0[8], l1[8];
+    _mm256_store_ps(l0, t0);
+    _mm256_store_ps(l1, t1);
+    int bits = _mm256_movemask_ps(mask);
+    for (int k = 0; k < 8 && i + k < n; k++)
+    {
+      tn[i + k] = l0[k];
+      tf[i + k] = l1[k];
+      hits += (bits >> k) & 1;
+    }
+  }
+  return hits;
+}
+
+PACKET_AVX2 static int RayBoxesAVX2(const float* o, const float* inv, const BoxPacket& bp, float tmax, float* tn)
+{
+  const __m256 miss = _mm256_set1_ps(float(Packet::Infinity));
+  const __m256 tfar = _mm256_set1_ps(tmax);
+  __m256 ro[3], ri[3];
+  for (int k = 0; k < 3; k++)
+  {
+    ro[k] = _mm256_set1_ps(o[k]);
+    ri[k] = _mm256_set1_ps(inv[k]);
+  }
+
+  int hits = 0;
+  for (int i = 0; i < bp.Size(); i += 8)
+  {
+    __m256 t0 = _mm256_setzero_ps();
+    __m256 t1 = tfar;
+    for (int k = 0; k < 3; k++)
+    {
+      __m256 ta = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(bp.Lower(k) + i), ro[k]), ri[k]);
+      __m256 tb = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(bp.Upper(k) + i), ro[k]), ri[k]);
+      t0 = _mm256_max_ps(t0, _mm256_min_ps(ta, tb));
+      t1 = _mm256_min_ps(t1, _mm256_max_ps(ta, tb));
+    }
+    __m256 mask = _mm256_cmp_ps(t0, t1, _CMP_LE_OQ);
+    t0 = _mm256_blendv_ps(miss, t0, mask);
+
+    alignas(32) float l0[8];
+    _mm256_store_ps(l0, t0);
+    int bits = _mm256_movemask_ps(mask);
+    for (int k = 0; k < 8 && i + k < bp.Size(); k++)
+    {
+      tn[i + k] = l0[k];
+      hits += (bits >> k) & 1;
+    }
+  }
+  return hits;
+}
+
+static const PacketKernels AVX2Kernels = { Packet::Isa::AVX2, 8, RayTrianglesAVX2, RaysTriangleAVX2, RaysBoxesAVX2, RayBoxesAVX2 };
+
+#endif
+
+/*!
+\brief Detect the widest instruction set supported by the processor and the operating system.
+*/
+Packet::Isa Packet::Detect()
+{
+#ifdef PACKET_X86
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 0);
+  const int ids = info[0];
+  __cpuid(info, 1);
+  const bool sse = (info[3] & (1 << 25)) != 0;
+  const bool fma = (info[2] & (1 << 12)) != 0;
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  bool avx2 = false;
+  if (ids >= 7 && fma && osxsave && ((_xgetbv(0) & 6) == 6))
+  {
+    __cpuidex(info, 7, 0);
+    avx2 = (info[1] & (1 << 5)) != 0;
+  }
+#else
+  __builtin_cpu_init();
+  const bool sse = __builtin_cpu_supports("sse2");
+  const bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+  if (avx2)
+    return Isa::AVX2;
+  if (sse)
+    return Isa::SSE;
+#endif
+  return Isa::Scalar;
+}
+
+/*!
+\brief Return the kernel table of a given instruction set.
+\param isa Instruction set, should be supported by the processor.
+*/
+static const PacketKernels* PacketTable(Packet::Isa isa)
+{
+#ifdef PACKET_X86
+  if (isa == Packet::Isa::AVX2)
+    return &AVX2Kernels;
+  if (isa == Packet::Isa::SSE)
+    return &SSEKernels;
+#endif
+  return &ScalarKernels;
+}
+
+// Selected kernels, initialized on first use
+static const PacketKernels*& PacketSelected()
+{
+  static const PacketKernels* kernels = PacketTable(Packet::Detect());
+  return kernels;
+}
+
+/*!
+\brief Return the instruction set of the kernels currently in use.
+*/
+Packet::Isa Packet::Current()
+{
+  return PacketSelected()->isa;
+}
+
+/*!
+\brief Force the kernels to a given instruction set, for instance to compare the implementations.
+
+The instruction set is clamped to what the processor supports. This function should not be called
+while other threads are using the kernels.
+\param isa Instruction set.
+*/
+void Packet::Select(Isa isa)
+{
+  if (int(isa) > int(Detect()))
+    isa = Detect();
+  PacketSelected() = PacketTable(isa);
+}
+
+/*!
+\brief Return the number of lanes of the kernels currently in use.
+*/
+int Packet::Width()
+{
+  return PacketSelected()->width;
+}
+
+/*!
+\brief Return the name of an instruction set.
+\param isa Instruction set.
+*/
+const char* Packet::Name(Isa isa)
+{
+  switch (isa)
+  {
+  case Isa::AVX2:
+    return "AVX2";
+  case Isa::SSE:
+    return "SSE";
+  default:
+    return "Scalar";
+  }
+}
+
+/*!
+\brief Compute the closest intersection between a ray and a set of triangles.
+
+Only intersections in front of the origin of the ray, that is with t > 0, are reported.
+\param ray The ray.
+\param triangles Set of triangles.
+\param t Intersection depth.
+\param u,v Parametric coordinates of the intersection in the triangle.
+\param tmax Intersections beyond this distance are ignored.
+\return Index of the intersected triangle in the packet, -1 if none.
+*/
+int Packet::Intersect(const Ray& ray, const TrianglePacket& triangles, double& t, double& u, double& v, double tmax)
+{
+  return Intersect(ray, triangles, 0, triangles.Size(), t, u, v, tmax);
+}
+
+/*!
+\brief Compute the closest intersection between a ray and a range of triangles of a set.
+
+This is the leaf query of bounding volume hierarchies storing their triangles in a single packet.
+\param ray The ray.
+\param triangles Set of triangles.
+\param first, last Range of triangles, last excluded.
+\param t Intersection depth.
+\param u,v Parametric coordinates of the intersection in the triangle.
+\param tmax Intersections beyond this distance are ignored.
+\return Index of the intersected triangle in the packet, -1 if none.
+*/
+int Packet::Intersect(const Ray& ray, const TrianglePacket& triangles, int first, int last, double& t, double& u, double& v, double tmax)
+{
+  const float o[3] = { float(ray.Origin()[0]), float(ray.Origin()[1]), float(ray.Origin()[2]) };
+  const float d[3] = { float(ray.Direction()[0]), float(ray.Direction()[1]), float(ray.Direction()[2]) };
+  float ft = float(tmax), fu = 0.0f, fv = 0.0f;
+  int hit = PacketSelected()->rayTriangles(o, d, triangles, first, last, ft, fu, fv);
+  if (hit >= 0)
+  {
+    t = ft;
+    u = fu;
+    v = fv;
+  }
+  return hit;
+}
+
+/*!
+\brief Check whether a ray hits any triangle of the set before a given distance.
+
+This is the shadow ray query.
+\param ray The ray.
+\param triangles Set of triangles.
+\param tmax Distance.
+*/
+bool Packet::Occluded(const Ray& ray, const TrianglePacket& triangles, double tmax)
+{
+  double t, u, v;
+  return Intersect(ray, triangles, t, u, v, tmax) >= 0;
+}
+
+/*!
+\brief Compute the intersections between a set of rays and a single triangle.
+
+Missed rays get a depth equal to Packet::Infinity.
+\param rays Set of rays.
+\param triangle The triangle.
+\param t Returned intersection depths, should have the size of the packet.
+\param u,v Returned parametric coordinates, should have the size of the packet.
+\return Number of rays hitting the triangle.
+*/
+int Packet::Intersect(const RayPacket& rays, const Triangle& triangle, float* t, float* u, float* v)
+{
+  const Vector e1 = triangle[1] - triangle[0];
+  const Vector e2 = triangle[2] - triangle[0];
+  const float p[3] = { float(triangle[0][0]), float(triangle[0][1]), float(triangle[0][2]) };
+  const float a[3] = { float(e1[0]), float(e1[1]), float(e1[2]) };
+  const float b[3] = { float(e2[0]), float(e2[1]), float(e2[2]) };
+  return PacketSelected()->raysTriangle(rays, p, a, b, t, u, v);
+}
+
+/*!
+\brief Compute the intersections between the i-th ray and the i-th box of two packets.
+
+Missed rays get entry and exit depths equal to Packet::Infinity. If a ray starts inside a box, the entry depth is 0.
+\param rays Set of rays.
+\param boxes Set of boxes.
+\param tn, tf Returned entry and exit depths, should have the size of the smallest packet.
+\return Number of intersections.
+*/
+int Packet::Intersect(const RayPacket& rays, const BoxPacket& boxes, float* tn, float* tf)
+{
+  return PacketSelected()->raysBoxes(rays, boxes, Math::Min(rays.Size(), boxes.Size()), tn, tf);
+}
+
+/*!
+\brief Compute the intersections between a ray and a set of boxes.
+
+This is the inner loop of wide bounding volume hierarchies.
+\param ray The ray.
+\param boxes Set of boxes.
+\param tn Returned entry depths, Packet::Infinity for missed boxes.
+\param tmax Boxes beyond this distance are ignored.
+\return Number of intersected boxes.
+*/
+int Packet::Intersect(const Ray& ray, const BoxPacket& boxes, float* tn, double tmax)
+{
+  const float o[3] = { float(ray.Origin()[0]), float(ray.Origin()[1]), float(ray.Origin()[2]) };
+  const float inv[3] = { 1.0f / float(ray.Direction()[0]), 1.0f / float(ray.Direction()[1]), 1.0f / float(ray.Direction()[2]) };
+  return PacketSelected()->rayBoxes(o, inv, boxes, float(tmax), tn);
+}
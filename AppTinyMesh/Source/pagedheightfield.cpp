@@ -0,0 +1,593 @@
+// PagedHeightField
+
+#include "pagedheightfield.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include <QtCore/QFileInfo>
+
+/*!
+\class PagedHeightField pagedheightfield.h
+\brief Height field stored on disk in tiles of 16 bit heights, for terrains that do not fit in memory.
+
+The file is memory mapped, and tiles are decoded to floating point heights when they are accessed. Decoded tiles are kept
+in a cache with a memory budget, and the least recently used ones are evicted, modified tiles being written back to the file.
+A background thread decodes the tiles around a point, such as the target of the camera, before they are needed.
+
+The file starts with a 32 bytes header, followed by the tiles row after row, each tile storing Tile x Tile heights
+row after row, quantized to 16 bits in the range of the heights. Tiles on the border are padded with the closest heights.
+Values are stored in the byte order of the machine.
+
+Terrains too large to be loaded are converted from headerless files, which are streamed:
+\code
+PagedHeightField::Write("terrain.hft", "dem.r16", 65536, 65536);
+PagedHeightField terrain("terrain.hft", size_t(256) << 20); // 256 MB of decoded tiles
+terrain.Prefetch(camera.At(), 50.0, 0.01);
+MeshColor mesh = terrain.generateSmoothMesh(1024, 1024, 512, 512, 1.0, 0.01, 1.0); // In the frame of the whole terrain
+\endcode
+*/
+
+// Header of the file
+struct PagedHeader
+{
+  char magic[4];       //!< File signature.
+  int32_t width;       //!< Number of rows.
+  int32_t length;      //!< Number of heights per row.
+  int32_t tile;        //!< Size of the tiles.
+  float a, b;          //!< Range of the quantized heights.
+  int32_t reserved[2]; //!< Padding.
+};
+
+static const char Magic[4] = { 'H', 'F', 'T', '1' };
+
+/*!
+\brief Open and map a tiled height field file.
+
+The file is opened for reading and writing if possible, otherwise modifications are lost when tiles are evicted.
+\param filename File name.
+\param memory Memory budget of the decoded tiles, in bytes.
+*/
+PagedHeightField::PagedHeightField(const QString& filename, size_t memory) :file(filename)
+{
+  budget = std::max(memory / (sizeof(float) * Tile * Tile), size_t(4));
+
+  writable = file.open(QIODevice::ReadWrite);
+  if (!writable && !file.open(QIODevice::ReadOnly))
+    return;
+
+  const qint64 size = file.size();
+  if (size < qint64(sizeof(PagedHeader)))
+    return;
+  uchar* map = file.map(0, size);
+  if (map == nullptr)
+    return;
+
+  PagedHeader header;
+  std::memcpy(&header, map, sizeof(PagedHeader));
+  const int r = (header.width + Tile - 1) / Tile, c = (header.length + Tile - 1) / Tile;
+  if (std::memcmp(header.magic, Magic, 4) != 0 || header.tile != Tile || header.width <= 0 || header.length <= 0 ||
+    size < qint64(sizeof(PagedHeader)) + qint64(r) * c * Tile * Tile * qint64(sizeof(uint16_t)))
+  {
+    file.unmap(map);
+    return;
+  }
+
+  data = map;
+  width = header.width;
+  length = header.length;
+  rows = r;
+  columns = c;
+  a = header.a;
+  b = header.b;
+
+  prefetcher = std::thread(&PagedHeightField::Run, this);
+}
+
+/*!
+\brief Stop prefetching, write back modified tiles and unmap the file.
+*/
+PagedHeightField::~PagedHeightField()
+{
+  if (data == nullptr)
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop = true;
+  }
+  wakeup.notify_all();
+  prefetcher.join();
+
+  Flush();
+  file.unmap(data);
+}
+
+/*!
+\brief Write a height field as tiles of quantized heights.
+\param filename File name.
+\param view Heights.
+\return True if the file was written.
+*/
+bool PagedHeightField::Write(const QString& filename, const HeightView& view)
+{
+  const int w = view.getWidth(), l = view.getLength();
+  if (w <= 0 || l <= 0)
+    return false;
+
+  PagedHeader header;
+  std::memcpy(header.magic, Magic, 4);
+  header.width = w;
+  header.length = l;
+  header.tile = Tile;
+  header.a = header.b = view(0, 0);
+  header.reserved[0] = header.reserved[1] = 0;
+  for (int i = 0; i < w; i++)
+  {
+    const float* h = view[i];
+    for (int j = 0; j < l; j++)
+    {
+      header.a = std::min(header.a, h[j]);
+      header.b = std::max(header.b, h[j]);
+    }
+  }
+  const float scale = (header.b > header.a) ? 65535.0f / (header.b - header.a) : 0.0f;
+
+  QFile out(filename);
+  if (!out.open(QIODevice::WriteOnly))
+    return false;
+  if (out.write(reinterpret_cast<const char*>(&header), sizeof(PagedHeader)) != qint64(sizeof(PagedHeader)))
+    return false;
+
+  // One row of tiles at a time
+  const int r = (w + Tile - 1) / Tile, c = (l + Tile - 1) / Tile;
+  std::vector<uint16_t> buffer(size_t(c) * Tile * Tile);
+  for (int ti = 0; ti < r; ti++)
+  {
+#pragma omp parallel for
+    for (int u = 0; u < Tile; u++)
+    {
+      const float* h = view[std::min(ti * Tile + u, w - 1)];
+      for (int tj = 0; tj < c; tj++)
+      {
+        uint16_t* q = &buffer[(size_t(tj) * Tile + u) * Tile];
+        for (int v = 0; v < Tile; v++)
+        {
+          q[v] = uint16_t((h[std::min(tj * Tile + v, l - 1)] - header.a) * scale + 0.5f);
+        }
+      }
+    }
+    const qint64 bytes = qint64(buffer.size() * sizeof(uint16_t));
+    if (out.write(reinterpret_cast<const char*>(buffer.data()), bytes) != bytes)
+      return false;
+  }
+  return true;
+}
+
+/*!
+\brief Convert a headerless file of heights to tiles of quantized heights, without loading it.
+
+The source is mapped and read twice in the order of the file: once for the range of the heights, then one band of Tile rows
+of the file at a time, which are quantized in parallel and written as their tiles. Formats and sizes are those of
+HeightField::Load(): .r16 files store 16 bits unsigned heights, .raw files 32 bits floating point heights rescaled to [0, 1]
+if they exceed this range, and the j-th row of the file stores the heights (i, j), so that a band of rows is a column of tiles.
+\param filename File name.
+\param source Headerless file of heights.
+\param w, l Size of the grid, or 0 if unknown.
+\return True if the file was written.
+*/
+bool PagedHeightField::Write(const QString& filename, const QString& source, int w, int l)
+{
+  const QString suffix = QFileInfo(source).suffix().toLower();
+  if (suffix != "r16" && suffix != "raw")
+    return false;
+  const bool r16 = (suffix == "r16");
+
+  QFile in(source);
+  if (!in.open(QIODevice::ReadOnly))
+    return false;
+  const qint64 size = in.size();
+  if (!HeightField::Headerless(size, r16 ? sizeof(uint16_t) : sizeof(float), w, l))
+    return false;
+  const uchar* map = in.map(0, size);
+  if (map == nullptr)
+    return false;
+  const uint16_t* q16 = reinterpret_cast<const uint16_t*>(map);
+  const float* q32 = reinterpret_cast<const float*>(map);
+
+  // Height (i, j) is the i-th value of the j-th row of the file
+  auto value = [&](size_t k)
+    {
+      return r16 ? float(q16[k]) / 65535.0f : q32[k];
+    };
+
+  // Range of the heights, row after row of the file
+  std::vector<float> lows(l), highs(l);
+#pragma omp parallel for schedule(dynamic, 64)
+  for (int y = 0; y < l; y++)
+  {
+    float lo = value(size_t(y) * w), hi = lo;
+    for (int x = 1; x < w; x++)
+    {
+      const float h = value(size_t(y) * w + x);
+      lo = std::min(lo, h);
+      hi = std::max(hi, h);
+    }
+    lows[y] = lo;
+    highs[y] = hi;
+  }
+  const float low = *std::min_element(lows.begin(), lows.end()), high = *std::max_element(highs.begin(), highs.end());
+  const float scale = (high > low) ? 65535.0f / (high - low) : 0.0f;
+
+  PagedHeader header;
+  std::memcpy(header.magic, Magic, 4);
+  header.width = w;
+  header.length = l;
+  header.tile = Tile;
+  header.a = low;
+  header.b = high;
+  header.reserved[0] = header.reserved[1] = 0;
+  if (!r16 && (low < 0.0f || high > 1.0f))
+  {
+    // Rescaled as HeightField::Load(), quantized values are the same
+    header.a = 0.0f;
+    header.b = 1.0f;
+  }
+
+  QFile out(filename);
+  if (!out.open(QIODevice::WriteOnly) || !out.resize(qint64(sizeof(PagedHeader)) + qint64((w + Tile - 1) / Tile) * ((l + Tile - 1) / Tile) * Tile * Tile * qint64(sizeof(uint16_t))))
+  {
+    in.unmap(const_cast<uchar*>(map));
+    return false;
+  }
+  bool written = out.write(reinterpret_cast<const char*>(&header), sizeof(PagedHeader)) == qint64(sizeof(PagedHeader));
+
+  // One band of rows of the file at a time
+  const int r = (w + Tile - 1) / Tile, c = (l + Tile - 1) / Tile;
+  std::vector<uint16_t> buffer(size_t(r) * Tile * Tile);
+  for (int tj = 0; tj < c && written; tj++)
+  {
+#pragma omp parallel for
+    for (int v = 0; v < Tile; v++)
+    {
+      const size_t row = size_t(std::min(tj * Tile + v, l - 1)) * w;
+      for (int ti = 0; ti < r; ti++)
+      {
+        uint16_t* q = &buffer[size_t(ti) * Tile * Tile + v];
+        for (int u = 0; u < Tile; u++)
+        {
+          q[size_t(u) * Tile] = uint16_t((value(row + std::min(ti * Tile + u, w - 1)) - low) * scale + 0.5f);
+        }
+      }
+    }
+    const qint64 bytes = qint64(Tile) * Tile * qint64(sizeof(uint16_t));
+    for (int ti = 0; ti < r && written; ti++)
+    {
+      written = out.seek(qint64(sizeof(PagedHeader)) + (qint64(ti) * c + tj) * bytes) &&
+        out.write(reinterpret_cast<const char*>(&buffer[size_t(ti) * Tile * Tile]), bytes) == bytes;
+    }
+  }
+  in.unmap(const_cast<uchar*>(map));
+  return written;
+}
+
+/*!
+\brief Get a decoded tile, decoding it and evicting the least recently used tiles if needed.
+
+The mutex should be locked, and the returned page is valid until the next call.
+\param t Tile index.
+*/
+PagedHeightField::Page& PagedHeightField::Load(int t)
+{
+  std::unordered_map<int, Page>::iterator it = pages.find(t);
+  if (it != pages.end())
+  {
+    recent.splice(recent.begin(), recent, it->second.recent);
+    return it->second;
+  }
+
+  while (pages.size() >= budget)
+  {
+    const int last = recent.back();
+    recent.pop_back();
+    it = pages.find(last);
+    if (it->second.dirty)
+      Store(last, it->second);
+    pages.erase(it);
+  }
+
+  Page& page = pages[t];
+  page.height.resize(size_t(Tile) * Tile);
+  const uint16_t* q = reinterpret_cast<const uint16_t*>(data + sizeof(PagedHeader)) + size_t(t) * Tile * Tile;
+  const float scale = (b - a) / 65535.0f;
+  for (int k = 0; k < Tile * Tile; k++)
+  {
+    page.height[k] = a + scale * float(q[k]);
+  }
+  recent.push_front(t);
+  page.recent = recent.begin();
+  return page;
+}
+
+/*!
+\brief Write a decoded tile back to the file, clamping heights to the range of the file.
+
+The mutex should be locked.
+\param t Tile index.
+\param page Decoded tile.
+*/
+void PagedHeightField::Store(int t, const Page& page)
+{
+  if (!writable)
+    return;
+  uint16_t* q = reinterpret_cast<uint16_t*>(data + sizeof(PagedHeader)) + size_t(t) * Tile * Tile;
+  const float scale = (b > a) ? 65535.0f / (b - a) : 0.0f;
+  for (int k = 0; k < Tile * Tile; k++)
+  {
+    q[k] = uint16_t((std::min(std::max(page.height[k], a), b) - a) * scale + 0.5f);
+  }
+}
+
+/*!
+\brief Write back all modified tiles.
+*/
+void PagedHeightField::Flush()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  for (std::pair<const int, Page>& page : pages)
+  {
+    if (page.second.dirty)
+    {
+      Store(page.first, page.second);
+      page.second.dirty = false;
+    }
+  }
+}
+
+/*!
+\brief Get a height, decoding its tile if needed.
+\param i, j Integer coordinates.
+*/
+float PagedHeightField::Height(int i, int j)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return Sample(i, j);
+}
+
+/*!
+\brief Get a height, decoding its tile if needed.
+
+The mutex should be locked.
+\param i, j Integer coordinates.
+*/
+float PagedHeightField::Sample(int i, int j)
+{
+  return Load((i / Tile) * columns + j / Tile).height[(i % Tile) * Tile + j % Tile];
+}
+
+/*!
+\brief Copy a rectangle of heights into a height field, decoding tiles as needed.
+\param i, j First height, clamped to the grid.
+\param w, l Size of the rectangle, clamped to the grid.
+*/
+HeightField PagedHeightField::Window(int i, int j, int w, int l)
+{
+  const int i0 = std::min(std::max(i, 0), width), j0 = std::min(std::max(j, 0), length);
+  const int i1 = std::min(std::max(i + w, i0), width), j1 = std::min(std::max(j + l, j0), length);
+
+  HeightField hf(i1 - i0, j1 - j0);
+  for (int ti = i0 / Tile; ti * Tile < i1; ti++)
+  {
+    for (int tj = j0 / Tile; tj * Tile < j1; tj++)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      const Page& page = Load(ti * columns + tj);
+      const int u0 = std::max(i0, ti * Tile), u1 = std::min(i1, (ti + 1) * Tile);
+      const int v0 = std::max(j0, tj * Tile), v1 = std::min(j1, (tj + 1) * Tile);
+      for (int u = u0; u < u1; u++)
+      {
+        std::copy_n(&page.height[(u - ti * Tile) * Tile + v0 - tj * Tile], v1 - v0, hf[u - i0] + v0 - j0);
+      }
+    }
+  }
+  return hf;
+}
+
+/*!
+\brief Generate the mesh of a rectangle of the height field, in the frame of the whole terrain.
+
+Vertices are placed as HeightField::generateSmoothMesh() would place them for the whole grid, so that the meshes
+of neighboring rectangles share their borders. Heights are read with a margin of one sample, so that normals and colors
+on the border of the rectangle are those of the whole grid.
+\param i, j First height, clamped to the grid.
+\param w, l Size of the rectangle, clamped to the grid.
+\param heightMax Max height that the mesh can't exceed.
+\param squareSize Size of one square (4 vertices) of the mesh.
+\param mult Coefficient to amplify the slope coefficient (thus the color).
+*/
+MeshColor PagedHeightField::generateSmoothMesh(int i, int j, int w, int l, double heightMax, double squareSize, double mult)
+{
+  const int i0 = std::min(std::max(i, 0), width), j0 = std::min(std::max(j, 0), length);
+  const int i1 = std::min(std::max(i + w, i0), width), j1 = std::min(std::max(j + l, j0), length);
+  const int mw = i1 - i0, ml = j1 - j0;
+  if (mw < 2 || ml < 2)
+    return MeshColor();
+
+  // Window with the margin, and position of the rectangle in it
+  const int wi = std::max(i0 - 1, 0), wj = std::max(j0 - 1, 0);
+  const HeightField window = Window(wi, wj, std::min(i1 + 1, width) - wi, std::min(j1 + 1, length) - wj);
+  const int di = i0 - wi, dj = j0 - wj;
+
+  const size_t n = size_t(mw) * ml;
+  const size_t quads = size_t(mw - 1) * (ml - 1);
+  std::vector<Vector> vertices(n);
+  std::vector<Vector> normals(n);
+  std::vector<Color> cols(n);
+  std::vector<int> va(6 * quads);
+
+  const double offsetX = (width * squareSize) / 2;
+  const double offsetY = (length * squareSize) / 2;
+
+#pragma omp parallel for schedule(dynamic, 16)
+  for (int u = 0; u < mw; u++)
+  {
+    const float* h = window[u + di];
+    for (int v = 0; v < ml; v++)
+    {
+      const size_t k = size_t(u) * ml + v;
+      vertices[k] = Vector((i0 + u) * squareSize - offsetX, (length - j0 - v) * squareSize - offsetY, h[v + dj] * heightMax);
+      normals[k] = window.smoothNormal(u + di, v + dj, heightMax, squareSize);
+      cols[k] = window.generateColor(u + di, v + dj, mult);
+
+      // Two triangles per square, oriented upward
+      if (u > 0 && v > 0)
+      {
+        const int first = int(k - ml - 1), second = int(k - ml), third = int(k - 1), fourth = int(k);
+        int* t = &va[6 * (size_t(u - 1) * (ml - 1) + (v - 1))];
+        t[0] = first;
+        t[1] = second;
+        t[2] = fourth;
+        t[3] = first;
+        t[4] = fourth;
+        t[5] = third;
+      }
+    }
+  }
+
+  std::vector<int> na(va);
+  std::vector<int> ca(va);
+  return MeshColor(Mesh(std::move(vertices), std::move(normals), std::move(va), std::move(na)), std::move(cols), std::move(ca));
+}
+
+/*!
+\brief Color a vertex based on the slope, as HeightField::generateColor(), decoding tiles as needed.
+\param i, j Integer coordinates.
+\param mult Coefficient to amplify the slope coefficient (thus the color).
+*/
+Color PagedHeightField::generateColor(int i, int j, double mult)
+{
+  // Previous heights, or the next ones on the border
+  const int ip = i > 0 ? i - 1 : i + 1, jp = j > 0 ? j - 1 : j + 1;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  const float h = Sample(i, j);
+  return HeightField::slopeColor(h, h - Sample(ip, j), h - Sample(i, jp), mult);
+}
+
+/*!
+\brief Flatten a disk of the height field, as HeightField::flatten(), decoding tiles as needed.
+\param x, y Center of the disk.
+\param radius Radius of the disk.
+\param floor The floor height to flatten to.
+\param strength Coefficient to amplify the strength of the flattening.
+*/
+void PagedHeightField::flatten(int x, int y, double radius, double floor, double strength)
+{
+  const double rad = radius * radius;
+  const int r = int(ceil(radius));
+  const int i0 = std::max(x - r, 0), i1 = std::min(x + r, width - 1);
+  const int j0 = std::max(y - r, 0), j1 = std::min(y + r, length - 1);
+  if (i1 < i0 || j1 < j0)
+    return;
+
+  for (int ti = i0 / Tile; ti <= i1 / Tile; ti++)
+  {
+    for (int tj = j0 / Tile; tj <= j1 / Tile; tj++)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      Page& page = Load(ti * columns + tj);
+      for (int i = std::max(i0, ti * Tile); i <= std::min(i1, (ti + 1) * Tile - 1); i++)
+      {
+        float* h = page.height.data() + size_t(i - ti * Tile) * Tile;
+        for (int j = std::max(j0, tj * Tile); j <= std::min(j1, (tj + 1) * Tile - 1); j++)
+        {
+          const double distance = double(i - x) * (i - x) + double(j - y) * (j - y);
+          if (distance < rad)
+          {
+            const double s = (1 - (distance / rad)) * (1 - (distance / rad)) * strength;
+            float& z = h[j - tj * Tile];
+            z = float(s * floor + (1 - s) * z);
+          }
+        }
+      }
+      page.dirty = true;
+    }
+  }
+}
+
+/*!
+\brief Request the tiles around a point to be decoded in the background, nearest first.
+
+Previous requests are replaced, and at most half of the budget is requested.
+\param p Point, in the frame of the generated meshes, such as the target of the camera.
+\param radius Radius around the point.
+\param squareSize Size of one square of the mesh.
+*/
+void PagedHeightField::Prefetch(const Vector& p, double radius, double squareSize)
+{
+  if (data == nullptr)
+    return;
+
+  // Grid coordinates, as in generateSmoothMesh()
+  const double ci = p[0] / squareSize + 0.5 * width;
+  const double cj = length - p[1] / squareSize - 0.5 * length;
+  const double cr = radius / squareSize;
+
+  std::vector<std::pair<double, int>> tiles;
+  for (int ti = std::max(int((ci - cr) / Tile), 0); ti <= std::min(int((ci + cr) / Tile), rows - 1); ti++)
+  {
+    for (int tj = std::max(int((cj - cr) / Tile), 0); tj <= std::min(int((cj + cr) / Tile), columns - 1); tj++)
+    {
+      const double di = ci - Math::Clamp(ci, ti * Tile, (ti + 1) * Tile);
+      const double dj = cj - Math::Clamp(cj, tj * Tile, (tj + 1) * Tile);
+      if (di * di + dj * dj <= cr * cr)
+        tiles.push_back(std::make_pair(di * di + dj * dj, ti * columns + tj));
+    }
+  }
+  std::sort(tiles.begin(), tiles.end());
+  tiles.resize(std::min(tiles.size(), budget / 2));
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    requests.clear();
+    for (const std::pair<double, int>& tile : tiles)
+    {
+      if (pages.find(tile.second) == pages.end())
+        requests.push_back(tile.second);
+    }
+  }
+  wakeup.notify_one();
+}
+
+/*!
+\brief Decode requested tiles until stopped.
+*/
+void PagedHeightField::Run()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true)
+  {
+    wakeup.wait(lock, [this]() { return stop || !requests.empty(); });
+    if (stop)
+      return;
+    const int t = requests.front();
+    requests.pop_front();
+    Load(t);
+
+    // Let other threads access the cache between tiles
+    lock.unlock();
+    std::this_thread::yield();
+    lock.lock();
+  }
+}
+
+/*!
+\brief Get the memory used by decoded tiles, in bytes.
+*/
+size_t PagedHeightField::Memory() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return pages.size() * sizeof(float) * Tile * Tile;
+}
@@ -0,0 +1,350 @@
+// PathTracer
+
+#include "pathtracer.h"
+
+#include <chrono>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/*!
+\class PathTracer pathtracer.h
+\brief An offline path tracer for scenes made of meshes.
+
+This renderer does not need any graphics hardware. Surfaces are Lambertian, lit by a sky and a
+directional sun light sampled explicitly with shadow rays. Rays are traced against a single BVH of
+all the triangles of the scene.
+
+The image is split into square tiles, which are distributed to the threads with the dynamic schedule
+of OpenMP: idle threads grab the next remaining tile, so that expensive regions do not stall the others.
+Samples are accumulated progressively, so that calling Render() again refines the image.
+
+\code
+PathTracer renderer(1280, 720);
+renderer.Add(mesh);
+renderer.SetCamera(camera);
+for (int i = 0; i < 16; i++)
+{
+  renderer.Render(4);
+}
+renderer.Save("image.png");
+std::cout << renderer.RaysPerSecondPerCore() << std::endl;
+\endcode
+*/
+
+/*!
+\brief Create a renderer.
+\param w, h Size of the image.
+*/
+PathTracer::PathTracer(int w, int h) :width(w), height(h)
+{
+  Reset();
+}
+
+/*!
+\brief Add a mesh with a uniform color to the scene.
+\param mesh The mesh.
+\param color The color.
+*/
+void PathTracer::Add(const Mesh& mesh, const Color& color)
+{
+  for (int i = 0; i < mesh.Triangles(); i++)
+  {
+    triangles.push_back(mesh.GetTriangle(i));
+    colors.push_back(color);
+    colors.push_back(color);
+    colors.push_back(color);
+  }
+  dirty = true;
+  Reset();
+}
+
+/*!
+\brief Add a mesh with colors at vertices to the scene.
+\param mesh The mesh.
+*/
+void PathTracer::Add(const MeshColor& mesh)
+{
+  const std::vector<Color> c = mesh.GetColors();
+  const std::vector<int> ci = mesh.ColorIndexes();
+  for (int i = 0; i < mesh.Triangles(); i++)
+  {
+    triangles.push_back(mesh.GetTriangle(i));
+    for (int j = 0; j < 3; j++)
+    {
+      colors.push_back(c[ci[3 * i + j]]);
+    }
+  }
+  dirty = true;
+  Reset();
+}
+
+/*!
+\brief Set the camera, this discards the samples accumulated so far.
+\param c The camera.
+*/
+void PathTracer::SetCamera(const Camera& c)
+{
+  camera = c;
+  Reset();
+}
+
+/*!
+\brief Set the maximum number of bounces, this discards the samples accumulated so far.
+\param d Depth.
+*/
+void PathTracer::SetDepth(int d)
+{
+  depth = d;
+  Reset();
+}
+
+/*!
+\brief Set the sun, this discards the samples accumulated so far.
+\param d Direction toward the sun.
+\param c Radiance.
+*/
+void PathTracer::SetSun(const Vector& d, const Color& c)
+{
+  sun = Normalized(d);
+  light = c;
+  Reset();
+}
+
+/*!
+\brief Discard the samples accumulated so far.
+*/
+void PathTracer::Reset()
+{
+  accumulation.assign(width * height, Color(0.0, 0.0, 0.0, 0.0));
+  samples = 0;
+  rays = 0;
+  seconds = 0.0;
+}
+
+/*!
+\brief Accumulate samples in every pixel.
+\param n Number of samples per pixel.
+*/
+void PathTracer::Render(int n)
+{
+  if (dirty)
+  {
+    bvh = BVH(triangles);
+    dirty = false;
+  }
+
+  auto start = std::chrono::high_resolution_clock::now();
+
+  const int tx = (width + Tile - 1) / Tile;
+  const int ty = (height + Tile - 1) / Tile;
+  long long count = 0;
+
+#pragma omp parallel for schedule(dynamic, 1) reduction(+:count)
+  for (int i = 0; i < tx * ty; i++)
+  {
+    RenderTile((i % tx) * Tile, (i / tx) * Tile, n, count);
+  }
+
+  auto stop = std::chrono::high_resolution_clock::now();
+
+  samples += n;
+  rays += count;
+  seconds += std::chrono::duration<double>(stop - start).count();
+}
+
+/*!
+\brief Accumulate samples in the pixels of a tile.
+\param x, y Corner of the tile.
+\param n Number of samples per pixel.
+\param count Number of rays, incremented.
+*/
+void PathTracer::RenderTile(int x, int y, int n, long long& count)
+{
+  for (int j = y; j < y + Tile && j < height; j++)
+  {
+    for (int i = x; i < x + Tile && i < width; i++)
+    {
+      Color sum(0.0, 0.0, 0.0, 0.0);
+      for (int k = samples; k < samples + n; k++)
+      {
+        // Decorrelated seed for every pixel and sample, independent of the thread
+        unsigned int seed = Hash(Hash(j * width + i) ^ Hash(k + 0x9e3779b9u)) | 1;
+
+        Ray ray = camera.PixelToRay(i + Random(seed), j + Random(seed), width, height);
+        sum += Radiance(ray, seed, count);
+      }
+      accumulation[j * width + i] += sum;
+    }
+  }
+}
+
+/*!
+\brief Compute the radiance along a ray.
+\param ray The ray.
+\param seed Random seed.
+\param count Number of rays, incremented.
+*/
+Color PathTracer::Radiance(const Ray& ray, unsigned int& seed, long long& count) const
+{
+  Color result(0.0, 0.0, 0.0, 0.0);
+  Color throughput(1.0, 1.0, 1.0, 1.0);
+  Ray r = ray;
+
+  for (int k = 0; ; k++)
+  {
+    double t, u, v;
+    int i;
+    count++;
+    if (!bvh.Intersect(r, t, u, v, i))
+    {
+      result += throughput.Scale(Sky(r.Direction()));
+      break;
+    }
+
+    // Geometric normal facing the ray
+    Vector n = triangles[i].Normal();
+    if (n * r.Direction() > 0.0)
+    {
+      n = -n;
+    }
+    const Vector p = r(t) + n * (1.0e-4 * (1.0 + Norm(r(t))));
+
+    Color albedo = (1.0 - u - v) * colors[3 * i] + u * colors[3 * i + 1] + v * colors[3 * i + 2];
+    throughput = throughput.Scale(albedo);
+
+    // Sun
+    double c = n * sun;
+    if (c > 0.0)
+    {
+      count++;
+      if (!bvh.Occluded(Ray(p, sun), Packet::Infinity))
+      {
+        result += throughput.Scale(light) * c;
+      }
+    }
+
+    if (k == depth)
+      break;
+
+    // Russian roulette on dark paths, black paths carry no more radiance
+    double q = Math::Max(throughput[0], throughput[1], throughput[2]);
+    if (q <= 0.0)
+      break;
+    if (k > 1)
+    {
+      if (Random(seed) > q)
+        break;
+      throughput = throughput / q;
+    }
+
+    // Cosine weighted direction in the hemisphere
+    Vector a, b;
+    n.Orthonormal(a, b);
+    const double phi = 2.0 * M_PI * Random(seed);
+    const double s = Random(seed);
+    const double rs = sqrt(s);
+    r = Ray(p, a * (cos(phi) * rs) + b * (sin(phi) * rs) + n * sqrt(1.0 - s));
+  }
+  return result;
+}
+
+/*!
+\brief Compute the radiance of the sky in a given direction.
+\param d Direction.
+*/
+Color PathTracer::Sky(const Vector& d) const
+{
+  return Color::Lerp(Math::Clamp(d[2]), Color(0.9, 0.9, 0.95), Color(0.35, 0.55, 0.9));
+}
+
+/*!
+\brief Return the average image, tone mapped and gamma corrected.
+*/
+QImage PathTracer::GetImage() const
+{
+  QImage image(width, height, QImage::Format_RGB32);
+  const double s = (samples > 0) ? 1.0 / samples : 0.0;
+  for (int j = 0; j < height; j++)
+  {
+    QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(j));
+    for (int i = 0; i < width; i++)
+    {
+      const Color& c = accumulation[j * width + i];
+      int rgb[3];
+      for (int k = 0; k < 3; k++)
+      {
+        rgb[k] = int(255.0 * pow(Math::Clamp(c[k] * s), 1.0 / 2.2) + 0.5);
+      }
+      line[i] = qRgb(rgb[0], rgb[1], rgb[2]);
+    }
+  }
+  return image;
+}
+
+/*!
+\brief Save the image.
+
+The format is deduced from the extension of the file name, typically png.
+\param name File name.
+*/
+bool PathTracer::Save(const QString& name) const
+{
+  return GetImage().save(name);
+}
+
+/*!
+\brief Return the average number of rays cast per second.
+*/
+double PathTracer::RaysPerSecond() const
+{
+  return (seconds > 0.0) ? rays / seconds : 0.0;
+}
+
+/*!
+\brief Return the average number of rays cast per second and per core.
+*/
+double PathTracer::RaysPerSecondPerCore() const
+{
+  return RaysPerSecond() / Threads();
+}
+
+/*!
+\brief Return the number of threads used for rendering.
+*/
+int PathTracer::Threads()
+{
+#ifdef _OPENMP
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+/*!
+\brief Hash an integer.
+\param x Integer.
+*/
+unsigned int PathTracer::Hash(unsigned int x)
+{
+  x ^= x >> 16;
+  x *= 0x7feb352du;
+  x ^= x >> 15;
+  x *= 0x846ca68bu;
+  x ^= x >> 16;
+  return x;
+}
+
+/*!
+\brief Generate a uniform random number in [0,1[ and update the seed.
+\param seed Seed.
+*/
+double PathTracer::Random(unsigned int& seed)
+{
+  // Xorshift
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return (seed >> 8) * (1.0 / 16777216.0);
+}
@@ -0,0 +1,792 @@
+// PointCloud
+
+#include "pointcloud.h"
+#include "kdtree.h"
+#include "parse.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+
+/*!
+\class PointCloud pointcloud.h
+\brief A set of points with optional normals.
+
+Coordinates and normals are stored as structure of arrays in single precision, so that clouds
+with tens of millions of points remain compact.
+
+Files are memory mapped and parsed in place, in parallel, by chunks of lines: ASCII lines are
+never copied into strings. Supported formats are ASCII .xyz files with one point per line,
+and .ply files in ascii, binary little endian or binary big endian format.
+
+\code
+PointCloud cloud;
+cloud.Load("scan.ply");
+if (!cloud.HasNormals())
+  cloud.EstimateNormals(16);
+\endcode
+*/
+
+/*!
+\brief Create a point cloud from a set of points.
+\param p Array of points.
+*/
+PointCloud::PointCloud(const std::vector<Vector>& p)
+{
+  const int n = int(p.size());
+  x.resize(n);
+  y.resize(n);
+  z.resize(n);
+  for (int i = 0; i < n; i++)
+  {
+    x[i] = float(p[i][0]);
+    y[i] = float(p[i][1]);
+    z[i] = float(p[i][2]);
+  }
+}
+
+/*!
+\brief Return the points as an array of vectors.
+*/
+std::vector<Vector> PointCloud::Points() const
+{
+  const int n = Size();
+  std::vector<Vector> p(n);
+
+#pragma omp parallel for
+  for (int i = 0; i < n; i++)
+  {
+    p[i] = Point(i);
+  }
+  return p;
+}
+
+/*!
+\brief Compute the bounding box of the points.
+*/
+Box PointCloud::GetBox() const
+{
+  const int n = Size();
+  if (n == 0)
+    return Box::Null;
+
+  Vector a = Point(0);
+  Vector b = a;
+#pragma omp parallel
+  {
+    Vector la = a, lb = b;
+#pragma omp for nowait
+    for (int i = 0; i < n; i++)
+    {
+      la = Vector::Min(la, Point(i));
+      lb = Vector::Max(lb, Point(i));
+    }
+#pragma omp critical
+    {
+      a = Vector::Min(a, la);
+      b = Vector::Max(b, lb);
+    }
+  }
+  return Box(a, b);
+}
+
+/*!
+\brief Load a point cloud.
+
+The format is given by the extension: .ply files, other files are read as ASCII .xyz files.
+\param filename File name.
+\return True if points were loaded.
+*/
+bool PointCloud::Load(const QString& filename)
+{
+  x.clear();
+  y.clear();
+  z.clear();
+  nx.clear();
+  ny.clear();
+  nz.clear();
+
+  QFile file(filename);
+  if (!file.open(QIODevice::ReadOnly))
+    return false;
+
+  // Pages are read from disk when the parser reaches them
+  const qint64 size = file.size();
+  const char* data = reinterpret_cast<const char*>(file.map(0, size));
+  if (data == nullptr)
+    return false;
+
+  bool loaded;
+  if (QFileInfo(filename).suffix().toLower() == "ply")
+    loaded = LoadPLY(data, data + size);
+  else
+    loaded = LoadXYZ(data, data + size);
+
+  file.unmap((uchar*)data);
+
+  if (HasNormals())
+    NormalizeNormals();
+  return loaded;
+}
+
+/*!
+\brief Normalize the normals, null normals are left unchanged.
+*/
+void PointCloud::NormalizeNormals()
+{
+  const int n = Size();
+
+#pragma omp parallel for
+  for (int i = 0; i < n; i++)
+  {
+    const float length = sqrt(nx[i] * nx[i] + ny[i] * ny[i] + nz[i] * nz[i]);
+    if (length > 0.0f)
+    {
+      nx[i] /= length;
+      ny[i] /= length;
+      nz[i] /= length;
+    }
+  }
+}
+
+/*!
+\brief Load an ASCII point cloud with the coordinates of one point per line.
+
+Lines that do not start with three numbers, such as comments, are skipped. Further columns are ignored.
+\param begin, end Characters, end excluded.
+*/
+bool PointCloud::LoadXYZ(const char* begin, const char* end)
+{
+  return ParseAscii(begin, end, { 0, 1, 2 }, -1);
+}
+
+/*!
+\brief Load the vertices of a .ply file.
+
+The vertex element should be the first element of the file.
+\param begin, end Characters, end excluded.
+*/
+bool PointCloud::LoadPLY(const char* begin, const char* end)
+{
+  // Header
+  std::string format;
+  int vertices = -1;
+  bool vertex = false, valid = true;
+  std::vector<std::string> names;
+  std::vector<std::string> types;
+
+  const char* p = begin;
+  bool header = false;
+  while (p < end)
+  {
+    const char* eol = (const char*)memchr(p, '\n', end - p);
+    if (eol == nullptr)
+      break;
+    std::istringstream line(std::string(p, eol));
+    p = eol + 1;
+
+    std::string keyword;
+    line >> keyword;
+    if (keyword == "format")
+    {
+      line >> format;
+    }
+    else if (keyword == "element")
+    {
+      std::string name;
+      line >> name;
+      if (name == "vertex")
+      {
+        // Vertices should come first
+        valid = valid && (vertices < 0 && names.empty());
+        line >> vertices;
+        vertex = true;
+      }
+      else
+      {
+        vertex = false;
+        valid = valid && (vertices >= 0);
+      }
+    }
+    else if (keyword == "property" && vertex)
+    {
+      std::string type, name;
+      line >> type >> name;
+      types.push_back(type);
+      names.push_back(name);
+    }
+    else if (keyword == "end_header")
+    {
+      header = true;
+      break;
+    }
+  }
+  if (!header || !valid || vertices < 0)
+    return false;
+
+  // Columns of the coordinates and normals
+  const char* attributes[6] = { "x", "y", "z", "nx", "ny", "nz" };
+  std::vector<int> columns(names.size(), -1);
+  int found = 0;
+  for (int i = 0; i < int(names.size()); i++)
+  {
+    for (int k = 0; k < 6; k++)
+    {
+      if (names[i] == attributes[k])
+      {
+        columns[i] = k;
+        found |= 1 << k;
+      }
+    }
+  }
+  if ((found & 7) != 7)
+    return false;
+  if ((found & 56) != 56)
+  {
+    // Normals are used only if complete
+    for (int i = 0; i < int(columns.size()); i++)
+    {
+      if (columns[i] > 2)
+        columns[i] = -1;
+    }
+  }
+
+  if (format == "ascii")
+    return ParseAscii(p, end, columns, vertices);
+
+  if (format != "binary_little_endian" && format != "binary_big_endian")
+    return false;
+
+  // Binary, lists are not supported in vertices: scalar types are decoded once from their names
+  enum Scalar { Int8, Uint8, Int16, Uint16, Int32, Uint32, Float32, Float64 };
+  std::vector<Scalar> scalars(types.size());
+  std::vector<int> sizes(types.size());
+  std::vector<int> offsets(types.size());
+  int stride = 0;
+  for (int i = 0; i < int(types.size()); i++)
+  {
+    const std::string& t = types[i];
+    if (t == "char" || t == "int8")
+      scalars[i] = Int8;
+    else if (t == "uchar" || t == "uint8")
+      scalars[i] = Uint8;
+    else if (t == "short" || t == "int16")
+      scalars[i] = Int16;
+    else if (t == "ushort" || t == "uint16")
+      scalars[i] = Uint16;
+    else if (t == "int" || t == "int32")
+      scalars[i] = Int32;
+    else if (t == "uint" || t == "uint32")
+      scalars[i] = Uint32;
+    else if (t == "float" || t == "float32")
+      scalars[i] = Float32;
+    else if (t == "double" || t == "float64")
+      scalars[i] = Float64;
+    else
+      return false;
+    const int bytes[8] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+    sizes[i] = bytes[scalars[i]];
+    offsets[i] = stride;
+    stride += sizes[i];
+  }
+  if ((end - p) / stride < vertices)
+    return false;
+
+  const bool swap = (format == "binary_big_endian");
+  const bool normals = (found & 56) == 56;
+  x.resize(vertices);
+  y.resize(vertices);
+  z.resize(vertices);
+  if (normals)
+  {
+    nx.resize(vertices);
+    ny.resize(vertices);
+    nz.resize(vertices);
+  }
+  std::vector<float>* arrays[6] = { &x, &y, &z, &nx, &ny, &nz };
+
+#pragma omp parallel for schedule(dynamic, 4096)
+  for (int i = 0; i < vertices; i++)
+  {
+    const char* v = p + size_t(i) * stride;
+    for (int j = 0; j < int(columns.size()); j++)
+    {
+      if (columns[j] < 0)
+        continue;
+
+      char b[8];
+      memcpy(b, v + offsets[j], sizes[j]);
+      if (swap)
+        std::reverse(b, b + sizes[j]);
+
+      double value = 0.0;
+      switch (scalars[j])
+      {
+      case Int8:
+        value = double(int8_t(b[0]));
+        break;
+      case Uint8:
+        value = double(uint8_t(b[0]));
+        break;
+      case Int16:
+      case Uint16:
+      {
+        int16_t s;
+        memcpy(&s, b, 2);
+        value = (scalars[j] == Uint16) ? double(uint16_t(s)) : double(s);
+        break;
+      }
+      case Int32:
+      case Uint32:
+      {
+        int32_t s;
+        memcpy(&s, b, 4);
+        value = (scalars[j] == Uint32) ? double(uint32_t(s)) : double(s);
+        break;
+      }
+      case Float32:
+      {
+        float f;
+        memcpy(&f, b, 4);
+        value = f;
+        break;
+      }
+      case Float64:
+      {
+        double d;
+        memcpy(&d, b, 8);
+        value = d;
+        break;
+      }
+      }
+      (*arrays[columns[j]])[i] = float(value);
+    }
+  }
+  return vertices > 0;
+}
+
+/*!
+\brief Parse lines of numbers in parallel.
+
+The characters are split into chunks at line boundaries, chunks are parsed independently and then concatenated.
+Lines with fewer numbers than columns are skipped.
+\param begin, end Characters, end excluded.
+\param columns Attribute of every column: 0, 1, 2 for coordinates, 3, 4, 5 for normals, -1 if ignored.
+\param rows Maximum number of points, negative if unlimited.
+*/
+bool PointCloud::ParseAscii(const char* begin, const char* end, const std::vector<int>& columns, int rows)
+{
+  const int nc = int(columns.size());
+  const bool normals = std::find(columns.begin(), columns.end(), 3) != columns.end();
+  const int na = normals ? 6 : 3;
+
+  // Chunks of about one megabyte
+  const int chunks = int(std::min<long long>((end - begin) / (1 << 20) + 1, 1 << 16));
+  std::vector<const char*> cut(chunks + 1);
+  cut[0] = begin;
+  cut[chunks] = end;
+  for (int i = 1; i < chunks; i++)
+  {
+    const char* p = std::max(begin + (end - begin) * i / chunks, cut[i - 1]);
+    const char* eol = (const char*)memchr(p, '\n', end - p);
+    cut[i] = (eol != nullptr) ? eol + 1 : end;
+  }
+
+  std::vector<std::vector<float>> parts(chunks);
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int c = 0; c < chunks; c++)
+  {
+    std::vector<float>& part = parts[c];
+    float row[6] = { 0.0f };
+    const char* p = cut[c];
+    while (p < cut[c + 1])
+    {
+      const char* eol = (const char*)memchr(p, '\n', cut[c + 1] - p);
+      if (eol == nullptr)
+        eol = cut[c + 1];
+
+      int k = 0;
+      const char* s = p;
+      while (k < nc)
+      {
+        while (s < eol && (*s == ' ' || *s == '\t' || *s == '\r' || *s == ','))
+          s++;
+        float f;
+        s = ParseReal(s, eol, f);
+        if (s == nullptr)
+          break;
+        if (columns[k] >= 0)
+          row[columns[k]] = f;
+        k++;
+      }
+      if (k == nc)
+      {
+        part.insert(part.end(), row, row + na);
+      }
+      p = eol + 1;
+    }
+  }
+
+  // Concatenate
+  std::vector<long long> offset(chunks + 1, 0);
+  for (int c = 0; c < chunks; c++)
+  {
+    offset[c + 1] = offset[c] + parts[c].size() / na;
+  }
+  int n = int(std::min<long long>(offset[chunks], (rows < 0) ? offset[chunks] : rows));
+
+  x.resize(n);
+  y.resize(n);
+  z.resize(n);
+  if (normals)
+  {
+    nx.resize(n);
+    ny.resize(n);
+    nz.resize(n);
+  }
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int c = 0; c < chunks; c++)
+  {
+    const std::vector<float>& part = parts[c];
+    const int m = int(std::min<long long>(offset[c + 1], n) - std::min<long long>(offset[c], n));
+    for (int r = 0; r < m; r++)
+    {
+      const int i = int(offset[c]) + r;
+      const float* v = part.data() + size_t(r) * na;
+      x[i] = v[0];
+      y[i] = v[1];
+      z[i] = v[2];
+      if (normals)
+      {
+        nx[i] = v[3];
+        ny[i] = v[4];
+        nz[i] = v[5];
+      }
+    }
+    parts[c] = std::vector<float>();
+  }
+  return n > 0;
+}
+
+/*!
+\brief Compute the eigenvector of the smallest eigenvalue of a symmetric matrix.
+
+Eigenvalues are computed with the trigonometric solution of the characteristic polynomial,
+and the eigenvector as the largest cross product of two rows of the shifted matrix.
+\param a Coefficients xx, xy, xz, yy, yz, zz.
+*/
+Vector PointCloud::Smallest(const double a[6])
+{
+  const double q = (a[0] + a[3] + a[5]) / 3.0;
+  const double p1 = a[1] * a[1] + a[2] * a[2] + a[4] * a[4];
+  const double p2 = (a[0] - q) * (a[0] - q) + (a[3] - q) * (a[3] - q) + (a[5] - q) * (a[5] - q) + 2.0 * p1;
+  const double p = sqrt(p2 / 6.0);
+
+  // Isotropic neighborhood, any direction
+  if (p <= 1.0e-12 * fabs(q) || p == 0.0)
+    return Vector::Z;
+
+  const double b0 = (a[0] - q) / p, b3 = (a[3] - q) / p, b5 = (a[5] - q) / p;
+  const double b1 = a[1] / p, b2 = a[2] / p, b4 = a[4] / p;
+  const double det = b0 * (b3 * b5 - b4 * b4) - b1 * (b1 * b5 - b4 * b2) + b2 * (b1 * b4 - b3 * b2);
+  const double phi = acos(Math::Clamp(0.5 * det, -1.0, 1.0)) / 3.0;
+  const double lambda = q + 2.0 * p * cos(phi + 2.0 * M_PI / 3.0);
+
+  const Vector r0(a[0] - lambda, a[1], a[2]);
+  const Vector r1(a[1], a[3] - lambda, a[4]);
+  const Vector r2(a[2], a[4], a[5] - lambda);
+  const Vector c[3] = { r0 / r1, r0 / r2, r1 / r2 };
+  int k = 0;
+  for (int i = 1; i < 3; i++)
+  {
+    if (SquaredNorm(c[i]) > SquaredNorm(c[k]))
+      k = i;
+  }
+  if (SquaredNorm(c[k]) > 1.0e-20 * p2 * p2)
+    return Normalized(c[k]);
+
+  // Double smallest eigenvalue, points along a line: any direction orthogonal to the line
+  Vector r = r0;
+  if (SquaredNorm(r1) > SquaredNorm(r))
+    r = r1;
+  if (SquaredNorm(r2) > SquaredNorm(r))
+    r = r2;
+  return Normalized(r.Orthogonal());
+}
+
+/*!
+\brief Estimate the normals from the k nearest neighbors of every point.
+
+The normal is the direction of least variance of the neighbors, that is the eigenvector of the smallest eigenvalue
+of their covariance matrix. Normals are then consistently oriented by propagation over the neighborhood graph.
+Neighborhoods are computed in parallel with a kd-tree.
+\param k Number of neighbors.
+
+After H. Hoppe, T. DeRose, T. Duchamp, J. McDonald and W. Stuetzle, <I>Surface reconstruction from unorganized points</I>, <B>SIGGRAPH</B>, 1992.
+*/
+void PointCloud::EstimateNormals(int k)
+{
+  const int n = Size();
+  if (n == 0)
+    return;
+  k = std::min(k, n);
+
+  const KdTree tree(Points());
+
+  nx.resize(n);
+  ny.resize(n);
+  nz.resize(n);
+  std::vector<int> graph(size_t(n) * k, -1);
+
+#pragma omp parallel
+  {
+    std::vector<int> neighbors;
+    std::vector<double> d;
+    // Points in leaf order for coherent queries
+#pragma omp for schedule(dynamic, 256)
+    for (int l = 0; l < n; l++)
+    {
+      const int i = tree.Order()[l];
+      const int m = tree.KNearest(Point(i), k, neighbors, d);
+      std::copy(neighbors.begin(), neighbors.begin() + m, graph.begin() + size_t(i) * k);
+
+      // Covariance, relative to the point for accuracy
+      const Vector o = Point(i);
+      Vector c = Vector::Null;
+      double a[6] = { 0.0 };
+      for (int j = 0; j < m; j++)
+      {
+        const Vector q = Point(neighbors[j]) - o;
+        c += q;
+        a[0] += q[0] * q[0];
+        a[1] += q[0] * q[1];
+        a[2] += q[0] * q[2];
+        a[3] += q[1] * q[1];
+        a[4] += q[1] * q[2];
+        a[5] += q[2] * q[2];
+      }
+      c /= m;
+      a[0] = a[0] / m - c[0] * c[0];
+      a[1] = a[1] / m - c[0] * c[1];
+      a[2] = a[2] / m - c[0] * c[2];
+      a[3] = a[3] / m - c[1] * c[1];
+      a[4] = a[4] / m - c[1] * c[2];
+      a[5] = a[5] / m - c[2] * c[2];
+
+      const Vector normal = Smallest(a);
+      nx[i] = float(normal[0]);
+      ny[i] = float(normal[1]);
+      nz[i] = float(normal[2]);
+    }
+  }
+
+  Orient(graph, k);
+}
+
+/*!
+\brief Consistently orient the normals.
+
+Orientation is propagated in breadth first order over the neighborhood graph, flipping the normals of
+neighbors that disagree with the normal of the point they are reached from. Every level of the traversal
+is processed in parallel. The normal of the first point of every connected component points away from the center of the cloud.
+\param graph Neighbors of every point, with a stride of k, -1 if missing.
+\param k Number of neighbors.
+*/
+void PointCloud::Orient(const std::vector<int>& graph, int k)
+{
+  const int n = Size();
+  const Vector center = GetBox().Center();
+
+  std::vector<int> visited(n, 0);
+  std::vector<int> front, next;
+  for (int s = 0; s < n; s++)
+  {
+    if (visited[s])
+      continue;
+
+    // Seed of a new component
+    visited[s] = 1;
+    if ((Point(s) - center) * Normal(s) < 0.0)
+    {
+      nx[s] = -nx[s];
+      ny[s] = -ny[s];
+      nz[s] = -nz[s];
+    }
+
+    front.assign(1, s);
+    while (!front.empty())
+    {
+      next.clear();
+#pragma omp parallel
+      {
+        std::vector<int> local;
+#pragma omp for schedule(dynamic, 256) nowait
+        for (int f = 0; f < int(front.size()); f++)
+        {
+          const int i = front[f];
+          for (int j = 0; j < k; j++)
+          {
+            const int e = graph[size_t(i) * k + j];
+            if (e < 0)
+              break;
+
+            // Claim the neighbor
+            int claimed;
+#pragma omp atomic capture
+            {
+              claimed = visited[e];
+              visited[e] = 1;
+            }
+            if (claimed)
+              continue;
+
+            if (nx[i] * nx[e] + ny[i] * ny[e] + nz[i] * nz[e] < 0.0f)
+            {
+              nx[e] = -nx[e];
+              ny[e] = -ny[e];
+              nz[e] = -nz[e];
+            }
+            local.push_back(e);
+          }
+        }
+#pragma omp critical
+        next.insert(next.end(), local.begin(), local.end());
+      }
+      front.swap(next);
+    }
+  }
+}
+
+/*!
+\class PointSetField pointcloud.h
+\brief An implicit surface reconstructed from a cloud of oriented points.
+
+The field is a partition of unity of the signed distances to the tangent planes of the points:
+every point defines a local linear approximation weighted by a compactly supported Wendland function,
+and the field is the normalized weighted sum of these approximations, also known as implicit moving least squares.
+The support radius of every point adapts to the local density: it is proportional to the distance to its k-th nearest neighbor.
+Neighbors are found with a kd-tree, and the field plugs directly into Polygonize(), which evaluates it in parallel.
+
+\code
+PointCloud cloud;
+cloud.Load("scan.ply");
+PointSetField field(cloud);
+Mesh mesh;
+field.Polygonize(256, mesh, field.GetBox());
+\endcode
+
+After C. Shen, J. F. O'Brien and J. R. Shewchuk, <I>Interpolating and approximating implicit surfaces from polygon soup</I>, <B>ACM Transactions on Graphics</B>, 23(3), 2004,
+and R. Kolluri, <I>Provably good moving least squares</I>, <B>ACM Transactions on Algorithms</B>, 4(2), 2008.
+*/
+
+/*!
+\brief Create the field of a point cloud.
+
+Normals are estimated if the cloud has none.
+\param c The point cloud.
+\param k Number of neighbors defining the support radius of the points.
+\param scale Scaling of the distance to the k-th neighbor.
+*/
+PointSetField::PointSetField(const PointCloud& c, int k, double scale) :cloud(c), tree(c.Points())
+{
+  if (!cloud.HasNormals())
+    cloud.EstimateNormals(std::max(k, 8));
+
+  const int n = cloud.Size();
+  r.resize(n);
+
+#pragma omp parallel
+  {
+    std::vector<int> neighbors;
+    std::vector<double> d;
+#pragma omp for schedule(dynamic, 256)
+    for (int l = 0; l < n; l++)
+    {
+      const int i = tree.Order()[l];
+      const int m = tree.KNearest(cloud.Point(i), k + 1, neighbors, d);
+      r[i] = float(scale * sqrt(d[m - 1]));
+    }
+  }
+
+  // Isolated outliers should not inflate the query radius
+  radius = 0.0;
+  if (n > 0)
+  {
+    std::vector<float> sorted = r;
+    std::nth_element(sorted.begin(), sorted.begin() + n / 2, sorted.end());
+    const float limit = 4.0f * sorted[n / 2];
+    for (int i = 0; i < n; i++)
+    {
+      r[i] = std::min(r[i], limit);
+      radius = std::max(radius, double(r[i]));
+    }
+  }
+
+  // Subset of points evenly spread in space, taken in leaf order
+  const int stride = std::max(1, n / 4096);
+  std::vector<Vector> points;
+  for (int l = 0; l < n; l += stride)
+  {
+    subset.push_back(tree.Order()[l]);
+    points.push_back(cloud.Point(subset.back()));
+  }
+  coarse = KdTree(points);
+}
+
+/*!
+\brief Compute the value of the field, negative inside.
+
+Far from the points, where no support overlaps, the field is the distance to the closest point of an evenly spread subset of the points,
+signed by its tangent plane.
+\param p Point.
+*/
+double PointSetField::Value(const Vector& p) const
+{
+  // Scratch buffer of every thread, the field is evaluated millions of times during polygonization
+  static thread_local std::vector<int> neighbors;
+  tree.Radius(p, radius, neighbors);
+
+  double w = 0.0, f = 0.0;
+  for (int j = 0; j < int(neighbors.size()); j++)
+  {
+    const int i = neighbors[j];
+    const Vector q = p - cloud.Point(i);
+    const double d = SquaredNorm(q);
+    if (d >= double(r[i]) * double(r[i]))
+      continue;
+
+    // Wendland function
+    const double t = sqrt(d) / r[i];
+    const double s = (1.0 - t) * (1.0 - t);
+    const double wi = s * s * (4.0 * t + 1.0);
+    w += wi;
+    f += wi * (q * cloud.Normal(i));
+  }
+  if (w > 0.0)
+    return f / w;
+
+  // Closest point of the subset, much faster than an exact search far from the surface
+  double d;
+  int i = coarse.Nearest(p, d);
+  if (i < 0)
+    return 1.0;
+  i = subset[i];
+  return ((p - cloud.Point(i)) * cloud.Normal(i) < 0.0) ? -d : d;
+}
+
+/*!
+\brief Return the box of the points enlarged by the largest support radius.
+*/
+Box PointSetField::GetBox() const
+{
+  Box box = cloud.GetBox();
+  const Vector e(radius);
+  return Box(box[0] - e, box[1] + e);
+}
@@ -52,6 +52,8 @@ MainWindow::MainWindow() : QMainWindow(), uiw(new Ui::Assets)
 
 MainWindow::~MainWindow()
 {
+    delete tracer;
+    delete contour;
     delete meshWidget;
 }
 
@@ -67,6 +69,7 @@ void MainWindow::CreateActions()
     connect(uiw->sphereImplicit, SIGNAL(clicked()), this, SLOT(SphereImplicitExample()));
     connect(uiw->mergedMesh, SIGNAL(clicked()), this, SLOT(MergedMeshExample()));
     connect(uiw->deformedMesh, SIGNAL(clicked()), this, SLOT(DeformedMeshExample()));
+    connect(uiw->pointCloud, SIGNAL(clicked()), this, SLOT(LoadPointCloud()));
     connect(uiw->resetcameraButton, SIGNAL(clicked()), this, SLOT(ResetCamera()));
     connect(uiw->wireframe, SIGNAL(clicked()), this, SLOT(UpdateMaterial()));
     connect(uiw->radioShadingButton_1, SIGNAL(clicked()), this, SLOT(UpdateMaterial()));
@@ -110,12 +113,26 @@ void MainWindow::CreateActions()
     connect(meshWidget, SIGNAL(_signalEditSceneRight(const Ray&)), this, SLOT(editingSceneRight(const Ray&)));
 }
 
-void MainWindow::editingSceneLeft(const Ray&)
+void MainWindow::editingSceneLeft(const Ray& ray)
 {
+    // Center the flattening on the picked point of the height field
+    int i, j;
+    if (tracer != nullptr && tracer->Pick(ray, i, j))
+    {
+        uiw->flattenX->setValue(i);
+        uiw->flattenY->setValue(j);
+    }
 }
 
-void MainWindow::editingSceneRight(const Ray&)
+void MainWindow::editingSceneRight(const Ray& ray)
 {
+    // Flatten brush at the picked point of the height field
+    int i, j;
+    if (tracer != nullptr && tracer->Pick(ray, i, j))
+    {
+        this->hf.flatten(i, j, this->flattenRadius, this->hf[i][j], 1);
+        UpdateHeightField();
+    }
 }
 
 void MainWindow::BoxMeshExample()
@@ -171,6 +188,18 @@ void MainWindow::CapsuleMeshExample()
     UpdateGeometry();
 }
 
+/*!
+\brief Index the vertices of a mesh, for warps visiting only the vertices in their sphere.
+\param mesh The mesh.
+*/
+static KdTree VertexTree(const Mesh& mesh)
+{
+    std::vector<Vector> vertices(mesh.Vertexes());
+    for (int i = 0; i < mesh.Vertexes(); i++)
+        vertices[i] = mesh.Vertex(i);
+    return KdTree(vertices);
+}
+
 void MainWindow::MergedMeshExample()
 {
     Mesh mergedMesh = Mesh();
@@ -198,9 +227,11 @@ void MainWindow::MergedMeshExample()
     Mesh capsuleMesh = Mesh(Capsule(2, 1), resolution);
     capsuleMesh.Translate(Vector(18, 0, 0));
 
+    // The spheres of the warps are disjoint and vertices move away from the other one, so the index stays valid
     Mesh deformedMesh = Mesh(Sphere(1), resolution);
-    deformedMesh.SphereWarp(Vector(1, 1, 1), 1.5, Vector(1, 1, 1));
-    deformedMesh.SphereWarp(Vector(-1, -1, -1), 1.5, Vector(1, 1, 1));
+    const KdTree deformedTree = VertexTree(deformedMesh);
+    deformedMesh.SphereWarp(deformedTree, Vector(1, 1, 1), 1.5, Vector(1, 1, 1));
+    deformedMesh.SphereWarp(deformedTree, Vector(-1, -1, -1), 1.5, Vector(1, 1, 1));
     Mesh deformedTorusMesh = Mesh(Torus(2, 0.25), resolution, resolution);
     deformedMesh.Merge(deformedTorusMesh);
     deformedMesh.Translate(Vector(9, 0, 0));
@@ -223,13 +254,38 @@ void MainWindow::MergedMeshExample()
 
 void MainWindow::DeformedMeshExample()
 {
+    // The spheres of the warps are disjoint and vertices move away from the other one, so the index stays valid
     Mesh sphereMesh = Mesh(Sphere(2), resolution);
-    sphereMesh.SphereWarp(Vector(1, 1, 1), 1.5, Vector(1, 1, 1));
-    sphereMesh.SphereWarp(Vector(-1, -1, -1), 1.5, Vector(1, 1, 1));
+    const KdTree tree = VertexTree(sphereMesh);
+    sphereMesh.SphereWarp(tree, Vector(1, 1, 1), 1.5, Vector(1, 1, 1));
+    sphereMesh.SphereWarp(tree, Vector(-1, -1, -1), 1.5, Vector(1, 1, 1));
     meshColor = MeshColor(sphereMesh);
     UpdateGeometry();
 }
 
+void MainWindow::LoadPointCloud()
+{
+    QString filename = QFileDialog::getOpenFileName(this, "Open point cloud", QDir::currentPath(), "Point clouds (*.xyz *.ply *.txt);;All files (*.*)");
+    if (filename.isEmpty())
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+    if (!cloud.Load(filename))
+        return;
+    if (!cloud.HasNormals())
+        cloud.EstimateNormals(16);
+
+    meshWidget->ClearAll();
+    meshWidget->AddPoints("Points", cloud);
+
+    uiw->lineEdit->setText(QString::number(cloud.Size()));
+    uiw->lineEdit_2->setText(QString::number(0));
+    uiw->lineEdit_3->setText(QString::number(timer.elapsed()));
+
+    UpdateMaterial();
+}
+
 void MainWindow::SphereImplicitExample()
 {
   AnalyticScalarField implicit;
@@ -252,6 +308,7 @@ void MainWindow::UpdateGeometry()
     timer.start();
     meshWidget->ClearAll();
     meshWidget->AddMesh("Mesh", meshColor);
+    meshWidget->SetSlice(meshColor);
 
     uiw->lineEdit->setText(QString::number(meshColor.Vertexes()));
     uiw->lineEdit_2->setText(QString::number(meshColor.Triangles()));
@@ -281,26 +338,54 @@ void MainWindow::LoadFile()
     this,
     "Open height field",
     QDir::currentPath(),
-    "All files (*.*);;PNG (*.png);;GIF (*.gif);;ICO (*.ico);;JPEG (*.jpeg);;JPG (*.jpg);;SVG (*.svg);;WBMP (*.wbmp);;WEBP (*.webp)"
+    "All files (*.*);;PNG (*.png);;GIF (*.gif);;ICO (*.ico);;JPEG (*.jpeg);;JPG (*.jpg);;SVG (*.svg);;WBMP (*.wbmp);;WEBP (*.webp);;16 bits heights (*.r16);;Float heights (*.raw);;ESRI ASCII grid (*.asc)"
   );
 
+  // Heights are unchanged if the file cannot be read, and the terrain still matches them
+  if (!this->hf.Load(filename))
+    return;
+
   // Set label to the file path and name
   uiw->fileInput->setText(filename);
 
-  QImage image = QImage(filename);
-
-  this->hf = HeightField(image);
+  // The terrain, its contours and the tracer reference the previous heights until generated again
+  meshWidget->ClearTerrain();
+  meshWidget->ClearContours();
+  delete tracer;
+  tracer = nullptr;
+  delete contour;
+  contour = nullptr;
 }
 
 void MainWindow::GenerateHeightField()
 {
-  meshColor = this->hf.generateMesh((double)this->maxHeight/50, (double)this->widthSize/500, this->slopeCoeff);
+  // Heights are displaced on the GPU, no mesh is generated
+  meshColor = MeshColor();
+  meshWidget->ClearAll();
+  meshWidget->SetTerrain(this->hf, (double)this->maxHeight/50, (double)this->widthSize/500, this->slopeCoeff);
+  this->hf.clearDirty();
+
+  // Nine contour heights, extracted in a single pass over the height field
+  const double heightMax = (double)this->maxHeight/50;
+  std::vector<double> levels;
+  for (int k = 1; k < 10; k++)
+    levels.push_back(k * heightMax / 10);
+  delete contour;
+  contour = new HeightFieldContour(this->hf, heightMax, (double)this->widthSize/500);
+  contour->SetLevels(levels);
+  UpdateContours();
+
+  delete tracer;
+  tracer = new HeightFieldTracer(this->hf, (double)this->maxHeight/50, (double)this->widthSize/500);
 
   uiw->flattenXSlider->setMaximum(this->hf.getWidth()-1);
   uiw->flattenX->setMaximum(this->hf.getWidth()-1);
   uiw->flattenYSlider->setMaximum(this->hf.getLength()-1);
   uiw->flattenY->setMaximum(this->hf.getLength()-1);
-  UpdateGeometry();
+
+  uiw->lineEdit->setText(QString::number(this->hf.getWidth() * this->hf.getLength()));
+  uiw->lineEdit_2->setText(QString::number(2 * (this->hf.getWidth() - 1) * (this->hf.getLength() - 1)));
+  UpdateMaterial();
 }
 
 void MainWindow::SetRotate(int degrees)
@@ -433,9 +518,36 @@ void MainWindow::SetFlattenRadius(int radius)
 
 void MainWindow::Flatten()
 {
-  if (this->hf.getWidth() != 0 && this->hf.getLength() != 0) {
+  // The sliders keep the range of the last generated height field
+  if (this->flattenX < this->hf.getWidth() && this->flattenY < this->hf.getLength()) {
     this->hf.flatten(this->flattenX, this->flattenY, this->flattenRadius, this->hf[flattenX][flattenY], 1);
-    GenerateHeightField();
-    UpdateGeometry();
+    UpdateHeightField();
   }
 }
+
+void MainWindow::UpdateHeightField()
+{
+  // Only upload the rectangle modified by brushes
+  int i, j, w, l;
+  if (!this->hf.getDirty(i, j, w, l))
+    return;
+  meshWidget->UpdateTerrain(this->hf, i, j, w, l);
+  if (tracer != nullptr)
+    tracer->Update(i, j, w, l);
+  if (contour != nullptr)
+  {
+    // Only the tiles covering the rectangle are extracted again
+    contour->Update(i, j, w, l);
+    UpdateContours();
+  }
+  this->hf.clearDirty();
+}
+
+void MainWindow::UpdateContours()
+{
+  // Stitch the pieces of the tiles
+  std::vector<std::vector<Vector>> polylines;
+  for (const std::vector<std::vector<Vector>>& lines : contour->Lines())
+    polylines.insert(polylines.end(), lines.begin(), lines.end());
+  meshWidget->SetContours(polylines);
+}
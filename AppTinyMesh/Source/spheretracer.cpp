@@ -0,0 +1,173 @@
+// SphereTracer
+
+#include "spheretracer.h"
+
+#include <algorithm>
+#include <chrono>
+
+/*!
+\class SphereTracer spheretracer.h
+\brief A renderer of implicit surfaces that does not polygonize them.
+
+Primary rays are marched with steps derived from the Lipschitz constant of the field,
+see AnalyticScalarField::SphereTrace(). The image is split into tiles processed in parallel.
+The rays of a tile are clipped against the bounding box of the surface at once as a ray packet,
+and tiles that miss the box are filled with the background without any field evaluation.
+
+\code
+AnalyticScalarField field;
+SphereTracer renderer(field, Box(2.0));
+QImage image = renderer.Render(camera, 1920, 1080);
+image.save("field.png");
+\endcode
+*/
+
+/*!
+\brief Create a renderer.
+\param field The field, it should outlive the renderer.
+\param box Box enclosing the surface.
+*/
+SphereTracer::SphereTracer(const AnalyticScalarField& field, const Box& box) :field(field), box(box)
+{
+}
+
+/*!
+\brief Set the precision of the intersections.
+\param e Epsilon.
+*/
+void SphereTracer::SetEpsilon(double e)
+{
+  epsilon = e;
+}
+
+/*!
+\brief Enable or disable shadows.
+\param s Boolean.
+*/
+void SphereTracer::SetShadows(bool s)
+{
+  shadows = s;
+}
+
+/*!
+\brief Render an image.
+\param camera The camera.
+\param w, h Size of the image.
+*/
+QImage SphereTracer::Render(const Camera& camera, int w, int h)
+{
+  auto start = std::chrono::high_resolution_clock::now();
+
+  QImage image(w, h, QImage::Format_RGB32);
+  QRgb* pixels = reinterpret_cast<QRgb*>(image.bits());
+
+  // Same box for all the rays of a tile
+  BoxPacket boxes(std::vector<Box>(Tile * Tile, box));
+
+  const int tx = (w + Tile - 1) / Tile;
+  const int ty = (h + Tile - 1) / Tile;
+  long long count = 0;
+
+#pragma omp parallel for schedule(dynamic, 1) reduction(+:count)
+  for (int i = 0; i < tx * ty; i++)
+  {
+    RenderTile(camera, (i % tx) * Tile, (i / tx) * Tile, w, h, boxes, pixels, count);
+  }
+
+  auto stop = std::chrono::high_resolution_clock::now();
+
+  rays = count;
+  seconds = std::chrono::duration<double>(stop - start).count();
+
+  return image;
+}
+
+/*!
+\brief Render a tile.
+\param camera The camera.
+\param x, y Corner of the tile.
+\param w, h Size of the image.
+\param boxes Packet with copies of the bounding box.
+\param pixels Pixels of the image.
+\param count Number of rays, incremented.
+*/
+void SphereTracer::RenderTile(const Camera& camera, int x, int y, int w, int h, const BoxPacket& boxes, QRgb* pixels, long long& count) const
+{
+  const int xb = std::min(x + Tile, w);
+  const int yb = std::min(y + Tile, h);
+
+  std::vector<Ray> r;
+  r.reserve(Tile * Tile);
+  for (int j = y; j < yb; j++)
+  {
+    for (int i = x; i < xb; i++)
+    {
+      r.push_back(camera.PixelToRay(i + 0.5, j + 0.5, w, h));
+    }
+  }
+
+  // Clip the whole tile against the box
+  RayPacket packet(r);
+  float tn[Tile * Tile], tf[Tile * Tile];
+  const int hits = Packet::Intersect(packet, boxes, tn, tf);
+
+  int k = 0;
+  for (int j = y; j < yb; j++)
+  {
+    QRgb* line = pixels + j * w;
+    for (int i = x; i < xb; i++, k++)
+    {
+      Color c = Background(r[k].Direction());
+
+      double t;
+      if (hits > 0 && tn[k] != float(Packet::Infinity))
+      {
+        count++;
+        if (field.SphereTrace(r[k], tn[k], tf[k], t, epsilon))
+        {
+          c = Shade(r[k], t, count);
+        }
+      }
+
+      line[i] = qRgb(int(255.0 * Math::Clamp(c[0])), int(255.0 * Math::Clamp(c[1])), int(255.0 * Math::Clamp(c[2])));
+    }
+  }
+}
+
+/*!
+\brief Compute the color of a point of the surface.
+\param ray The ray.
+\param t Intersection depth.
+\param count Number of rays, incremented.
+*/
+Color SphereTracer::Shade(const Ray& ray, double t, long long& count) const
+{
+  const Vector p = ray(t);
+  const Vector n = field.Normal(p);
+
+  // Diffuse and hemispherical ambient
+  double d = Math::Max(n * sun, 0.0);
+  if (d > 0.0 && shadows)
+  {
+    Ray shadow(p + n * (10.0 * epsilon), sun);
+    double ta, tb, ts;
+    count++;
+    if (box.Intersect(shadow, ta, tb) && field.SphereTrace(shadow, ta, tb, ts, epsilon))
+    {
+      d = 0.0;
+    }
+  }
+  double a = 0.5 + 0.5 * n[2];
+
+  Color albedo(0.85, 0.8, 0.7);
+  return albedo * (0.75 * d) + Color(0.25, 0.3, 0.4) * a;
+}
+
+/*!
+\brief Compute the color of the background.
+\param d Direction.
+*/
+Color SphereTracer::Background(const Vector& d) const
+{
+  return Color::Lerp(Math::Clamp(0.5 + 0.5 * d[2]), Color(0.75, 0.75, 0.8), Color(0.35, 0.5, 0.8));
+}
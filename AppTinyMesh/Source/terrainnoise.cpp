@@ -0,0 +1,355 @@
+// TerrainNoise
+
+#include "terrainnoise.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+/*!
+\class TerrainNoise terrainnoise.h
+\brief Procedural terrain from simplex noise, with fractal sums and domain warping.
+
+Heights are fractal sums of octaves of two dimensional simplex noise, either fractional Brownian motion or
+ridged multifractal, optionally evaluated at coordinates displaced by another fractal sum (domain warping).
+Heights are in [0, 1].
+
+The lattice is a permutation shuffled from the seed with a Mersenne twister, so that a seed produces the same terrain
+on every platform. Every sample only depends on its global coordinates, so that tiles of a large terrain can be
+generated independently and stitched without seams. Rows are evaluated by chunks in single precision, with the
+octaves of a chunk vectorized across samples, and tiles are generated in parallel.
+
+\code
+TerrainNoise noise(42);
+noise.SetFractal(TerrainNoise::Ridged, 10);
+noise.SetWarp(0.5);
+HeightField hf(2048, 2048);
+noise.Generate(hf);
+\endcode
+*/
+
+/*!
+\brief Simplex noise kernel, following the simplex noise of Gustavson, in single or double precision.
+
+Written without branches on the sample, so that loops over samples are vectorized with gathers in the permutation.
+\param perm Permutation of the lattice.
+\param x, y Point.
+*/
+template<typename T>
+static inline T Kernel(const int* perm, T x, T y)
+{
+  const T F2 = T(0.36602540378443865); // (sqrt(3) - 1) / 2
+  const T G2 = T(0.21132486540518713); // (3 - sqrt(3)) / 6
+
+  // Skew to find the cell of the simplex lattice
+  const T s = (x + y) * F2;
+  const T xs = x + s, ys = y + s;
+  const int i = int(xs) - (xs < T(int(xs)) ? 1 : 0);
+  const int j = int(ys) - (ys < T(int(ys)) ? 1 : 0);
+
+  // Unskew to the corners of the triangle
+  const T t = T(i + j) * G2;
+  const T x0 = x - (T(i) - t), y0 = y - (T(j) - t);
+  const int i1 = (x0 > y0) ? 1 : 0, j1 = 1 - i1;
+  const T x1 = x0 - T(i1) + G2, y1 = y0 - T(j1) + G2;
+  const T x2 = x0 - T(1) + T(2) * G2, y2 = y0 - T(1) + T(2) * G2;
+
+  const int ii = i & 255, jj = j & 255;
+  const int h[3] = { perm[ii + perm[jj]] & 7, perm[ii + i1 + perm[jj + j1]] & 7, perm[ii + 1 + perm[jj + 1]] & 7 };
+  const T dx[3] = { x0, x1, x2 }, dy[3] = { y0, y1, y2 };
+
+  T n = T(0);
+  for (int k = 0; k < 3; k++)
+  {
+    // One of 8 gradients
+    const T u = (h[k] < 4) ? dx[k] : dy[k];
+    const T v = (h[k] < 4) ? dy[k] : dx[k];
+    const T g = ((h[k] & 1) ? -u : u) + ((h[k] & 2) ? T(-2) * v : T(2) * v);
+
+    T a = T(0.5) - dx[k] * dx[k] - dy[k] * dy[k];
+    a = (a > T(0)) ? a : T(0);
+    a *= a;
+    n += a * a * g;
+  }
+  return T(40) * n;
+}
+
+/*!
+\brief Create a noise with a lattice permuted from a seed.
+\param seed Seed.
+*/
+TerrainNoise::TerrainNoise(std::uint32_t seed)
+{
+  for (int i = 0; i < 256; i++)
+    perm[i] = i;
+
+  // Explicit shuffle, since std::shuffle differs between standard libraries
+  std::mt19937 random(seed);
+  for (int i = 255; i > 0; i--)
+    std::swap(perm[i], perm[random() % std::uint32_t(i + 1)]);
+
+  for (int i = 0; i < 256; i++)
+    perm[256 + i] = perm[i];
+}
+
+/*!
+\brief Set the fractal sum.
+\param f Fractal sum.
+\param n Number of octaves.
+\param l Lacunarity, the frequency ratio between octaves.
+\param g Gain, the amplitude ratio between octaves.
+*/
+void TerrainNoise::SetFractal(Fractal f, int n, double l, double g)
+{
+  fractal = f;
+  octaves = std::max(n, 1);
+  lacunarity = l;
+  gain = g;
+}
+
+/*!
+\brief Compute the two dimensional simplex noise, in [-1, 1].
+\param perm Permutation of the lattice, repeated twice.
+\param x, y Point.
+*/
+double TerrainNoise::Simplex(const int* perm, double x, double y)
+{
+  return Kernel<double>(perm, x, y);
+}
+
+/*!
+\brief Compute the fractal sum at a point, in [0, 1].
+
+Octaves are shifted so that their lattices do not align at the origin.
+\param x, y Point, in units of the first octave.
+*/
+double TerrainNoise::Sum(double x, double y) const
+{
+  double sum = 0.0, total = 0.0, amplitude = 1.0, f = 1.0, weight = 1.0;
+  for (int o = 0; o < octaves; o++)
+  {
+    const double n = Kernel<double>(perm, x * f + 19.19 * o, y * f + 7.73 * o);
+    if (fractal == FBm)
+    {
+      sum += amplitude * (0.5 + 0.5 * n);
+    }
+    else
+    {
+      // Sharp ridges along the zero crossings, weighted by the previous octave so that valleys stay smooth
+      double r = 1.0 - std::abs(n);
+      r *= r * weight;
+      weight = Math::Clamp(2.0 * r);
+      sum += amplitude * r;
+    }
+    total += amplitude;
+    amplitude *= gain;
+    f *= lacunarity;
+  }
+  return sum / total;
+}
+
+/*!
+\brief Compute the fractal sum at a set of points, in single precision.
+
+Octaves are evaluated one after the other on all the points, so that the kernel is vectorized across points.
+\param x, y Points, in units of the first octave.
+\param n Number of points, at most Tile.
+\param h Returned sums.
+*/
+void TerrainNoise::Sum(const float* x, const float* y, int n, float* h) const
+{
+  float weight[Tile];
+  std::fill(h, h + n, 0.0f);
+  std::fill(weight, weight + n, 1.0f);
+
+  const int* p = perm;
+  double total = 0.0, amplitude = 1.0, f = 1.0;
+  for (int o = 0; o < octaves; o++)
+  {
+    const float a = float(amplitude), s = float(f), ox = float(19.19 * o), oy = float(7.73 * o);
+    if (fractal == FBm)
+    {
+#pragma omp simd
+      for (int k = 0; k < n; k++)
+      {
+        h[k] += a * (0.5f + 0.5f * Kernel<float>(p, x[k] * s + ox, y[k] * s + oy));
+      }
+    }
+    else
+    {
+#pragma omp simd
+      for (int k = 0; k < n; k++)
+      {
+        float r = 1.0f - std::abs(Kernel<float>(p, x[k] * s + ox, y[k] * s + oy));
+        r *= r * weight[k];
+        weight[k] = std::min(std::max(2.0f * r, 0.0f), 1.0f);
+        h[k] += a * r;
+      }
+    }
+    total += amplitude;
+    amplitude *= gain;
+    f *= lacunarity;
+  }
+
+  const float scale = float(1.0 / total);
+#pragma omp simd
+  for (int k = 0; k < n; k++)
+  {
+    h[k] *= scale;
+  }
+}
+
+/*!
+\brief Compute the height at a sample, in [0, 1], in double precision.
+
+Coordinates need not be integers, which makes the noise continuous.
+\param i, j Sample.
+*/
+double TerrainNoise::Value(double i, double j) const
+{
+  double x = i * frequency, y = j * frequency;
+  if (warp != 0.0)
+  {
+    const double qx = Sum(x + 5.2, y + 1.3), qy = Sum(x + 1.7, y + 9.2);
+    x += warp * (2.0 * qx - 1.0);
+    y += warp * (2.0 * qy - 1.0);
+  }
+  return Sum(x, y);
+}
+
+/*!
+\brief Compute a bound of the variation of the height between two samples, the Lipschitz constant of Value().
+
+The bound is the sum over octaves of the bounds of the gradient of the kernel, which makes it conservative.
+*/
+double TerrainNoise::K() const
+{
+  // Bound of the gradient of the simplex kernel
+  const double kernel = 6.6;
+
+  double sum = 0.0, total = 0.0, amplitude = 1.0, f = 1.0;
+  for (int o = 0; o < octaves; o++)
+  {
+    sum += amplitude * f;
+    total += amplitude;
+    amplitude *= gain;
+    f *= lacunarity;
+  }
+  // Heights are halved noise for fBm, and squared ridges double the slope
+  const double k = kernel * sum / total * ((fractal == FBm) ? 0.5 : 2.0);
+  return frequency * k * (1.0 + 2.0 * warp * k);
+}
+
+/*!
+\brief Compute the heights of consecutive samples of a row, in single precision.
+
+The result only depends on the global coordinates of the samples, so that rows may be split arbitrarily.
+\param i Row.
+\param j First sample of the row.
+\param n Number of samples.
+\param h Returned heights.
+*/
+void TerrainNoise::Row(int i, int j, int n, float* h) const
+{
+  float x[Tile], y[Tile], qx[Tile], qy[Tile], wx[Tile], wy[Tile];
+  const float fx = float(double(i) * frequency);
+  const float w = float(warp);
+
+  for (int c = 0; c < n; c += Tile)
+  {
+    const int m = std::min(Tile, n - c);
+#pragma omp simd
+    for (int k = 0; k < m; k++)
+    {
+      x[k] = fx;
+      y[k] = float(double(j + c + k) * frequency);
+    }
+
+    if (warp == 0.0)
+    {
+      Sum(x, y, m, h + c);
+      continue;
+    }
+
+    // Displace the points by two other fractal sums
+#pragma omp simd
+    for (int k = 0; k < m; k++)
+    {
+      wx[k] = x[k] + 5.2f;
+      wy[k] = y[k] + 1.3f;
+    }
+    Sum(wx, wy, m, qx);
+#pragma omp simd
+    for (int k = 0; k < m; k++)
+    {
+      wx[k] = x[k] + 1.7f;
+      wy[k] = y[k] + 9.2f;
+    }
+    Sum(wx, wy, m, qy);
+#pragma omp simd
+    for (int k = 0; k < m; k++)
+    {
+      wx[k] = x[k] + w * (2.0f * qx[k] - 1.0f);
+      wy[k] = y[k] + w * (2.0f * qy[k] - 1.0f);
+    }
+    Sum(wx, wy, m, h + c);
+  }
+}
+
+/*!
+\brief Fill a height field, or a tile of a larger terrain, by tiles in parallel.
+\param hf The height field.
+\param i, j Global coordinates of the first sample of the height field, zero unless it is a tile of a larger terrain.
+*/
+void TerrainNoise::Generate(HeightField& hf, int i, int j) const
+{
+  const int width = hf.getWidth(), length = hf.getLength();
+  const int tw = (width + Tile - 1) / Tile, tl = (length + Tile - 1) / Tile;
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int t = 0; t < tw * tl; t++)
+  {
+    const int x0 = (t / tl) * Tile, y0 = (t % tl) * Tile;
+    const int x1 = std::min(x0 + Tile, width), n = std::min(Tile, length - y0);
+    for (int x = x0; x < x1; x++)
+    {
+      Row(i + x, j + y0, n, hf[x] + y0);
+    }
+  }
+}
+
+/*!
+\class NoiseField terrainnoise.h
+\brief Terrain defined as the region below a procedural height, as a building block of implicit surfaces.
+
+The field is the vertical distance to the terrain, negative below, so that it may be blended or combined with other
+fields, and sphere traced with the Lipschitz constant derived from the noise.
+*/
+
+/*!
+\brief Create the field.
+\param noise Procedural height.
+\param scale Size of a sample of the noise.
+\param height Height scale.
+*/
+NoiseField::NoiseField(const TerrainNoise& noise, double scale, double height) :noise(noise), scale(scale), height(height)
+{
+}
+
+/*!
+\brief Compute the vertical distance to the terrain.
+\param p Point.
+*/
+double NoiseField::Value(const Vector& p) const
+{
+  return p[2] - height * noise.Value(p[0] / scale, p[1] / scale);
+}
+
+/*!
+\brief Return the Lipschitz constant of the field.
+*/
+double NoiseField::K() const
+{
+  const double k = height * noise.K() / scale;
+  return sqrt(1.0 + k * k);
+}
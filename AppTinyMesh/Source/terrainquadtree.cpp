@@ -0,0 +1,267 @@
+// TerrainQuadtree
+
+#include "terrainquadtree.h"
+
+#include <algorithm>
+#include <cmath>
+
+/*!
+\class TerrainQuadtree terrainquadtree.h
+\brief Quadtree of the patches of a height field, for level of detail rendering.
+
+A node at level k covers size x size squares whose vertices are 2<sup>k</sup> samples apart, and stores
+the range of its heights and a bound of the vertical error between the height field and the triangles of the node,
+or of any of its descendants. Every frame, the tree is traversed from its roots, nodes outside the view frustum
+are culled against their bounding boxes, and nodes are refined until their error projects to less than a given
+number of pixels. The number of selected patches depends on the resolution of the screen, not on the size of the terrain.
+
+Cracks between patches of different levels are hidden by skirts, hanging from the border of patches by the error of their parent.
+
+\code
+TerrainQuadtree quadtree(hf, 32, heightMax, squareSize);
+std::vector<TerrainQuadtree::Tile> tiles;
+quadtree.Select(camera, width, height, 2.0, tiles); // At most two pixels of error
+\endcode
+*/
+
+/*!
+\brief Create the quadtree of a height field.
+\param hf The height field.
+\param size Number of squares along the side of a patch.
+\param heightMax Height scale.
+\param squareSize Size of a square of the grid.
+*/
+TerrainQuadtree::TerrainQuadtree(const HeightField& hf, int size, double heightMax, double squareSize) :width(hf.getWidth()), length(hf.getLength()), size(size), heightMax(heightMax), squareSize(squareSize)
+{
+  // Levels up to a single node covering the grid
+  const int squares = std::max(std::max(width, length) - 1, 1);
+  int levels = 1;
+  while ((size << (levels - 1)) < squares)
+    levels++;
+
+  rows.resize(levels);
+  columns.resize(levels);
+  nodes.resize(levels);
+  for (int k = 0; k < levels; k++)
+  {
+    const int side = size << k;
+    rows[k] = std::max((width - 1 + side - 1) / side, 1);
+    columns[k] = std::max((length - 1 + side - 1) / side, 1);
+    nodes[k].resize(size_t(rows[k]) * columns[k]);
+  }
+
+  Update(hf, 0, 0, width, length);
+}
+
+/*!
+\brief Update the nodes covering a rectangle of modified heights.
+\param hf The height field, with the same size.
+\param i, j First modified height.
+\param w, l Size of the rectangle.
+*/
+void TerrainQuadtree::Update(const HeightField& hf, int i, int j, int w, int l)
+{
+  const int i0 = std::max(i, 0), j0 = std::max(j, 0);
+  const int i1 = std::min(i + w, width) - 1, j1 = std::min(j + l, length) - 1;
+  if (i1 < i0 || j1 < j0)
+    return;
+
+  // Finest level first, since nodes depend on their children; nodes sharing the border of the rectangle are included
+  for (int k = 0; k < Levels(); k++)
+  {
+    const int side = size << k;
+    const int x0 = std::max((i0 - 1) / side, 0), x1 = std::min(i1 / side, rows[k] - 1);
+    const int y0 = std::max((j0 - 1) / side, 0), y1 = std::min(j1 / side, columns[k] - 1);
+    const int n = (x1 - x0 + 1) * (y1 - y0 + 1);
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int m = 0; m < n; m++)
+    {
+      Evaluate(hf, k, x0 + m / (y1 - y0 + 1), y0 + m % (y1 - y0 + 1));
+    }
+  }
+}
+
+/*!
+\brief Compute the range and the error of a node.
+
+Only the nodes of the finest level scan their samples, and their error is null. The range of a node above is the union
+of the ranges of its children. The triangles of the children subdivide the triangles of the node, since they are split
+along the same diagonal, so that the difference between both is linear over the triangles of the children. The error of
+the node is bounded by the error of its children plus the deviation of their vertices from the triangles of the node.
+\param hf The height field.
+\param k Level.
+\param x, y Node.
+*/
+void TerrainQuadtree::Evaluate(const HeightField& hf, int k, int x, int y)
+{
+  const int step = 1 << k;
+  const int i0 = x * size * step, j0 = y * size * step;
+  const int i1 = std::min(i0 + size * step, width - 1), j1 = std::min(j0 + size * step, length - 1);
+
+  if (k == 0)
+  {
+    float a = hf[i0][j0], b = a;
+    for (int i = i0; i <= i1; i++)
+    {
+      const float* row = hf[i];
+      for (int j = j0; j <= j1; j++)
+      {
+        a = std::min(a, row[j]);
+        b = std::max(b, row[j]);
+      }
+    }
+    nodes[k][size_t(x) * columns[k] + y] = Node{ a, b, 0.0f };
+    return;
+  }
+
+  // Children
+  float a = hf[i0][j0], b = a, error = 0.0f;
+  for (int cx = 2 * x; cx <= std::min(2 * x + 1, rows[k - 1] - 1); cx++)
+  {
+    for (int cy = 2 * y; cy <= std::min(2 * y + 1, columns[k - 1] - 1); cy++)
+    {
+      const Node& child = nodes[k - 1][size_t(cx) * columns[k - 1] + cy];
+      a = std::min(a, child.a);
+      b = std::max(b, child.b);
+      error = std::max(error, child.error);
+    }
+  }
+
+  // Deviation of the vertices of the children, which are clamped to the grid
+  const int half = step / 2;
+  float deviation = 0.0f;
+  for (int i = i0; i <= i1; i = (i == i1) ? i1 + 1 : std::min(i + half, i1))
+  {
+    const float* row = hf[i];
+
+    // Coarse cell of the row, vertices are clamped to the grid
+    const int ia = i0 + (i - i0) / step * step, ib = std::min(ia + step, i1);
+    const float s = (ib > ia) ? float(i - ia) / float(ib - ia) : 0.0f;
+    const float* ra = hf[ia];
+    const float* rb = hf[ib];
+    for (int j = j0; j <= j1; j = (j == j1) ? j1 + 1 : std::min(j + half, j1))
+    {
+      const int ja = j0 + (j - j0) / step * step, jb = std::min(ja + step, j1);
+      const float t = (jb > ja) ? float(j - ja) / float(jb - ja) : 0.0f;
+      const float h = (t >= s) ? ra[ja] + t * (ra[jb] - ra[ja]) + s * (rb[jb] - ra[jb]) : ra[ja] + s * (rb[ja] - ra[ja]) + t * (rb[jb] - rb[ja]);
+      deviation = std::max(deviation, std::abs(row[j] - h));
+    }
+  }
+
+  nodes[k][size_t(x) * columns[k] + y] = Node{ a, b, error + deviation };
+}
+
+/*!
+\brief Compute the bounding box of a node, in the frame of the rendered terrain.
+\param k Level.
+\param x, y Node.
+*/
+Box TerrainQuadtree::GetBox(int k, int x, int y) const
+{
+  const Node& node = nodes[k][size_t(x) * columns[k] + y];
+  const int side = size << k;
+  const int i0 = x * side, j0 = y * side;
+  const int i1 = std::min(i0 + side, width - 1), j1 = std::min(j0 + side, length - 1);
+  const double s = squareSize;
+  return Box(Vector(i0 * s - 0.5 * width * s, (length - j1) * s - 0.5 * length * s, node.a * heightMax),
+    Vector(i1 * s - 0.5 * width * s, (length - j0) * s - 0.5 * length * s, node.b * heightMax));
+}
+
+/*!
+\brief Check if a box intersects the view frustum, conservatively.
+\param frustum The frustum.
+\param box The box.
+*/
+bool TerrainQuadtree::Visible(const Frustum& frustum, const Box& box)
+{
+  for (int p = 0; p < 5; p++)
+  {
+    // Corner of the box farthest along the normal of the plane
+    const Vector& n = frustum.planes[p];
+    const Vector c(n[0] > 0.0 ? box[1][0] : box[0][0], n[1] > 0.0 ? box[1][1] : box[0][1], n[2] > 0.0 ? box[1][2] : box[0][2]);
+    const double d = (p == 4) ? frustum.near : 0.0;
+    if (n * (c - frustum.eye) < d)
+      return false;
+  }
+
+  // Far plane, with the nearest corner
+  const Vector& n = frustum.planes[4];
+  const Vector c(n[0] > 0.0 ? box[0][0] : box[1][0], n[1] > 0.0 ? box[0][1] : box[1][1], n[2] > 0.0 ? box[0][2] : box[1][2]);
+  return n * (c - frustum.eye) <= frustum.far;
+}
+
+/*!
+\brief Select the patches to render.
+\param camera The camera.
+\param w, h Size of the viewport, in pixels.
+\param tolerance Maximal screen space error, in pixels.
+\param tiles Selected patches.
+*/
+void TerrainQuadtree::Select(const Camera& camera, int w, int h, double tolerance, std::vector<Tile>& tiles) const
+{
+  tiles.clear();
+
+  // Frame of the camera, as in Camera::PixelToRay()
+  const Vector view = Normalized(camera.View());
+  const Vector horizontal = Normalized(view / camera.Up());
+  const Vector vertical = Normalized(horizontal / view);
+  const double tv = tan(camera.GetAngleOfViewV(w, h) / 2.0);
+  const double th = tv * double(w) / double(h);
+
+  Frustum frustum;
+  frustum.eye = camera.Eye();
+  frustum.planes[0] = th * view + horizontal;
+  frustum.planes[1] = th * view - horizontal;
+  frustum.planes[2] = tv * view + vertical;
+  frustum.planes[3] = tv * view - vertical;
+  frustum.planes[4] = view;
+  frustum.near = camera.GetNear();
+  frustum.far = camera.GetFar();
+  frustum.pixels = 0.5 * double(h) / tv;
+
+  const int top = Levels() - 1;
+  for (int x = 0; x < rows[top]; x++)
+  {
+    for (int y = 0; y < columns[top]; y++)
+    {
+      const float error = nodes[top][size_t(x) * columns[top] + y].error;
+      Select(frustum, tolerance, top, x, y, float(error * heightMax), tiles);
+    }
+  }
+}
+
+/*!
+\brief Select the patches of a node.
+\param frustum The frustum.
+\param tolerance Maximal screen space error, in pixels.
+\param k Level.
+\param x, y Node.
+\param skirt Depth of the skirts, the error of the parent.
+\param tiles Selected patches.
+*/
+void TerrainQuadtree::Select(const Frustum& frustum, double tolerance, int k, int x, int y, float skirt, std::vector<Tile>& tiles) const
+{
+  const Box box = GetBox(k, x, y);
+  if (!Visible(frustum, box))
+    return;
+
+  // Projected error at the nearest point of the box
+  const Node& node = nodes[k][size_t(x) * columns[k] + y];
+  const double error = node.error * heightMax;
+  const double distance = Norm(frustum.eye - Vector::Min(Vector::Max(frustum.eye, box[0]), box[1]));
+  if (k == 0 || error * frustum.pixels <= tolerance * distance)
+  {
+    const int step = 1 << k;
+    tiles.push_back(Tile{ float(x * size * step), float(y * size * step), float(step), std::max(skirt, float(error)) });
+    return;
+  }
+
+  for (int cx = 2 * x; cx <= std::min(2 * x + 1, rows[k - 1] - 1); cx++)
+  {
+    for (int cy = 2 * y; cy <= std::min(2 * y + 1, columns[k - 1] - 1); cy++)
+    {
+      Select(frustum, tolerance, k - 1, cx, cy, float(error), tiles);
+    }
+  }
+}
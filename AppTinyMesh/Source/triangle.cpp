@@ -96,6 +96,89 @@ bool Triangle::Intersect(const Ray& ray, double& t, double& u, double& v) const
   return true;
 }
 
+/*!
+\brief Compute the closest point of the triangle to a given point.
+
+Barycentric coordinates are exactly 0 or 1 when the closest point is on an edge or a vertex,
+which identifies the feature of the triangle.
+
+After Christer Ericson, <I>Real-Time Collision Detection</I>, Morgan Kaufmann, 2004.
+
+\param q Point.
+\param u,v Parametric coordinates of the closest point in the triangle.
+\sa Triangle::Vertex(double, double) const
+*/
+Vector Triangle::Closest(const Vector& q, double& u, double& v) const
+{
+  const Vector ab = p[1] - p[0];
+  const Vector ac = p[2] - p[0];
+
+  // Vertex region of p[0]
+  const Vector ap = q - p[0];
+  const double d1 = ab * ap;
+  const double d2 = ac * ap;
+  if (d1 <= 0.0 && d2 <= 0.0)
+  {
+    u = v = 0.0;
+    return p[0];
+  }
+
+  // Vertex region of p[1]
+  const Vector bp = q - p[1];
+  const double d3 = ab * bp;
+  const double d4 = ac * bp;
+  if (d3 >= 0.0 && d4 <= d3)
+  {
+    u = 1.0;
+    v = 0.0;
+    return p[1];
+  }
+
+  // Edge region of [p[0],p[1]]
+  const double vc = d1 * d4 - d3 * d2;
+  if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+  {
+    u = d1 / (d1 - d3);
+    v = 0.0;
+    return p[0] + u * ab;
+  }
+
+  // Vertex region of p[2]
+  const Vector cp = q - p[2];
+  const double d5 = ab * cp;
+  const double d6 = ac * cp;
+  if (d6 >= 0.0 && d5 <= d6)
+  {
+    u = 0.0;
+    v = 1.0;
+    return p[2];
+  }
+
+  // Edge region of [p[0],p[2]]
+  const double vb = d5 * d2 - d1 * d6;
+  if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+  {
+    u = 0.0;
+    v = d2 / (d2 - d6);
+    return p[0] + v * ac;
+  }
+
+  // Edge region of [p[1],p[2]]
+  const double va = d3 * d6 - d5 * d4;
+  if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0)
+  {
+    v = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+    u = 1.0 - v;
+    return p[1] + v * (p[2] - p[1]);
+  }
+
+  // Inside the face
+  const double denom = 1.0 / (va + vb + vc);
+  u = vb * denom;
+  v = vc * denom;
+  return p[0] + u * ab + v * ac;
+}
+
 /*!
 \brief Translates a triangle by a given vector.
 
@@ -0,0 +1,706 @@
+// Voxel
+
+#include "voxel.h"
+#include "meshdistance.h"
+
+#include <algorithm>
+#include <bitset>
+
+/*!
+\class VoxelGrid voxel.h
+\brief A binary voxel grid over a box, with cubic voxels.
+
+Voxels are packed in bricks of 8<SUP>3</SUP> voxels, one bit per voxel. Sparse grids only allocate the bricks
+that contain set voxels, which keeps the memory of surface voxelizations proportional to the area of the surface.
+Dense grids allocate every brick up front.
+
+Meshes are voxelized in parallel: triangles are binned into layers of bricks along z, and every layer is processed
+by a single thread, so that threads never write to the same brick.
+
+The surface mode is conservative: every voxel overlapping a triangle is set. The triangle-box overlap test
+is the plane and projected edges test of Schwarz and Seidel, evaluated incrementally along rows of voxels so that
+the inner loop is vectorized.
+
+The solid mode sets voxels whose center lies inside the mesh, by parity of the crossings along x.
+
+After Michael Schwarz and Hans-Peter Seidel, <I>Fast parallel surface and solid voxelization on GPUs</I>,
+<B>ACM Transactions on Graphics</B>, 29(6), 2010.
+
+\code
+VoxelGrid grid(mesh.GetBox(), 1024);
+grid.Voxelize(mesh, VoxelGrid::Mode::Solid);
+double v = grid.Volume();
+\endcode
+*/
+
+/*!
+\brief Create an empty grid.
+
+The box is enlarged along its shortest sides so that voxels are cubes.
+\param b The box.
+\param n Number of voxels along the longest side of the box.
+\param s Sparse storage.
+*/
+VoxelGrid::VoxelGrid(const Box& b, int n, bool s) :sparse(s)
+{
+  const Vector diagonal = b.Diagonal();
+  size = Math::Max(diagonal[0], diagonal[1], diagonal[2]) / n;
+  nx = std::max(1, int(ceil(diagonal[0] / size - 1.0e-6)));
+  ny = std::max(1, int(ceil(diagonal[1] / size - 1.0e-6)));
+  nz = std::max(1, int(ceil(diagonal[2] / size - 1.0e-6)));
+  box = Box(b[0], b[0] + Vector(nx * size, ny * size, nz * size));
+
+  bx = (nx + 7) / 8;
+  by = (ny + 7) / 8;
+  bz = (nz + 7) / 8;
+
+  Clear();
+}
+
+/*!
+\brief Clear all voxels.
+*/
+void VoxelGrid::Clear()
+{
+  index.assign(bz, std::vector<int>(bx * by, -1));
+  layers.assign(bz, std::vector<Brick>());
+
+  if (!sparse)
+  {
+    for (int l = 0; l < bz; l++)
+    {
+      layers[l].resize(bx * by);
+      for (int i = 0; i < bx * by; i++)
+      {
+        index[l][i] = i;
+      }
+    }
+  }
+}
+
+/*!
+\brief Return a brick of a layer, allocate it if needed.
+\param i,j Integer coordinates of the brick in the layer.
+\param bricks Bricks of the layer.
+\param idx Indexes of the bricks of the layer.
+*/
+VoxelGrid::Brick& VoxelGrid::GetBrick(int i, int j, std::vector<Brick>& bricks, std::vector<int>& idx) const
+{
+  int& b = idx[j * bx + i];
+  if (b < 0)
+  {
+    b = int(bricks.size());
+    bricks.push_back(Brick());
+  }
+  return bricks[b];
+}
+
+/*!
+\brief Set a voxel.
+
+This function is not thread safe.
+\param i,j,k Integer coordinates of the voxel.
+*/
+void VoxelGrid::Set(int i, int j, int k)
+{
+  Brick& brick = GetBrick(i >> 3, j >> 3, layers[k >> 3], index[k >> 3]);
+  brick.bits[k & 7] |= uint64_t(1) << ((i & 7) + 8 * (j & 7));
+}
+
+/*!
+\brief Count the set voxels.
+*/
+long long VoxelGrid::Count() const
+{
+  long long c = 0;
+  for (int l = 0; l < bz; l++)
+  {
+    for (int b = 0; b < int(layers[l].size()); b++)
+    {
+      for (int k = 0; k < 8; k++)
+      {
+        c += std::bitset<64>(layers[l][b].bits[k]).count();
+      }
+    }
+  }
+  return c;
+}
+
+/*!
+\brief Return the number of allocated bricks.
+*/
+int VoxelGrid::Bricks() const
+{
+  int c = 0;
+  for (int l = 0; l < bz; l++)
+  {
+    c += int(layers[l].size());
+  }
+  return c;
+}
+
+/*!
+\brief Return the memory used by the grid, in bytes.
+*/
+long long VoxelGrid::Memory() const
+{
+  return (long long)(Bricks()) * sizeof(Brick) + (long long)(bx) * by * bz * sizeof(int);
+}
+
+/*!
+\brief Bin the triangles into the layers of bricks they overlap.
+\param mesh The mesh.
+*/
+std::vector<std::vector<int>> VoxelGrid::Bin(const Mesh& mesh) const
+{
+  std::vector<std::vector<int>> bins(bz);
+  for (int t = 0; t < mesh.Triangles(); t++)
+  {
+    Box tb = mesh.GetTriangle(t).GetBox();
+    int ka = int(floor((tb[0][2] - box[0][2]) / size)) >> 3;
+    int kb = int(floor((tb[1][2] - box[0][2]) / size)) >> 3;
+    ka = std::max(ka, 0);
+    kb = std::min(kb, bz - 1);
+    for (int l = ka; l <= kb; l++)
+    {
+      bins[l].push_back(t);
+    }
+  }
+  return bins;
+}
+
+/*!
+\brief Voxelize a mesh, voxels are added to those already set.
+\param mesh The mesh, closed for the solid mode.
+\param mode Voxelization mode.
+*/
+void VoxelGrid::Voxelize(const Mesh& mesh, Mode mode)
+{
+  const std::vector<std::vector<int>> bins = Bin(mesh);
+
+  if (mode == Mode::Surface)
+    Surface(mesh, bins);
+  else
+    Solid(mesh, bins);
+}
+
+/*!
+\brief Conservative surface voxelization.
+\param mesh The mesh.
+\param bins Triangles overlapping every layer of bricks.
+*/
+void VoxelGrid::Surface(const Mesh& mesh, const std::vector<std::vector<int>>& bins)
+{
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int l = 0; l < bz; l++)
+  {
+    std::vector<Brick>& bricks = layers[l];
+    std::vector<int>& idx = index[l];
+    std::vector<char> mask(nx);
+
+    for (int t : bins[l])
+    {
+      const Triangle triangle = mesh.GetTriangle(t);
+
+      // Coordinates relative to the lower corner of the grid
+      const Vector v[3] = { triangle[0] - box[0], triangle[1] - box[0], triangle[2] - box[0] };
+      const Vector e[3] = { v[1] - v[0], v[2] - v[1], v[0] - v[2] };
+      const Vector n = e[0] / (v[2] - v[0]);
+
+      // Range of voxels
+      const Box tb = triangle.GetBox();
+      const int i0 = std::max(0, int(floor((tb[0][0] - box[0][0]) / size)));
+      const int j0 = std::max(0, int(floor((tb[0][1] - box[0][1]) / size)));
+      const int k0 = std::max(8 * l, int(floor((tb[0][2] - box[0][2]) / size)));
+      const int i1 = std::min(nx - 1, int(floor((tb[1][0] - box[0][0]) / size)));
+      const int j1 = std::min(ny - 1, int(floor((tb[1][1] - box[0][1]) / size)));
+      const int k1 = std::min(std::min(nz - 1, 8 * l + 7), int(floor((tb[1][2] - box[0][2]) / size)));
+
+      // Plane overlap
+      const Vector c(n[0] > 0.0 ? size : 0.0, n[1] > 0.0 ? size : 0.0, n[2] > 0.0 ? size : 0.0);
+      const double d1 = n * (c - v[0]);
+      const double d2 = n * ((Vector(size) - c) - v[0]);
+
+      // Projected edges, as edge functions a x + b y + d >= 0 in the xy, yz and zx planes
+      double xya[3], xyb[3], xyd[3];
+      double yza[3], yzb[3], yzd[3];
+      double zxa[3], zxb[3], zxd[3];
+      const double sxy = n[2] < 0.0 ? -1.0 : 1.0;
+      const double syz = n[0] < 0.0 ? -1.0 : 1.0;
+      const double szx = n[1] < 0.0 ? -1.0 : 1.0;
+      for (int m = 0; m < 3; m++)
+      {
+        xya[m] = -e[m][1] * sxy;
+        xyb[m] = e[m][0] * sxy;
+        xyd[m] = -(xya[m] * v[m][0] + xyb[m] * v[m][1]) + Math::Max(0.0, size * xya[m]) + Math::Max(0.0, size * xyb[m]);
+
+        yza[m] = -e[m][2] * syz;
+        yzb[m] = e[m][1] * syz;
+        yzd[m] = -(yza[m] * v[m][1] + yzb[m] * v[m][2]) + Math::Max(0.0, size * yza[m]) + Math::Max(0.0, size * yzb[m]);
+
+        zxa[m] = -e[m][0] * szx;
+        zxb[m] = e[m][2] * szx;
+        zxd[m] = -(zxa[m] * v[m][2] + zxb[m] * v[m][0]) + Math::Max(0.0, size * zxa[m]) + Math::Max(0.0, size * zxb[m]);
+      }
+
+      for (int k = k0; k <= k1; k++)
+      {
+        const double z = k * size;
+        for (int j = j0; j <= j1; j++)
+        {
+          const double y = j * size;
+
+          // The yz projection does not depend on x
+          if (yza[0] * y + yzb[0] * z + yzd[0] < 0.0 || yza[1] * y + yzb[1] * z + yzd[1] < 0.0 || yza[2] * y + yzb[2] * z + yzd[2] < 0.0)
+            continue;
+
+          const double pyz = n[1] * y + n[2] * z;
+          const double xy0 = xyb[0] * y + xyd[0], xy1 = xyb[1] * y + xyd[1], xy2 = xyb[2] * y + xyd[2];
+          const double zx0 = zxa[0] * z + zxd[0], zx1 = zxa[1] * z + zxd[1], zx2 = zxa[2] * z + zxd[2];
+
+          // Vectorized row
+#pragma omp simd
+          for (int i = i0; i <= i1; i++)
+          {
+            const double x = i * size;
+            const double p = n[0] * x + pyz;
+            const bool plane = (p + d1) * (p + d2) <= 0.0;
+            const bool xy = (xya[0] * x + xy0 >= 0.0) & (xya[1] * x + xy1 >= 0.0) & (xya[2] * x + xy2 >= 0.0);
+            const bool zx = (zxb[0] * x + zx0 >= 0.0) & (zxb[1] * x + zx1 >= 0.0) & (zxb[2] * x + zx2 >= 0.0);
+            mask[i] = plane & xy & zx;
+          }
+
+          for (int i = i0; i <= i1; i++)
+          {
+            if (mask[i])
+            {
+              GetBrick(i >> 3, j >> 3, bricks, idx).bits[k & 7] |= uint64_t(1) << ((i & 7) + 8 * (j & 7));
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+/*!
+\brief Solid voxelization by parity of the crossings along x.
+
+Voxel centers on the shared edges of adjacent triangles are counted once, with a top-left fill rule in the yz plane.
+\param mesh The mesh.
+\param bins Triangles overlapping every layer of bricks.
+*/
+void VoxelGrid::Solid(const Mesh& mesh, const std::vector<std::vector<int>>& bins)
+{
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int l = 0; l < bz; l++)
+  {
+    std::vector<Brick>& bricks = layers[l];
+    std::vector<int>& idx = index[l];
+
+    // Crossings of every row of the layer
+    const int ka = 8 * l;
+    const int kb = std::min(nz, 8 * l + 8);
+    std::vector<std::vector<double>> rows((kb - ka) * ny);
+
+    for (int t : bins[l])
+    {
+      const Triangle triangle = mesh.GetTriangle(t);
+      const Vector n = (triangle[1] - triangle[0]) / (triangle[2] - triangle[0]);
+      if (n[0] == 0.0)
+        continue;
+
+      // Projection in the yz plane, counter clockwise
+      double py[3] = { triangle[0][1], triangle[1][1], triangle[2][1] };
+      double pz[3] = { triangle[0][2], triangle[1][2], triangle[2][2] };
+      if (n[0] < 0.0)
+      {
+        std::swap(py[1], py[2]);
+        std::swap(pz[1], pz[2]);
+      }
+
+      const Box tb = triangle.GetBox();
+      const int j0 = std::max(0, int(ceil((tb[0][1] - box[0][1]) / size - 0.5)));
+      const int j1 = std::min(ny - 1, int(floor((tb[1][1] - box[0][1]) / size - 0.5)));
+      const int k0 = std::max(ka, int(ceil((tb[0][2] - box[0][2]) / size - 0.5)));
+      const int k1 = std::min(kb - 1, int(floor((tb[1][2] - box[0][2]) / size - 0.5)));
+
+      for (int k = k0; k <= k1; k++)
+      {
+        const double z = box[0][2] + (k + 0.5) * size;
+        for (int j = j0; j <= j1; j++)
+        {
+          const double y = box[0][1] + (j + 0.5) * size;
+
+          bool inside = true;
+          for (int m = 0; m < 3 && inside; m++)
+          {
+            const double dy = py[(m + 1) % 3] - py[m];
+            const double dz = pz[(m + 1) % 3] - pz[m];
+            const double f = dy * (z - pz[m]) - dz * (y - py[m]);
+            inside = (f > 0.0) || (f == 0.0 && (dz < 0.0 || (dz == 0.0 && dy > 0.0)));
+          }
+          if (!inside)
+            continue;
+
+          const double x = triangle[0][0] - (n[1] * (y - triangle[0][1]) + n[2] * (z - triangle[0][2])) / n[0];
+          rows[(k - ka) * ny + j].push_back(x);
+        }
+      }
+    }
+
+    // Fill between pairs of crossings
+    for (int k = ka; k < kb; k++)
+    {
+      for (int j = 0; j < ny; j++)
+      {
+        std::vector<double>& r = rows[(k - ka) * ny + j];
+        std::sort(r.begin(), r.end());
+        for (int m = 0; m + 1 < int(r.size()); m += 2)
+        {
+          const int i0 = std::max(0, int(floor((r[m] - box[0][0]) / size - 0.5)) + 1);
+          const int i1 = std::min(nx - 1, int(floor((r[m + 1] - box[0][0]) / size - 0.5)));
+          for (int i = i0; i <= i1; i++)
+          {
+            GetBrick(i >> 3, j >> 3, bricks, idx).bits[k & 7] |= uint64_t(1) << ((i & 7) + 8 * (j & 7));
+          }
+        }
+      }
+    }
+  }
+}
+
+/*!
+\class VoxelField voxel.h
+\brief A narrow band signed distance field sampled at the centers of the voxels of a grid, trilinearly interpolated.
+
+Distances are only stored in the bricks of 8<SUP>3</SUP> voxels close to the surface, so that the memory is proportional
+to the area of the surface times the width of the band. Other bricks only store their side, and return plus or minus
+the width of the band.
+
+Distances are computed exactly at the voxels overlapping the surface, and propagated by the fast sweeping method.
+Bricks are swept independently, with the faces of their neighbors as boundary conditions, in parallel over the two
+colors of a checkerboard of bricks so that neighbors are never swept at the same time, until no distance decreases.
+The sign is given by a solid voxelization of the mesh.
+
+This is the input of remeshing by polygonization:
+\code
+VoxelGrid grid(mesh.GetBox(), 256);
+grid.Voxelize(mesh, VoxelGrid::Mode::Solid);
+VoxelField field(grid, mesh, 4);
+Mesh remeshed;
+field.Polygonize(256, remeshed, field.GetBox());
+\endcode
+
+After Hongkai Zhao, <I>A fast sweeping method for Eikonal equations</I>, <B>Mathematics of Computation</B>, 74(250):603-627, 2005.
+*/
+
+/*!
+\brief Solve the Eikonal equation at a sample from its smallest neighbors along every axis, with Godunov upwinding.
+\param a0,a1,a2 Smallest neighbors along the three axes.
+\param h Distance between samples.
+*/
+static inline float Godunov(float a0, float a1, float a2, float h)
+{
+  // Sort the neighbors
+  if (a0 > a1)
+    std::swap(a0, a1);
+  if (a1 > a2)
+    std::swap(a1, a2);
+  if (a0 > a1)
+    std::swap(a0, a1);
+
+  float u = a0 + h;
+  if (u > a1)
+  {
+    u = 0.5f * (a0 + a1 + sqrt(2.0f * h * h - (a0 - a1) * (a0 - a1)));
+    if (u > a2)
+    {
+      const float s = a0 + a1 + a2;
+      u = (s + sqrt(s * s - 3.0f * (a0 * a0 + a1 * a1 + a2 * a2 - h * h))) / 3.0f;
+    }
+  }
+  return u;
+}
+
+/*!
+\brief Compute the narrow band signed distance field of a mesh.
+\param solid Solid voxelization of the mesh, which gives the sign.
+\param mesh The mesh.
+\param width Width of the band, in voxels.
+*/
+VoxelField::VoxelField(const VoxelGrid& solid, const Mesh& mesh, int width) :box(solid.box), nx(solid.nx), ny(solid.ny), nz(solid.nz), size(solid.size), bx(solid.bx), by(solid.by), bz(solid.bz)
+{
+  band = width * size;
+  const float limit = float(band);
+
+  // Voxels overlapping the surface
+  VoxelGrid surface(solid.box, std::max(nx, std::max(ny, nz)));
+  surface.Voxelize(mesh, VoxelGrid::Mode::Surface);
+
+  // Bricks within the band of the set voxels of the surface bricks
+  std::vector<char> inBand(size_t(bx) * by * bz, 0);
+  for (int l = 0; l < bz; l++)
+  {
+    for (int b = 0; b < bx * by; b++)
+    {
+      const int s = surface.index[l][b];
+      if (s < 0)
+        continue;
+
+      // Range of the set voxels of the brick
+      const VoxelGrid::Brick& brick = surface.layers[l][s];
+      int lo[3] = { 8, 8, 8 }, hi[3] = { -1, -1, -1 };
+      for (int k = 0; k < 8; k++)
+      {
+        for (int v = 0; v < 64; v++)
+        {
+          if ((brick.bits[k] >> v) & 1)
+          {
+            const int c[3] = { v & 7, v >> 3, k };
+            for (int a = 0; a < 3; a++)
+            {
+              lo[a] = std::min(lo[a], c[a]);
+              hi[a] = std::max(hi[a], c[a]);
+            }
+          }
+        }
+      }
+
+      const int origin[3] = { (b % bx) * 8, (b / bx) * 8, l * 8 };
+      const int count[3] = { bx, by, bz };
+      int b0[3], b1[3];
+      for (int a = 0; a < 3; a++)
+      {
+        b0[a] = std::max((origin[a] + lo[a] - width) >> 3, 0);
+        b1[a] = std::min((origin[a] + hi[a] + width) >> 3, count[a] - 1);
+      }
+      for (int k = b0[2]; k <= b1[2]; k++)
+        for (int j = b0[1]; j <= b1[1]; j++)
+          for (int i = b0[0]; i <= b1[0]; i++)
+            inBand[(size_t(k) * by + j) * bx + i] = 1;
+    }
+  }
+
+  // Allocate the bricks of the band, other bricks are entirely inside or outside
+  index.resize(inBand.size());
+  std::vector<int> origins;
+  for (int b = 0; b < int(inBand.size()); b++)
+  {
+    index[b] = inBand[b] ? int(origins.size()) : Outside;
+    if (inBand[b])
+      origins.push_back(b);
+  }
+  inBand.clear();
+  bricks.resize(origins.size());
+
+#pragma omp parallel for schedule(static)
+  for (int b = 0; b < int(index.size()); b++)
+  {
+    if (index[b] == Outside && solid.Get(std::min((b % bx) * 8, nx - 1), std::min(((b / bx) % by) * 8, ny - 1), std::min((b / (bx * by)) * 8, nz - 1)))
+      index[b] = Inside;
+  }
+
+  // Exact distances around the surface
+  MeshDistance distance(mesh);
+#pragma omp parallel for schedule(dynamic, 16)
+  for (int b = 0; b < int(origins.size()); b++)
+  {
+    const int i0 = (origins[b] % bx) * 8, j0 = ((origins[b] / bx) % by) * 8, k0 = (origins[b] / (bx * by)) * 8;
+    float* d = bricks[b].d;
+    std::fill(d, d + 512, limit);
+    for (int k = 0; k < 8; k++)
+    {
+      for (int j = 0; j < 8; j++)
+      {
+        for (int i = 0; i < 8; i++)
+        {
+          if (i0 + i < nx && j0 + j < ny && k0 + k < nz && surface.Get(i0 + i, j0 + j, k0 + k))
+            d[(k * 8 + j) * 8 + i] = std::min(limit, float(distance.Distance(solid.Center(i0 + i, j0 + j, k0 + k))));
+        }
+      }
+    }
+  }
+
+  // Sweep the two colors of the checkerboard of bricks in turn, until distances no longer decrease
+  bool changed = true;
+  while (changed)
+  {
+    changed = false;
+    for (int color = 0; color < 2; color++)
+    {
+#pragma omp parallel for schedule(dynamic, 16) reduction(||:changed)
+      for (int b = 0; b < int(origins.size()); b++)
+      {
+        const int i = origins[b] % bx, j = (origins[b] / bx) % by, k = origins[b] / (bx * by);
+        if (((i + j + k) & 1) == color)
+          changed = Sweep(b, i, j, k) || changed;
+      }
+    }
+  }
+
+  // Sign
+#pragma omp parallel for schedule(dynamic, 16)
+  for (int b = 0; b < int(origins.size()); b++)
+  {
+    const int i0 = (origins[b] % bx) * 8, j0 = ((origins[b] / bx) % by) * 8, k0 = (origins[b] / (bx * by)) * 8;
+    for (int k = 0; k < 8; k++)
+      for (int j = 0; j < 8; j++)
+        for (int i = 0; i < 8; i++)
+          if (solid.Get(i0 + i, j0 + j, k0 + k))
+            bricks[b].d[(k * 8 + j) * 8 + i] *= -1.0f;
+  }
+}
+
+/*!
+\brief Sweep a brick of the band in the eight diagonal directions, with the faces of the neighboring bricks as boundary conditions.
+\param b Index of the brick in the band.
+\param i,j,k Integer coordinates of the brick.
+\return True if a distance decreased.
+*/
+bool VoxelField::Sweep(int b, int i, int j, int k)
+{
+  const float limit = float(band);
+  const float h = float(size);
+
+  // Brick with a layer of neighboring samples, x varying first
+  float s[10][10][10];
+  for (int z = 0; z < 10; z++)
+    for (int y = 0; y < 10; y++)
+      for (int x = 0; x < 10; x++)
+        s[z][y][x] = limit;
+
+  const float* d = bricks[b].d;
+  for (int z = 0; z < 8; z++)
+    for (int y = 0; y < 8; y++)
+      for (int x = 0; x < 8; x++)
+        s[z + 1][y + 1][x + 1] = d[(z * 8 + y) * 8 + x];
+
+  // Faces of the neighbors in the band
+  auto neighbor = [&](int di, int dj, int dk) -> const float*
+    {
+      const int ni = i + di, nj = j + dj, nk = k + dk;
+      if (ni < 0 || nj < 0 || nk < 0 || ni >= bx || nj >= by || nk >= bz)
+        return nullptr;
+      const int n = index[(size_t(nk) * by + nj) * bx + ni];
+      return (n >= 0) ? bricks[n].d : nullptr;
+    };
+  for (int side = 0; side < 2; side++)
+  {
+    const int o = side ? 1 : -1;
+    const int from = side ? 0 : 7, to = side ? 9 : 0;
+    if (const float* n = neighbor(o, 0, 0))
+      for (int z = 0; z < 8; z++)
+        for (int y = 0; y < 8; y++)
+          s[z + 1][y + 1][to] = n[(z * 8 + y) * 8 + from];
+    if (const float* n = neighbor(0, o, 0))
+      for (int z = 0; z < 8; z++)
+        for (int x = 0; x < 8; x++)
+          s[z + 1][to][x + 1] = n[(z * 8 + from) * 8 + x];
+    if (const float* n = neighbor(0, 0, o))
+      for (int y = 0; y < 8; y++)
+        for (int x = 0; x < 8; x++)
+          s[to][y + 1][x + 1] = n[(from * 8 + y) * 8 + x];
+  }
+
+  bool changed = false;
+  for (int sweep = 0; sweep < 8; sweep++)
+  {
+    const int sx = (sweep & 1) ? -1 : 1, sy = (sweep & 2) ? -1 : 1, sz = (sweep & 4) ? -1 : 1;
+    for (int zz = 1; zz <= 8; zz++)
+    {
+      const int z = (sz > 0) ? zz : 9 - zz;
+      for (int yy = 1; yy <= 8; yy++)
+      {
+        const int y = (sy > 0) ? yy : 9 - yy;
+        for (int xx = 1; xx <= 8; xx++)
+        {
+          const int x = (sx > 0) ? xx : 9 - xx;
+          const float a0 = std::min(s[z][y][x - 1], s[z][y][x + 1]);
+          const float a1 = std::min(s[z][y - 1][x], s[z][y + 1][x]);
+          const float a2 = std::min(s[z - 1][y][x], s[z + 1][y][x]);
+          if (std::min(a0, std::min(a1, a2)) >= limit)
+            continue;
+          const float u = Godunov(a0, a1, a2, h);
+          if (u < s[z][y][x])
+          {
+            s[z][y][x] = u;
+            changed = true;
+          }
+        }
+      }
+    }
+  }
+
+  float* w = bricks[b].d;
+  for (int z = 0; z < 8; z++)
+    for (int y = 0; y < 8; y++)
+      for (int x = 0; x < 8; x++)
+        w[(z * 8 + y) * 8 + x] = s[z + 1][y + 1][x + 1];
+  return changed;
+}
+
+/*!
+\brief Return the distance at the center of a voxel.
+\param i,j,k Integer coordinates of the voxel.
+*/
+inline float VoxelField::Sample(int i, int j, int k) const
+{
+  const int b = index[(size_t(k >> 3) * by + (j >> 3)) * bx + (i >> 3)];
+  if (b >= 0)
+    return bricks[b].d[((k & 7) * 8 + (j & 7)) * 8 + (i & 7)];
+  return (b == Inside) ? -float(band) : float(band);
+}
+
+/*!
+\brief Compute the value of the field, the band width outside of the grid.
+\param p Point.
+*/
+double VoxelField::Value(const Vector& p) const
+{
+  const Vector q = (p - box[0]) / size - Vector(0.5);
+  if (q[0] < 0.0 || q[1] < 0.0 || q[2] < 0.0 || q[0] > nx - 1 || q[1] > ny - 1 || q[2] > nz - 1)
+    return band;
+
+  const int i = std::min(int(q[0]), nx - 2 < 0 ? 0 : nx - 2);
+  const int j = std::min(int(q[1]), ny - 2 < 0 ? 0 : ny - 2);
+  const int k = std::min(int(q[2]), nz - 2 < 0 ? 0 : nz - 2);
+  const double u = q[0] - i;
+  const double v = q[1] - j;
+  const double w = q[2] - k;
+
+  const int i1 = std::min(i + 1, nx - 1);
+  const int j1 = std::min(j + 1, ny - 1);
+  const int k1 = std::min(k + 1, nz - 1);
+
+  const double a = (1.0 - u) * Sample(i, j, k) + u * Sample(i1, j, k);
+  const double b = (1.0 - u) * Sample(i, j1, k) + u * Sample(i1, j1, k);
+  const double c = (1.0 - u) * Sample(i, j, k1) + u * Sample(i1, j, k1);
+  const double e = (1.0 - u) * Sample(i, j1, k1) + u * Sample(i1, j1, k1);
+
+  return (1.0 - w) * ((1.0 - v) * a + v * b) + w * ((1.0 - v) * c + v * e);
+}
+
+/*!
+\brief Return the Lipschitz constant, close to 1 for a distance field.
+*/
+double VoxelField::K() const
+{
+  return 1.0;
+}
+
+/*!
+\brief Return the box of the grid.
+*/
+Box VoxelField::GetBox() const
+{
+  return box;
+}
+
+/*!
+\brief Return the memory used by the distances, in bytes.
+*/
+long long VoxelField::Memory() const
+{
+  return (long long)(bricks.size()) * sizeof(Brick) + (long long)(index.size()) * sizeof(int);
+}
@@ -12,43 +12,90 @@ VPATH += AppTinyMesh
 
 SOURCES += \
     AppTinyMesh/Source/box.cpp \
+    AppTinyMesh/Source/bvh.cpp \
     AppTinyMesh/Source/capsule.cpp \
     AppTinyMesh/Source/disk.cpp \
     AppTinyMesh/Source/cylinder.cpp \
     AppTinyMesh/Source/heightfield.cpp \
+    AppTinyMesh/Source/heightfieldcontour.cpp \
+    AppTinyMesh/Source/heightfielderosion.cpp \
+    AppTinyMesh/Source/heightfieldrtin.cpp \
+    AppTinyMesh/Source/heightfieldtracer.cpp \
+    AppTinyMesh/Source/heightfieldviewshed.cpp \
     AppTinyMesh/Source/matrix.cpp \
     AppTinyMesh/Source/sphere.cpp \
     AppTinyMesh/Source/torus.cpp \
     AppTinyMesh/Source/evector.cpp \
     AppTinyMesh/Source/implicits.cpp \
+    AppTinyMesh/Source/kdtree.cpp \
     AppTinyMesh/Source/main.cpp \
     AppTinyMesh/Source/camera.cpp \
     AppTinyMesh/Source/mesh.cpp \
+    AppTinyMesh/Source/meshanalysis.cpp \
     AppTinyMesh/Source/meshcolor.cpp \
+    AppTinyMesh/Source/meshcomponents.cpp \
+    AppTinyMesh/Source/meshdistance.cpp \
+    AppTinyMesh/Source/meshslicer.cpp \
     AppTinyMesh/Source/mesh-widget.cpp \
+    AppTinyMesh/Source/packet.cpp \
+    AppTinyMesh/Source/pagedheightfield.cpp \
+    AppTinyMesh/Source/pathtracer.cpp \
+    AppTinyMesh/Source/pointcloud.cpp \
     AppTinyMesh/Source/qtemainwindow.cpp \
     AppTinyMesh/Source/ray.cpp \
     AppTinyMesh/Source/shader-api.cpp \
+    AppTinyMesh/Source/spheretracer.cpp \
+    AppTinyMesh/Source/terrainnoise.cpp \
+    AppTinyMesh/Source/terrainquadtree.cpp \
     AppTinyMesh/Source/triangle.cpp \
+    AppTinyMesh/Source/voxel.cpp \
 
 HEADERS += \
     AppTinyMesh/Include/box.h \
+    AppTinyMesh/Include/bvh.h \
     AppTinyMesh/Include/capsule.h \
     AppTinyMesh/Include/disk.h \
     AppTinyMesh/Include/cylinder.h \
     AppTinyMesh/Include/heightfield.h \
+    AppTinyMesh/Include/heightfieldcontour.h \
+    AppTinyMesh/Include/heightfielderosion.h \
+    AppTinyMesh/Include/heightfieldrtin.h \
+    AppTinyMesh/Include/heightfieldtracer.h \
+    AppTinyMesh/Include/heightfieldviewshed.h \
     AppTinyMesh/Include/matrix.h \
     AppTinyMesh/Include/sphere.h \
     AppTinyMesh/Include/torus.h \
     AppTinyMesh/Include/camera.h \
     AppTinyMesh/Include/color.h \
     AppTinyMesh/Include/implicits.h \
+    AppTinyMesh/Include/kdtree.h \
     AppTinyMesh/Include/mathematics.h \
     AppTinyMesh/Include/mesh.h \
+    AppTinyMesh/Include/meshanalysis.h \
     AppTinyMesh/Include/meshcolor.h \
+    AppTinyMesh/Include/meshcomponents.h \
+    AppTinyMesh/Include/meshdistance.h \
+    AppTinyMesh/Include/meshslicer.h \
+    AppTinyMesh/Include/packet.h \
+    AppTinyMesh/Include/pagedheightfield.h \
+    AppTinyMesh/Include/parse.h \
+    AppTinyMesh/Include/pathtracer.h \
+    AppTinyMesh/Include/pointcloud.h \
     AppTinyMesh/Include/qte.h \
     AppTinyMesh/Include/realtime.h \
-    AppTinyMesh/Include/shader-api.h
+    AppTinyMesh/Include/shader-api.h \
+    AppTinyMesh/Include/spheretracer.h \
+    AppTinyMesh/Include/terrainnoise.h \
+    AppTinyMesh/Include/terrainquadtree.h \
+    AppTinyMesh/Include/voxel.h
+
+# OpenMP, used by the multithreaded tools
+msvc {
+    QMAKE_CXXFLAGS += -openmp
+} else {
+    QMAKE_CXXFLAGS += -fopenmp
+    QMAKE_LFLAGS += -fopenmp
+}
 
 FORMS += \
     AppTinyMesh/UI/interface.ui